@@ -0,0 +1,154 @@
+#ifndef _ATOMIC_H
+#define _ATOMIC_H
+
+#include "tiny_types.h"
+
+/*
+ * LL/SC primitives in the style of asm/spinlock.S: ldaxr/stlxr loops with
+ * acquire/release semantics. Kept inline because they sit on hot paths
+ * (IPI queues, rings, pools).
+ */
+
+static inline uint64_t atomic_load_acquire(const volatile uint64_t *p)
+{
+    uint64_t val;
+    __asm__ volatile("ldar %0, %1" : "=r"(val) : "Q"(*p) : "memory");
+    return val;
+}
+
+static inline void atomic_store_release(volatile uint64_t *p, uint64_t val)
+{
+    __asm__ volatile("stlr %1, %0" : "=Q"(*p) : "r"(val) : "memory");
+}
+
+static inline uint32_t atomic_load_acquire32(const volatile uint32_t *p)
+{
+    uint32_t val;
+    __asm__ volatile("ldar %w0, %1" : "=r"(val) : "Q"(*p) : "memory");
+    return val;
+}
+
+static inline void atomic_store_release32(volatile uint32_t *p, uint32_t val)
+{
+    __asm__ volatile("stlr %w1, %0" : "=Q"(*p) : "r"(val) : "memory");
+}
+
+// Returns the previous value
+static inline uint64_t atomic_xchg(volatile uint64_t *p, uint64_t val)
+{
+    uint64_t old;
+    uint32_t fail;
+    __asm__ volatile("1: ldaxr %0, %2\n\t"
+                     "stlxr %w1, %3, %2\n\t"
+                     "cbnz %w1, 1b"
+                     : "=&r"(old), "=&r"(fail), "+Q"(*p)
+                     : "r"(val)
+                     : "memory");
+    return old;
+}
+
+// Returns true when *p was `old` and has been replaced by `new`
+static inline bool atomic_cmpxchg(volatile uint64_t *p, uint64_t old, uint64_t new)
+{
+    uint64_t cur;
+    uint32_t fail;
+    __asm__ volatile("1: ldaxr %0, %2\n\t"
+                     "cmp %0, %3\n\t"
+                     "b.ne 2f\n\t"
+                     "stlxr %w1, %4, %2\n\t"
+                     "cbnz %w1, 1b\n\t"
+                     "b 3f\n"
+                     "2: clrex\n"
+                     "3:"
+                     : "=&r"(cur), "=&r"(fail), "+Q"(*p)
+                     : "r"(old), "r"(new)
+                     : "cc", "memory");
+    return cur == old;
+}
+
+static inline bool atomic_cmpxchg32(volatile uint32_t *p, uint32_t old, uint32_t new)
+{
+    uint32_t cur;
+    uint32_t fail;
+    __asm__ volatile("1: ldaxr %w0, %2\n\t"
+                     "cmp %w0, %w3\n\t"
+                     "b.ne 2f\n\t"
+                     "stlxr %w1, %w4, %2\n\t"
+                     "cbnz %w1, 1b\n\t"
+                     "b 3f\n"
+                     "2: clrex\n"
+                     "3:"
+                     : "=&r"(cur), "=&r"(fail), "+Q"(*p)
+                     : "r"(old), "r"(new)
+                     : "cc", "memory");
+    return cur == old;
+}
+
+// Returns the new value
+static inline uint64_t atomic_add_return(volatile uint64_t *p, uint64_t inc)
+{
+    uint64_t val;
+    uint32_t fail;
+    __asm__ volatile("1: ldaxr %0, %2\n\t"
+                     "add %0, %0, %3\n\t"
+                     "stlxr %w1, %0, %2\n\t"
+                     "cbnz %w1, 1b"
+                     : "=&r"(val), "=&r"(fail), "+Q"(*p)
+                     : "r"(inc)
+                     : "memory");
+    return val;
+}
+
+static inline uint32_t atomic_add_return32(volatile uint32_t *p, uint32_t inc)
+{
+    uint32_t val;
+    uint32_t fail;
+    __asm__ volatile("1: ldaxr %w0, %2\n\t"
+                     "add %w0, %w0, %w3\n\t"
+                     "stlxr %w1, %w0, %2\n\t"
+                     "cbnz %w1, 1b"
+                     : "=&r"(val), "=&r"(fail), "+Q"(*p)
+                     : "r"(inc)
+                     : "memory");
+    return val;
+}
+
+// Returns the previous value
+static inline uint64_t atomic_or(volatile uint64_t *p, uint64_t mask)
+{
+    uint64_t old, tmp;
+    uint32_t fail;
+    __asm__ volatile("1: ldaxr %0, %3\n\t"
+                     "orr %1, %0, %4\n\t"
+                     "stlxr %w2, %1, %3\n\t"
+                     "cbnz %w2, 1b"
+                     : "=&r"(old), "=&r"(tmp), "=&r"(fail), "+Q"(*p)
+                     : "r"(mask)
+                     : "memory");
+    return old;
+}
+
+// Returns the previous value
+static inline uint64_t atomic_and(volatile uint64_t *p, uint64_t mask)
+{
+    uint64_t old, tmp;
+    uint32_t fail;
+    __asm__ volatile("1: ldaxr %0, %3\n\t"
+                     "and %1, %0, %4\n\t"
+                     "stlxr %w2, %1, %3\n\t"
+                     "cbnz %w2, 1b"
+                     : "=&r"(old), "=&r"(tmp), "=&r"(fail), "+Q"(*p)
+                     : "r"(mask)
+                     : "memory");
+    return old;
+}
+
+#define smp_mb() __asm__ volatile("dmb ish" ::: "memory")
+#define smp_rmb() __asm__ volatile("dmb ishld" ::: "memory")
+#define smp_wmb() __asm__ volatile("dmb ishst" ::: "memory")
+#define cpu_relax() __asm__ volatile("yield" ::: "memory")
+
+#define READ_ONCE(x) (*(const volatile __typeof__(x) *)&(x))
+#define WRITE_ONCE(x, val) (*(volatile __typeof__(x) *)&(x) = (val))
+
+#endif
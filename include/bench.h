@@ -0,0 +1,51 @@
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#include "tiny_types.h"
+
+/*
+ * In-kernel benchmark registry.
+ *
+ * Benchmarks are only compiled into the `make bench` image (CONFIG_BENCH).
+ * Each case lives in the .bench section, collected by link.lds between
+ * __bench_start and __bench_end. The runner times one sample per call of
+ * run(batch) with the generic timer, and reports per-operation latency
+ * percentiles as JSON lines on the UART.
+ */
+struct bench_case
+{
+    const char *name;
+    int (*init)(void);          // optional, non-zero return skips the case
+    void (*run)(uint64_t batch); // performs `batch` operations
+    void (*fini)(void);         // optional, called once after the last sample
+    uint32_t batch;             // operations per timed sample
+    uint32_t warmup;            // untimed samples
+    uint32_t samples;           // timed samples
+};
+
+#define BENCH_DEFAULT_BATCH 64
+#define BENCH_DEFAULT_WARMUP 16
+#define BENCH_DEFAULT_SAMPLES 1024
+#define BENCH_MAX_SAMPLES 4096
+
+#define BENCH_DEFINE_FULL(_name, _init, _run, _fini, _batch, _warmup, _samples) \
+    static const struct bench_case __bench_##_name                             \
+        __attribute__((used, section(".bench"), aligned(8))) = {              \
+            .name = #_name,                                                   \
+            .init = _init,                                                    \
+            .run = _run,                                                      \
+            .fini = _fini,                                                    \
+            .batch = _batch,                                                  \
+            .warmup = _warmup,                                                \
+            .samples = _samples,                                              \
+    }
+
+#define BENCH_DEFINE(_name, _run)                                  \
+    BENCH_DEFINE_FULL(_name, NULL, _run, NULL, BENCH_DEFAULT_BATCH, \
+                      BENCH_DEFAULT_WARMUP, BENCH_DEFAULT_SAMPLES)
+
+int bench_run(const char *name);
+void bench_run_all(void);
+void bench_run_on_all_cpus(void (*fn)(uint64_t iters), uint64_t iters);
+
+#endif
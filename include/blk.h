@@ -0,0 +1,123 @@
+#ifndef _BLK_H
+#define _BLK_H
+
+#include "config.h"
+#include "sched.h"
+#include "spin_lock.h"
+#include "tiny_types.h"
+
+/*
+ * Asynchronous block layer.
+ *
+ * blk_submit() queues a request on the submitting CPU's software queue,
+ * kept in sector order so that adjacent reads or writes merge into one
+ * device request (one scatter-gather chain). Requests are handed to the
+ * driver while fewer than `depth` are in flight; every completion pulls
+ * the next ones, so the device queue stays full. Completion callbacks run
+ * in the driver's IRQ context.
+ *
+ * blk_start_plug()/blk_finish_plug() hold back dispatch on this CPU while
+ * a caller submits a batch, giving the batch a chance to merge.
+ */
+
+#define BLK_SECTOR_SHIFT 9
+#define BLK_SECTOR_SIZE (1 << BLK_SECTOR_SHIFT)
+
+enum blk_op
+{
+    BLK_READ,
+    BLK_WRITE,
+    BLK_FLUSH,
+};
+
+struct blk_request;
+struct mbuf;
+typedef void (*blk_done_t)(struct blk_request *rq, int status);
+
+struct blk_request
+{
+    enum blk_op op;
+    uint64_t sector;
+    uint32_t nr_sectors;
+    void *buf;
+    struct mbuf *mb; // if set, the data is this chain and buf is ignored
+    blk_done_t done;
+    void *priv;
+    int status;
+
+    // Block layer private
+    struct blk_request *next;        // software queue link
+    struct blk_request *merged;      // chain issued together, in sector order
+    struct blk_request *merged_tail;
+    uint32_t total_sectors;          // whole chain, valid on its head
+    uint32_t nr_segs;
+    uint64_t submit_ticks;
+};
+
+struct blk_swq
+{
+    spinlock_t lock;
+    struct blk_request *head; // sorted by sector
+    uint32_t count;
+    uint32_t plugged;
+} ____cacheline_aligned;
+
+struct blk_stats
+{
+    uint64_t submitted;
+    uint64_t merged;
+    uint64_t dispatched;
+    uint64_t completed;
+    uint64_t errors;
+    uint64_t busy; // driver refused a request
+    uint64_t sectors;
+    uint64_t lat_ticks; // submit to completion, summed over requests
+    uint32_t max_inflight;
+};
+
+struct blk_device
+{
+    const char *name;
+    uint64_t capacity; // sectors
+    uint32_t max_segs;
+    uint32_t max_sectors;
+    uint32_t hw_depth; // driver limit
+    int (*queue_rq)(struct blk_device *bd, struct blk_request *rq); // 0 or busy
+    void *priv;
+
+    volatile uint32_t depth;
+    volatile uint32_t inflight;
+    volatile uint32_t run_pending;
+    spinlock_t dispatch_lock;
+    uint32_t next_swq;
+    struct blk_stats stats;
+    struct blk_swq swq[NR_CPUS];
+};
+
+// Synchronous wrapper state for blk_read()/blk_write()
+struct blk_completion
+{
+    volatile bool done;
+    int status;
+    spinlock_t lock;
+    struct wait_queue wq;
+};
+
+int blk_register(struct blk_device *bd);
+struct blk_device *blk_get(int index);
+void blk_set_depth(struct blk_device *bd, uint32_t depth);
+
+int blk_submit(struct blk_device *bd, struct blk_request *rq);
+void blk_complete(struct blk_device *bd, struct blk_request *rq, int status);
+void blk_run_queue(struct blk_device *bd);
+void blk_start_plug(struct blk_device *bd);
+void blk_finish_plug(struct blk_device *bd);
+
+void blk_completion_init(struct blk_completion *c);
+void blk_complete_sync(struct blk_request *rq, int status);
+int blk_wait(struct blk_completion *c);
+int blk_read(struct blk_device *bd, uint64_t sector, void *buf, uint32_t nr_sectors);
+int blk_write(struct blk_device *bd, uint64_t sector, const void *buf, uint32_t nr_sectors);
+void blk_dump(struct blk_device *bd);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef _BOOT_H
+#define _BOOT_H
+
+// Boot-phase timestamps (CNTVCT), recorded by asm/startup.S
+#define BOOT_TS_ENTRY 0 // first instruction of _start
+#define BOOT_TS_MMU 1   // page tables built, MMU and caches on
+#define BOOT_TS_BSS 2   // .bss zeroed, stack ready
+#define BOOT_TS_MAIN 3  // kernel_main entered
+#define BOOT_TS_MAX 4
+
+// struct boot_info layout, shared with startup.S
+#define BOOT_INFO_DTB 0
+#define BOOT_INFO_TS 8
+
+#ifndef __ASSEMBLY__
+
+#include "tiny_types.h"
+
+struct boot_info
+{
+    paddr_t dtb_pa; // x0 as handed over by the loader
+    uint64_t ts[BOOT_TS_MAX];
+};
+
+extern struct boot_info boot_info;
+
+void boot_mark(int phase);
+void boot_report(void);
+
+#endif // __ASSEMBLY__
+
+#endif
@@ -3,6 +3,19 @@
 
 #define UART_BASE_ADDR  0x09000000
 
+// QEMU virt defaults, used only when no device tree is found (see fdt.c)
+#define DEFAULT_RAM_BASE        0x40000000
+#define DEFAULT_UART_IRQ        33
+#define DEFAULT_GIC_DIST_BASE   0x08000000
+#define DEFAULT_GIC_CPU_BASE    0x08010000
+#define DEFAULT_VIRTIO_BASE     0x0a000000
+#define DEFAULT_VIRTIO_STRIDE   0x200
+#define DEFAULT_VIRTIO_IRQ      48
+#define DEFAULT_VIRTIO_SLOTS    32
+
+#define NR_CPUS         8
+#define BOOT_STACK_SIZE 0x8000  // 每个 CPU 的启动栈大小 (32KB)
+
 #define PRINTF_DISABLE_SUPPORT_FLOAT
 
 #endif // CONFIG_H
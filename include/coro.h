@@ -0,0 +1,127 @@
+#ifndef _CORO_H
+#define _CORO_H
+
+#include "sched.h"
+#include "spin_lock.h"
+#include "timer.h"
+#include "tiny_types.h"
+
+/*
+ * Stackless coroutines for I/O-bound kernel services.
+ *
+ * A kernel thread costs a 16KB stack; a coroutine costs its struct coro
+ * plus whatever state its owner keeps next to it, so one CPU can carry
+ * thousands of outstanding requests or connections. Coroutines run on a
+ * per-CPU event loop thread ("coro/N") and never migrate.
+ *
+ * The body is a function resumed from the top each time; the CORO_*
+ * macros turn it into a state machine with a switch on the saved resume
+ * point (the same trick as protothreads). Locals do not survive a yield
+ * or an await, so anything needed afterwards must live in the owner's
+ * structure (reach it through co->arg). A switch statement of its own
+ * must not span an await.
+ *
+ *     static int reader(struct coro *co)
+ *     {
+ *         struct conn *c = co->arg;
+ *
+ *         CORO_BEGIN(co);
+ *         CORO_AWAIT_BLK(co, c->bd, &c->rq);
+ *         if (co->result)
+ *             CORO_EXIT(co);
+ *         CORO_SLEEP_NS(co, 1000000);
+ *         CORO_END(co);
+ *     }
+ *
+ * An await records the resume point, arms the event and returns to the
+ * loop; the event's completion (virtqueue IRQ, timer, coro_event_signal)
+ * calls coro_wake(), which queues the coroutine again with its result in
+ * co->result. A wake that lands while the body is still unwinding only
+ * queues it, so there is no lost-wakeup window.
+ */
+
+#define CORO_DONE 0
+#define CORO_PENDING 1
+
+struct coro;
+struct blk_device;
+struct blk_request;
+typedef int (*coro_fn_t)(struct coro *co);
+
+struct coro
+{
+    uint32_t resume;        // __LINE__ of the last yield/await, 0 = start
+    volatile uint32_t queued;
+    int cpu;
+    int result;             // completion status of the last await
+    coro_fn_t fn;
+    void *arg;
+    void (*done)(struct coro *co); // optional, runs on the loop after CORO_DONE
+    struct coro *next;      // ready list
+    struct timer_event timer;
+};
+
+// One-shot completion with at most one waiter, signalled from any context
+struct coro_event
+{
+    spinlock_t lock;
+    bool fired;
+    int result;
+    struct coro *waiter;
+};
+
+struct coro_loop
+{
+    spinlock_t lock;
+    struct coro *head; // ready list, FIFO
+    struct coro *tail;
+    struct wait_queue wq;
+    struct task *task;
+    uint64_t live;     // started, not yet done
+    uint64_t resumes;
+    uint64_t wakeups;
+} ____cacheline_aligned;
+
+#define CORO_BEGIN(co)          \
+    switch ((co)->resume)       \
+    {                           \
+    case 0:
+
+#define CORO_END(co)            \
+    }                           \
+    (co)->resume = 0;           \
+    return CORO_DONE
+
+#define CORO_EXIT(co)           \
+    do                          \
+    {                           \
+        (co)->resume = 0;       \
+        return CORO_DONE;       \
+    } while (0)
+
+// Arm an event whose completion calls coro_wake(co), then suspend
+#define CORO_AWAIT(co, arm)       \
+    do                            \
+    {                             \
+        (co)->resume = __LINE__;  \
+        arm;                      \
+        return CORO_PENDING;      \
+    case __LINE__:;               \
+    } while (0)
+
+#define CORO_YIELD(co) CORO_AWAIT(co, coro_wake(co, 0))
+#define CORO_SLEEP_NS(co, ns) CORO_AWAIT(co, coro_sleep_arm(co, ns))
+#define CORO_AWAIT_EVENT(co, ev) CORO_AWAIT(co, coro_event_arm(co, ev))
+#define CORO_AWAIT_BLK(co, bd, rq) CORO_AWAIT(co, coro_blk_arm(co, bd, rq))
+
+void coro_init(void);
+void coro_start(struct coro *co, coro_fn_t fn, void *arg, int cpu);
+void coro_wake(struct coro *co, int result);
+void coro_sleep_arm(struct coro *co, uint64_t ns);
+void coro_event_init(struct coro_event *ev);
+void coro_event_signal(struct coro_event *ev, int result);
+void coro_event_arm(struct coro *co, struct coro_event *ev);
+void coro_blk_arm(struct coro *co, struct blk_device *bd, struct blk_request *rq);
+void coro_dump(void);
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef _DMA_H
+#define _DMA_H
+
+#include "tiny_types.h"
+
+/*
+ * DMA mapping for device buffers.
+ *
+ * A device either snoops the CPU caches ("dma-coherent" in its DT node,
+ * as QEMU's virtio-mmio slots are) or reads and writes RAM behind them.
+ * For a coherent device every call below is free apart from the address
+ * translation. For the others:
+ *
+ *  - dma_alloc_coherent() returns memory mapped Normal non-cacheable in
+ *    the KMAP slot (rings, shared control blocks);
+ *  - streaming buffers stay cacheable and are handed over with
+ *    dma_sync_*: clean before the device reads, clean+invalidate before
+ *    it writes, invalidate again when the CPU takes the buffer back.
+ *
+ * Maintenance works by cache line (CTR_EL0.DminLine, read once). The
+ * single-range calls end with their own dsb. The __ variants leave it out
+ * so a caller covering many ranges issues one dma_sync_fence() at the end;
+ * dma_sync_sg_for_device() does that for a whole chain, so a request costs
+ * one barrier however many segments it has.
+ */
+
+enum dma_dir
+{
+    DMA_BIDIRECTIONAL,
+    DMA_TO_DEVICE,   // device reads
+    DMA_FROM_DEVICE, // device writes
+};
+
+typedef paddr_t dma_addr_t;
+
+struct dma_dev
+{
+    bool coherent;
+};
+
+struct vq_buf;
+
+void dma_init(void);
+uint32_t dma_cache_line(void);
+
+void *dma_alloc_coherent(const struct dma_dev *dev, uint64_t size, dma_addr_t *handle);
+void dma_free_coherent(const struct dma_dev *dev, void *cpu, uint64_t size);
+
+dma_addr_t dma_map(const struct dma_dev *dev, void *cpu, uint64_t size, enum dma_dir dir);
+void dma_unmap(const struct dma_dev *dev, dma_addr_t addr, uint64_t size, enum dma_dir dir);
+void dma_sync_for_device(const struct dma_dev *dev, dma_addr_t addr, uint64_t size,
+                         enum dma_dir dir);
+void dma_sync_for_cpu(const struct dma_dev *dev, dma_addr_t addr, uint64_t size,
+                      enum dma_dir dir);
+void __dma_sync_for_device(const struct dma_dev *dev, dma_addr_t addr, uint64_t size,
+                           enum dma_dir dir);
+void __dma_sync_for_cpu(const struct dma_dev *dev, dma_addr_t addr, uint64_t size,
+                        enum dma_dir dir);
+void dma_sync_sg_for_device(const struct dma_dev *dev, const struct vq_buf *bufs, uint32_t n);
+
+// Completes every maintenance op issued so far by this CPU
+static inline void dma_sync_fence(void)
+{
+    __asm__ volatile("dsb sy" ::: "memory");
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef _EXCEPTION_H
+#define _EXCEPTION_H
+
+// ESR_EL1 exception classes (ESR_EL1.EC, bits [31:26])
+#define ESR_EC_SHIFT 26
+#define ESR_EC_MASK 0x3f
+#define ESR_EC_UNKNOWN 0x00
+#define ESR_EC_WFX 0x01
+#define ESR_EC_FP_ASIMD 0x07
+#define ESR_EC_ILL 0x0e
+#define ESR_EC_SVC64 0x15
+#define ESR_EC_SYS64 0x18
+#define ESR_EC_IABT_LOW 0x20
+#define ESR_EC_IABT_CUR 0x21
+#define ESR_EC_PC_ALIGN 0x22
+#define ESR_EC_DABT_LOW 0x24
+#define ESR_EC_DABT_CUR 0x25
+#define ESR_EC_SP_ALIGN 0x26
+#define ESR_EC_SERROR 0x2f
+#define ESR_EC_BRK64 0x3c
+#define ESR_EC_MAX 0x40
+
+#define ESR_ISS_MASK 0x1ffffff
+#define ESR_ISS_WNR (1 << 6)     // data abort: write not read
+#define ESR_ISS_FSC_MASK 0x3f    // data/instruction fault status code
+
+#define SPSR_I (1 << 7) // IRQs were masked
+
+// SAVE_REGS frame layout in 8-byte slots (asm/exception.S)
+#define FRAME_X0 0
+#define FRAME_LR 30
+#define FRAME_SP_EL0 31
+#define FRAME_ELR 32
+#define FRAME_SPSR 33
+#define FRAME_SLOTS 34
+
+#ifndef __ASSEMBLY__
+
+#include "tiny_types.h"
+
+// The 34-slot frame built by SAVE_REGS
+struct trap_frame
+{
+    uint64_t regs[31]; // x0 - x30
+    uint64_t sp_el0;
+    uint64_t elr;
+    uint64_t spsr;
+};
+
+// Exception "kind" / "source" as passed to invalid_exception
+enum
+{
+    EXC_KIND_SYNC,
+    EXC_KIND_IRQ,
+    EXC_KIND_FIQ,
+    EXC_KIND_SERROR,
+};
+
+enum
+{
+    EXC_SRC_CUR_SP0,
+    EXC_SRC_CUR_SPX,
+    EXC_SRC_LOWER_A64,
+    EXC_SRC_LOWER_A32,
+};
+
+typedef void (*exc_handler_t)(struct trap_frame *frame, uint64_t esr);
+
+static inline bool frame_from_user(const struct trap_frame *frame)
+{
+    return (frame->spsr & 0xf) == 0; // SPSR.M = EL0t
+}
+
+void fault_report(const struct trap_frame *frame, uint64_t esr, const char *why);
+void panic(const char *fmt, ...) __attribute__((noreturn));
+
+#endif // __ASSEMBLY__
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef _FAT32_H
+#define _FAT32_H
+
+#include "blk.h"
+#include "tiny_types.h"
+
+/*
+ * Read-only FAT32 on a block device. A file's cluster chain is walked
+ * once at open time and kept as a list of contiguous extents, so mapping
+ * a file offset to a disk sector never touches the FAT again and can be
+ * done from any context. Names are 8.3 only (long-name entries are
+ * skipped), matched case-insensitively.
+ */
+
+#define FAT_MAX_EXTENTS 16
+#define FAT_MAX_OPEN 16
+#define FAT_NAME_LEN 64
+
+struct fat_extent
+{
+    uint32_t file_cluster; // first cluster index within the file
+    uint32_t cluster;      // first cluster on disk
+    uint32_t count;
+};
+
+struct fat_file
+{
+    char path[FAT_NAME_LEN];
+    uint32_t size;
+    uint32_t first_cluster;
+    uint32_t nr_extents;
+    struct fat_extent extents[FAT_MAX_EXTENTS];
+};
+
+struct fat_volume
+{
+    struct blk_device *bd;
+    uint64_t part_start; // sector of the boot sector
+    uint32_t sectors_per_cluster;
+    uint32_t cluster_shift; // log2(sectors_per_cluster)
+    uint64_t fat_start;
+    uint64_t data_start;
+    uint32_t root_cluster;
+    uint32_t nr_clusters;
+};
+
+int fat32_mount(struct blk_device *bd);
+bool fat32_mounted(void);
+struct fat_file *fat32_open(const char *path);
+int64_t fat32_bmap(const struct fat_file *f, uint64_t file_sector);
+struct blk_device *fat32_bdev(void);
+
+#endif
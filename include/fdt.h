@@ -0,0 +1,63 @@
+#ifndef _FDT_H
+#define _FDT_H
+
+#include "tiny_types.h"
+
+#define FDT_MAGIC 0xd00dfeed
+#define FDT_MAX_VIRTIO 32
+#define FDT_MAX_DEPTH 16
+
+// Fallback DTB location: for bare-metal ELF images QEMU virt leaves x0
+// alone and places the blob at the base of RAM.
+#define FDT_FALLBACK_ADDR 0x40000000
+
+struct fdt_reg
+{
+    paddr_t base;
+    uint64_t size;
+};
+
+struct virtio_slot
+{
+    paddr_t base;
+    uint64_t size;
+    uint32_t irq; // GIC INTID
+    bool dma_coherent;
+};
+
+// Timer PPIs in the order of the arm,armv8-timer interrupts property
+enum
+{
+    TIMER_IRQ_SEC_PHYS,
+    TIMER_IRQ_PHYS,
+    TIMER_IRQ_VIRT,
+    TIMER_IRQ_HYP,
+    TIMER_IRQ_MAX,
+};
+
+/*
+ * Devices discovered by the single boot-time pass over the DTB. Every
+ * lookup afterwards is a plain field read.
+ */
+struct device_table
+{
+    bool valid; // false: no DTB found, defaults from config.h are used
+    struct fdt_reg memory;
+    struct fdt_reg uart;
+    uint32_t uart_irq;
+    uint32_t gic_version;    // 2 or 3
+    struct fdt_reg gic_dist;
+    struct fdt_reg gic_cpu;  // GICv2 CPU interface / GICv3 redistributors
+    uint32_t timer_irq[TIMER_IRQ_MAX];
+    uint32_t nr_cpus;
+    bool psci_hvc;           // PSCI conduit, hvc or smc
+    uint32_t nr_virtio;
+    struct virtio_slot virtio[FDT_MAX_VIRTIO];
+};
+
+extern struct device_table dev_table;
+
+int fdt_init(paddr_t dtb_pa);
+void fdt_dump(void);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef _GIC_H
+#define _GIC_H
+
+#include "tiny_types.h"
+
+// GICv2 distributor registers
+#define GICD_CTLR 0x000
+#define GICD_TYPER 0x004
+#define GICD_ISENABLER 0x100
+#define GICD_ICENABLER 0x180
+#define GICD_ICPENDR 0x280
+#define GICD_IPRIORITYR 0x400
+#define GICD_ITARGETSR 0x800
+#define GICD_ICFGR 0xc00
+#define GICD_SGIR 0xf00
+
+// GICv2 CPU interface registers
+#define GICC_CTLR 0x00
+#define GICC_PMR 0x04
+#define GICC_BPR 0x08
+#define GICC_IAR 0x0c
+#define GICC_EOIR 0x10
+
+#define GIC_SGI_MAX 16
+#define GIC_SPI_BASE 32
+#define GIC_SPURIOUS 1020
+#define GIC_IRQ_PRIO 0xa0
+
+int gic_init(void);
+void gic_cpu_init(void);
+void gic_enable_irq(uint32_t irq);
+void gic_disable_irq(uint32_t irq);
+void gic_set_target(uint32_t irq, int cpu);
+void gic_send_sgi(uint64_t cpumask, uint32_t sgi);
+uint32_t gic_ack(void);
+void gic_eoi(uint32_t iar);
+
+static inline uint32_t gic_irq_of(uint32_t iar)
+{
+    return iar & 0x3ff;
+}
+
+#endif
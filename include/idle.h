@@ -0,0 +1,59 @@
+#ifndef _IDLE_H
+#define _IDLE_H
+
+#include "percpu.h"
+#include "tiny_types.h"
+
+/*
+ * Idle governor. An idle CPU either polls its run queue for a short while
+ * (fast wakeup, no IPI needed: the waker just sets need_resched) or halts
+ * in wfi (the vCPU thread sleeps on the host, but the wakeup pays an SGI
+ * and the host's reschedule of the vCPU).
+ *
+ * The choice comes from a per-CPU moving average of recent idle periods
+ * (idle entry until work shows up) and from the next timer deadline: when
+ * either is below IDLE_POLL_NS the CPU polls first, then falls back to
+ * wfi if nothing arrived. Wake latency is measured from wake_up_task()
+ * or the expiring timer's deadline to the idle loop calling schedule().
+ */
+
+#define IDLE_POLL_NS (50 * 1000ULL)         // poll budget, about the cost of a wfi round trip
+#define IDLE_PREDICT_INIT_NS (10 * 1000 * 1000ULL)
+#define IDLE_EWMA_SHIFT 3                    // new sample weighs 1/8
+
+enum idle_mode
+{
+    IDLE_POLL,
+    IDLE_WFI,
+    NR_IDLE_MODES,
+};
+
+struct idle_state
+{
+    // Governor
+    uint64_t predicted_ns;   // moving average of idle periods
+    uint64_t idle_start;     // CNTVCT at entry of the current idle period, 0 if busy
+    enum idle_mode last_mode;
+    volatile uint32_t polling; // wakers skip the SGI while set
+    volatile uint64_t wake_ts; // first wakeup stamp of this idle period
+    // Counters
+    uint64_t polls;
+    uint64_t poll_hits; // polls that ended with work, no wfi needed
+    uint64_t wfis;
+    uint64_t ipis_saved;
+    uint64_t poll_ns; // host CPU burnt polling
+    uint64_t wfi_ns;  // host CPU given back
+    uint64_t wakeups[NR_IDLE_MODES];
+    uint64_t wake_lat_ns[NR_IDLE_MODES]; // summed
+    uint64_t wake_lat_max_ns[NR_IDLE_MODES];
+};
+
+DECLARE_PER_CPU(struct idle_state, idle_state);
+
+void idle_enter(void);
+void idle_exit(void);
+void idle_note_wake(int cpu, uint64_t ts);
+bool idle_wake_polling(int cpu);
+void idle_dump(void);
+
+#endif
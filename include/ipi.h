@@ -0,0 +1,46 @@
+#ifndef _IPI_H
+#define _IPI_H
+
+#include "percpu.h"
+#include "tiny_types.h"
+
+// SGI numbers used for inter-processor interrupts
+enum ipi_type
+{
+    IPI_CALL_FUNC = 0,
+    IPI_RESCHEDULE = 1,
+    IPI_NR,
+};
+
+typedef void (*smp_call_func_t)(void *arg);
+
+/*
+ * Cross-CPU call request. Every CPU owns a small pool of these and links
+ * them into the target CPU's lock-free MPSC queue; the target releases the
+ * slot (busy = 0) before running fn.
+ */
+struct call_single_data
+{
+    struct call_single_data *next;
+    smp_call_func_t fn;
+    void *arg;
+    volatile uint32_t busy;
+};
+
+struct ipi_stats
+{
+    uint64_t sent;      // SGIs raised
+    uint64_t coalesced; // calls queued behind a pending SGI
+    uint64_t received;  // SGIs taken
+    uint64_t calls;     // functions run
+};
+
+DECLARE_PER_CPU(struct ipi_stats, ipi_stats);
+
+void ipi_init(void);
+int smp_call_function(int cpu, smp_call_func_t fn, void *arg);
+int smp_call_function_many(uint64_t cpumask, smp_call_func_t fn, void *arg);
+void smp_send_reschedule(int cpu);
+void ipi_flush_call_queue(void);
+
+#endif
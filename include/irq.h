@@ -0,0 +1,39 @@
+#ifndef _IRQ_H
+#define _IRQ_H
+
+#include "tiny_types.h"
+
+#define NR_IRQS 512
+
+typedef void (*irq_handler_t)(uint32_t irq, void *arg);
+
+int irq_register(uint32_t irq, irq_handler_t handler, void *arg);
+void irq_dispatch(uint32_t irq);
+
+static inline void local_irq_enable(void)
+{
+    __asm__ volatile("msr daifclr, #2" ::: "memory");
+}
+
+static inline void local_irq_disable(void)
+{
+    __asm__ volatile("msr daifset, #2" ::: "memory");
+}
+
+static inline uint64_t local_irq_save(void)
+{
+    uint64_t flags;
+    __asm__ volatile("mrs %0, daif\n\t"
+                     "msr daifset, #2"
+                     : "=r"(flags)
+                     :
+                     : "memory");
+    return flags;
+}
+
+static inline void local_irq_restore(uint64_t flags)
+{
+    __asm__ volatile("msr daif, %0" : : "r"(flags) : "memory");
+}
+
+#endif
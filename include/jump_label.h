@@ -0,0 +1,68 @@
+#ifndef _JUMP_LABEL_H
+#define _JUMP_LABEL_H
+
+#include "tiny_types.h"
+
+/*
+ * Static keys: branches patched in the kernel text instead of tested.
+ *
+ * static_branch_unlikely() compiles to a single nop that falls through to
+ * the "false" path, plus a __jump_table entry {site, target, key}. Turning
+ * the key on rewrites the nop into a "b target" at every site of that key;
+ * turning it off writes the nop back. A disabled site therefore costs one
+ * nop, with no load of the key and no compare.
+ *
+ * Every site starts out as a nop; jump_label_init() patches the sites of
+ * keys that are initialised to true, so it must run before the first
+ * such branch is taken. The kernel text is mapped writable (startup.S
+ * clears SCTLR_EL1.WXN) and a nop <-> b swap is one of the instruction
+ * changes the architecture allows while other CPUs may be executing it.
+ */
+struct static_key
+{
+    volatile int enabled;
+};
+
+struct jump_entry
+{
+    uint64_t code;   // address of the patched nop
+    uint64_t target; // where the branch goes when the key is on
+    uint64_t key;    // struct static_key *
+};
+
+#define STATIC_KEY_INIT_FALSE {.enabled = 0}
+#define STATIC_KEY_INIT_TRUE {.enabled = 1}
+
+// A macro, not an inline: "i" needs the key address as a link-time constant at -O0
+#define static_branch_unlikely(key)                                     \
+    ({                                                                  \
+        __label__ __jl_yes, __jl_out;                                   \
+        bool __jl_ret;                                                  \
+        asm goto("1: nop\n"                                             \
+                 "  .pushsection __jump_table, \"aw\"\n"                \
+                 "  .balign 8\n"                                        \
+                 "  .quad 1b, %l[__jl_yes], %c0\n"                      \
+                 "  .popsection\n"                                      \
+                 :                                                      \
+                 : "i"(key)                                             \
+                 :                                                      \
+                 : __jl_yes);                                           \
+        __jl_ret = false;                                               \
+        goto __jl_out;                                                  \
+    __jl_yes:                                                           \
+        __jl_ret = true;                                                \
+    __jl_out:                                                           \
+        __jl_ret;                                                       \
+    })
+
+static inline bool static_key_enabled(const struct static_key *key)
+{
+    return key->enabled;
+}
+
+void jump_label_init(void);
+void static_key_enable(struct static_key *key);
+void static_key_disable(struct static_key *key);
+int static_key_sites(const struct static_key *key);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef _LOCKPROF_H
+#define _LOCKPROF_H
+
+#include "spin_lock.h"
+#include "tiny_types.h"
+
+/*
+ * Lock contention profiler (make LOCKPROF=1, CONFIG_LOCK_PROFILE).
+ *
+ * spin_lock/spin_trylock/spin_unlock become wrappers around the counting
+ * variants in asm/spinlock.S. Every spinlock_t address gets a lock class
+ * on first use, in a lock-free open-addressed table. Statistics are
+ * updated while the lock is held, so they need no atomics of their own.
+ * Without CONFIG_LOCK_PROFILE none of this is compiled and the calls
+ * below are empty inlines.
+ */
+
+#define LOCKPROF_CLASSES 512 // power of two
+#define LOCKPROF_TOP_N 10
+
+struct lock_class
+{
+    volatile uint64_t key; // spinlock_t address, 0 while free
+    uint64_t acquisitions;
+    uint64_t contended; // acquisitions that had to spin
+    uint64_t spins;
+    uint64_t max_spins;
+    uintptr_t max_spins_pc;
+    uint64_t hold_ticks; // summed
+    uint64_t max_hold_ticks;
+    uintptr_t max_hold_pc;
+    volatile uint64_t trylock_failures;
+    // Current holder
+    uint64_t acquired_at;
+    uintptr_t acquired_pc;
+};
+
+#ifdef CONFIG_LOCK_PROFILE
+void lockprof_report(int top_n);
+void lockprof_reset(void);
+#else
+static inline void lockprof_report(int top_n)
+{
+}
+
+static inline void lockprof_reset(void)
+{
+}
+#endif
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef _MBUF_H
+#define _MBUF_H
+
+#include "tiny_types.h"
+
+/*
+ * Scatter-gather buffer chains shared by the network and block stacks.
+ *
+ * A packet (or a block transfer) is a chain of mbuf segments linked by
+ * `next`. Each segment describes [data, data + len) inside a 2KB data
+ * buffer; the buffer carries its own reference count, so mbuf_clone()
+ * copies only the descriptors and several chains can point at the same
+ * bytes. Headroom in front of data lets each layer prepend its header in
+ * place; once a buffer is shared its head/tail room is no longer written
+ * and mbuf_prepend()/mbuf_append() add a fresh segment instead.
+ *
+ * mbuf_to_vq() turns a chain into one vq_buf per non-empty segment, the
+ * count mbuf_nsegs() returns (the kernel is identity mapped), so a payload written once by its producer goes to
+ * the device without another copy. Descriptors and buffers come from
+ * tiny_pool, so everything here is usable from IRQ context.
+ */
+
+#define MBUF_NR 1024           // descriptors
+#define MBUF_NR_BUFS 256       // 2KB data buffers
+#define MBUF_BUF_SIZE 2048
+#define MBUF_EXT_SIZE 64       // struct mbuf_ext, padded to a cache line
+#define MBUF_DATA_SIZE (MBUF_BUF_SIZE - MBUF_EXT_SIZE)
+#define MBUF_HEADROOM 128      // virtio-net + Ethernet + IP + UDP, rounded up
+
+struct vq_buf;
+
+// Head of every data buffer
+struct mbuf_ext
+{
+    volatile uint32_t refcnt;
+};
+
+struct mbuf
+{
+    struct mbuf *next;    // next segment of the same chain
+    struct mbuf_ext *ext; // data buffer, shared by clones
+    uint8_t *data;        // first valid byte
+    uint32_t len;         // valid bytes in this segment
+    uint32_t pkt_len;     // whole chain, kept on the head segment
+};
+
+static inline uint8_t *mbuf_buf_start(const struct mbuf *m)
+{
+    return (uint8_t *)m->ext + MBUF_EXT_SIZE;
+}
+
+static inline uint8_t *mbuf_buf_end(const struct mbuf *m)
+{
+    return (uint8_t *)m->ext + MBUF_BUF_SIZE;
+}
+
+static inline uint32_t mbuf_headroom(const struct mbuf *m)
+{
+    return m->data - mbuf_buf_start(m);
+}
+
+static inline uint32_t mbuf_tailroom(const struct mbuf *m)
+{
+    return mbuf_buf_end(m) - (m->data + m->len);
+}
+
+// Head/tail room may only be written while nobody else holds the buffer
+static inline bool mbuf_writable(const struct mbuf *m)
+{
+    return m->ext->refcnt == 1;
+}
+
+#define mtod(m, type) ((type)(m)->data)
+
+int mbuf_init(void);
+struct mbuf *mbuf_alloc(uint32_t headroom);
+void mbuf_free(struct mbuf *m);
+struct mbuf *mbuf_clone(const struct mbuf *m);
+void *mbuf_prepend(struct mbuf **mp, uint32_t len);
+void *mbuf_append(struct mbuf *m, uint32_t len);
+void *mbuf_pull(struct mbuf *m, uint32_t len);
+void mbuf_cat(struct mbuf *head, struct mbuf *tail);
+uint32_t mbuf_nsegs(const struct mbuf *m);
+uint32_t mbuf_copydata(const struct mbuf *m, uint32_t off, uint32_t len, void *dst);
+int mbuf_to_vq(const struct mbuf *m, struct vq_buf *bufs, uint32_t max, bool write);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef _MMAP_H
+#define _MMAP_H
+
+#include "fat32.h"
+#include "mmu.h"
+#include "tiny_types.h"
+
+/*
+ * Read-only file mappings, populated on demand. mmap_file() only reserves
+ * address space; the first touch of each page takes a translation fault
+ * that vm_fault() resolves from the page cache, reading ahead when the
+ * faults walk the file sequentially.
+ *
+ * Kernel mappings (kmmap) live in the KMAP slot of init_mm and are visible
+ * from every address space. Faulting on them may sleep, so kernel code
+ * must not touch them with a spinlock held; vm_fault() refuses such a
+ * fault, which leaves it fatal instead of a deadlock. The same goes for
+ * user mappings, which syscalls reach through bounce buffers filled before
+ * any lock is taken. kmap_reserve() hands out
+ * bare KMAP address space that the caller maps up front itself.
+ */
+
+void mmap_init(void);
+vaddr_t mmap_file(struct mm *mm, struct fat_file *f, int prot);
+const void *kmmap(const char *path, uint64_t *size);
+vaddr_t kmap_reserve(uint64_t len, uint64_t align);
+int vm_fault(vaddr_t addr, bool write, bool exec, bool user);
+void mmap_teardown(struct mm *mm);
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef _MMU_H
+#define _MMU_H
+
+/*
+ * Stage-1 translation for EL1, 4K granule, 39-bit VA (T0SZ = 25), so the
+ * walk starts at level 1 and each L1 entry covers 1GB. This header is also
+ * included from asm/startup.S, so keep the top half assembler-safe.
+ */
+
+#ifdef __ASSEMBLY__
+#define _UL(x) x
+#else
+#define _UL(x) x##UL
+#endif
+
+#define PAGE_SHIFT 12
+#define PAGE_SIZE (_UL(1) << PAGE_SHIFT)
+#define L1_BLOCK_SHIFT 30
+#define L1_BLOCK_SIZE (_UL(1) << L1_BLOCK_SHIFT)
+#define L2_BLOCK_SHIFT 21
+#define L2_BLOCK_SIZE (_UL(1) << L2_BLOCK_SHIFT)
+#define PTRS_PER_TABLE 512
+
+// MAIR_EL1 attribute indices
+#define MT_DEVICE_nGnRnE 0
+#define MT_DEVICE_nGnRE 1
+#define MT_NORMAL_NC 2
+#define MT_NORMAL 3
+#define MAIR_VALUE ((_UL(0x00) << (8 * MT_DEVICE_nGnRnE)) | \
+                    (_UL(0x04) << (8 * MT_DEVICE_nGnRE)) |  \
+                    (_UL(0x44) << (8 * MT_NORMAL_NC)) |     \
+                    (_UL(0xff) << (8 * MT_NORMAL)))
+
+// Descriptor bits
+#define PTE_VALID (_UL(1) << 0)
+#define PTE_TABLE (_UL(1) << 1) // L1/L2 table descriptor
+#define PTE_BLOCK (_UL(0) << 1) // L1/L2 block descriptor
+#define PTE_PAGE (_UL(1) << 1)  // L3 page descriptor
+#define PTE_ATTRINDX(x) (_UL(x) << 2)
+#define PTE_AP_EL0 (_UL(1) << 6) // EL0 accessible
+#define PTE_AP_RO (_UL(1) << 7)  // read-only
+#define PTE_SH_INNER (_UL(3) << 8)
+#define PTE_AF (_UL(1) << 10)
+#define PTE_NG (_UL(1) << 11)
+#define PTE_PXN (_UL(1) << 53)
+#define PTE_UXN (_UL(1) << 54)
+#define PTE_ADDR_MASK _UL(0x0000fffffffff000)
+#define PTE_SW_OWNED (_UL(1) << 55) // software bit: page freed with the mm
+#define PTE_TYPE_MASK _UL(3)
+
+#define PTE_KERNEL_BLOCK (PTE_VALID | PTE_BLOCK | PTE_ATTRINDX(MT_NORMAL) | \
+                          PTE_SH_INNER | PTE_AF | PTE_UXN)
+#define PTE_DEVICE_BLOCK (PTE_VALID | PTE_BLOCK | PTE_ATTRINDX(MT_DEVICE_nGnRE) | \
+                          PTE_AF | PTE_PXN | PTE_UXN)
+
+// TCR_EL1: T0SZ=25, WBWA inner/outer, inner shareable, 4K, TTBR1 walks off.
+// IPS is filled in from ID_AA64MMFR0_EL1.PARange at boot.
+#define TCR_T0SZ (_UL(25) << 0)
+#define TCR_IRGN0_WBWA (_UL(1) << 8)
+#define TCR_ORGN0_WBWA (_UL(1) << 10)
+#define TCR_SH0_INNER (_UL(3) << 12)
+#define TCR_TG0_4K (_UL(0) << 14)
+#define TCR_EPD1 (_UL(1) << 23)
+#define TCR_IPS_SHIFT 32
+#define TCR_VALUE (TCR_T0SZ | TCR_IRGN0_WBWA | TCR_ORGN0_WBWA | \
+                   TCR_SH0_INNER | TCR_TG0_4K | TCR_EPD1)
+
+// SCTLR_EL1 bits turned on at boot
+#define SCTLR_M (_UL(1) << 0)
+#define SCTLR_A (_UL(1) << 1)
+#define SCTLR_C (_UL(1) << 2)
+#define SCTLR_I (_UL(1) << 12)
+#define SCTLR_WXN (_UL(1) << 19)
+
+// Early identity map: L1 entry 0 is the device window (UART, GIC, virtio),
+// the following BOOT_RAM_GB entries are RAM starting at 1GB.
+#define BOOT_DEVICE_L1_INDEX 0
+#define BOOT_RAM_L1_INDEX 1
+#define BOOT_RAM_GB 4
+
+// EL0 address space: one L1 slot (1GB) well above the RAM identity map
+#define USER_L1_INDEX _UL(8)
+#define USER_BASE (USER_L1_INDEX << L1_BLOCK_SHIFT)
+#define USER_TEXT_BASE USER_BASE
+#define USER_STACK_TOP (USER_BASE + L1_BLOCK_SIZE)
+#define USER_STACK_PAGES 4
+#define USER_MMAP_BASE (USER_BASE + 0x10000000)
+#define USER_MMAP_END (USER_STACK_TOP - 0x1000000)
+
+// Kernel file mappings: one L1 slot whose L2 table is shared by every mm
+#define KMAP_L1_INDEX _UL(9)
+#define KMAP_BASE (KMAP_L1_INDEX << L1_BLOCK_SHIFT)
+#define KMAP_END (KMAP_BASE + L1_BLOCK_SIZE)
+
+// TTBR0_EL1.ASID, 8-bit ASIDs (TCR_EL1.AS = 0)
+#define ASID_BITS 8
+#define TTBR_ASID_SHIFT 48
+
+#ifndef __ASSEMBLY__
+
+#include "tiny_types.h"
+
+extern uint64_t boot_pgd[PTRS_PER_TABLE];
+
+// User page permissions for mm_map_page
+#define PROT_READ (1 << 0)
+#define PROT_WRITE (1 << 1)
+#define PROT_EXEC (1 << 2)
+#define PROT_KERNEL (1 << 3) // global, EL1-only mapping
+#define PROT_NOCACHE (1 << 4) // Normal non-cacheable, for non-coherent DMA
+
+#define MM_MAX_VMAS 8
+
+struct fat_file;
+
+// A file mapping, faulted in page by page (see mmap.c)
+struct vma
+{
+    vaddr_t start;
+    vaddr_t end;
+    struct fat_file *file;
+    int prot;
+    uint64_t ra_last;   // page index of the previous fault
+    uint32_t ra_window; // current read-ahead window, pages
+};
+
+struct mm
+{
+    uint64_t *pgd;     // L1 table: kernel identity entries + user slot
+    uint64_t context;  // ASID generation | ASID
+    struct vma vmas[MM_MAX_VMAS];
+    uint32_t nr_vmas;
+    vaddr_t mmap_next;
+};
+
+// The boot table, holding the kernel's own file mappings
+extern struct mm init_mm;
+
+struct mm *mm_create(void);
+void mm_destroy(struct mm *mm);
+int mm_map_page(struct mm *mm, vaddr_t va, paddr_t pa, int prot, bool owned);
+int mm_map_huge(struct mm *mm, vaddr_t va, paddr_t pa, uint64_t size, int prot, bool owned);
+void mm_unmap_page(struct mm *mm, vaddr_t va);
+uint64_t *mm_walk(struct mm *mm, vaddr_t va, bool alloc);
+void mm_switch(struct mm *mm);
+void mm_switch_kernel(void);
+
+#endif // __ASSEMBLY__
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef _NAPI_H
+#define _NAPI_H
+
+#include "tiny_types.h"
+
+/*
+ * NAPI-style interrupt mitigation for virtio drivers.
+ *
+ * In IRQ mode each device interrupt runs the driver's poll callback. Under
+ * ADAPTIVE (the default) the first interrupt instead masks the device and
+ * hands it to the poll thread on the dedicated poll CPU, which drains the
+ * used rings in batches of `budget`. Once a device has produced no work
+ * for `idle_ns` it goes back to interrupts. POLL never re-enables them.
+ */
+
+enum napi_policy
+{
+    NAPI_POLICY_IRQ,      // interrupt per batch, poll from the IRQ handler
+    NAPI_POLICY_ADAPTIVE, // switch to polling under load
+    NAPI_POLICY_POLL,     // always polled by the poll thread
+};
+
+enum napi_mode
+{
+    NAPI_MODE_IRQ,
+    NAPI_MODE_POLL,
+    NR_NAPI_MODES,
+};
+
+struct napi_stats
+{
+    uint64_t irqs;
+    uint64_t polls;       // poll callback invocations
+    uint64_t empty_polls; // ... that found nothing
+    uint64_t work;        // packets/requests handled
+    uint64_t to_poll;     // IRQ -> poll switches
+    uint64_t to_irq;      // poll -> IRQ switches
+    uint64_t ticks[NR_NAPI_MODES];
+};
+
+struct napi_struct
+{
+    const char *name;
+    int (*poll)(struct napi_struct *n, int budget); // returns work done
+    void (*irq_disable)(struct napi_struct *n);
+    bool (*irq_enable)(struct napi_struct *n);      // false: work raced in
+    void *priv;
+
+    int budget;
+    uint64_t idle_ns;
+    volatile enum napi_policy policy;
+    volatile enum napi_mode mode;
+    uint64_t mode_since; // CNTVCT at the last mode switch
+    uint64_t last_work;  // CNTVCT of the last poll that found work
+    struct napi_stats stats;
+};
+
+#define NAPI_DEFAULT_BUDGET 64
+#define NAPI_DEFAULT_IDLE_NS (200 * 1000ULL)
+#define NAPI_MAX_DEVICES 8
+
+int napi_init(int cpu);
+int napi_register(struct napi_struct *n);
+void napi_schedule(struct napi_struct *n);
+void napi_set_policy(struct napi_struct *n, enum napi_policy policy);
+struct napi_struct *napi_find(const char *name);
+void napi_dump(void);
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef _PAGE_ALLOC_H
+#define _PAGE_ALLOC_H
+
+#include "mmu.h"
+#include "tiny_types.h"
+
+// Buddy allocator over RAM above __image_end; largest block is 4MB
+#define MAX_ORDER 11
+
+#define PG_FREE (1 << 0)     // head of a free buddy block
+#define PG_RESERVED (1 << 1) // kernel image, page map, firmware
+#define PG_HUGE (1 << 2)     // head of a 1GB alloc_huge() block
+
+/*
+ * Huge blocks for large physically contiguous regions. A 2MB block is an
+ * ordinary order-9 buddy block. A 1GB block is bigger than the largest
+ * buddy order: alloc_huge() looks for a 1GB-aligned range whose max-order
+ * blocks are all free and takes them off the free lists in one go. Both
+ * are naturally aligned, so they can be mapped with a single L2 or L1
+ * block descriptor (mm_map_huge); the identity map already covers them
+ * with 1GB blocks.
+ */
+#define HUGE_2M_ORDER (L2_BLOCK_SHIFT - PAGE_SHIFT)
+
+// Per-page metadata, one entry per 4K page of the RAM bank
+struct page
+{
+    uint8_t order;
+    uint8_t flags;
+    uint16_t _rsvd;
+    uint32_t refcount;
+};
+
+void page_alloc_init(void);
+void *alloc_pages(uint32_t order);
+void *alloc_zeroed_pages(uint32_t order);
+void free_pages(void *addr, uint32_t order);
+struct page *virt_to_page(const void *addr);
+void *alloc_huge(uint64_t size);
+void free_huge(void *addr, uint64_t size);
+uint64_t page_alloc_free_pages(void);
+void page_alloc_dump(void);
+
+static inline void *alloc_page(void)
+{
+    return alloc_pages(0);
+}
+
+static inline void free_page(void *addr)
+{
+    free_pages(addr, 0);
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef _PAGECACHE_H
+#define _PAGECACHE_H
+
+#include "fat32.h"
+#include "mmu.h"
+#include "tiny_types.h"
+
+/*
+ * Page cache for FAT32 files, shared by every mapping of a file. Pages
+ * are read through the asynchronous block layer and looked up by
+ * (file, page index). Mappings are read-only, so a cached page is never
+ * dirty: under memory pressure a clock sweep drops cold pages, unmapping
+ * them first through a small reverse map of (mm, va) users.
+ */
+
+#define PC_MAX_PAGES 512
+#define PC_HASH_SIZE 128
+#define PC_MAX_MAPS 4           // reverse map slots; beyond that a page is pinned
+#define PC_MAX_IO 32            // page reads in flight
+#define PC_LOW_FREE_PAGES 256   // evict when the page allocator drops below this
+#define PC_EVICT_BATCH 16
+#define PC_RA_MIN 4             // first sequential read-ahead window, pages
+#define PC_RA_MAX 32
+
+enum pc_flags
+{
+    PC_UPTODATE = 1 << 0,
+    PC_IO = 1 << 1, // read in flight
+    PC_ERROR = 1 << 2,
+    PC_REFERENCED = 1 << 3, // second chance for the clock sweep
+};
+
+struct pc_map
+{
+    struct mm *mm;
+    vaddr_t va;
+};
+
+struct pc_page
+{
+    struct fat_file *file; // NULL while free
+    uint64_t index;
+    void *data;
+    uint32_t flags;
+    uint32_t refs;
+    uint32_t nr_maps; // > PC_MAX_MAPS: rmap overflowed, never evicted
+    struct pc_map maps[PC_MAX_MAPS];
+    struct pc_page *next; // hash chain or free list
+};
+
+struct pc_stats
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t readahead; // pages read ahead of a fault
+    uint64_t evicted;
+    uint64_t unmapped; // PTEs torn down by eviction
+    uint64_t io_errors;
+};
+
+void pagecache_init(void);
+struct pc_page *pagecache_get(struct fat_file *f, uint64_t index);
+void pagecache_put(struct pc_page *pg);
+void pagecache_readahead(struct fat_file *f, uint64_t index, uint32_t nr);
+int pagecache_map(struct pc_page *pg, struct mm *mm, vaddr_t va, int prot);
+void pagecache_forget_mm(struct mm *mm);
+uint32_t pagecache_shrink(uint32_t nr);
+void pagecache_dump(void);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef _PERCPU_H
+#define _PERCPU_H
+
+#include "config.h"
+#include "tiny_types.h"
+
+/*
+ * Per-CPU variables live in the .percpu section, which only serves as the
+ * initial template. percpu_init() copies it once per CPU into the
+ * __per_cpu_area reserved by link.lds; TPIDR_EL1 holds this CPU's offset
+ * from the template to its copy.
+ */
+#define DEFINE_PER_CPU(type, name) \
+    __attribute__((section(".percpu"))) type name
+
+// Starts on its own cache line, for data other CPUs write to
+#define DEFINE_PER_CPU_ALIGNED(type, name) \
+    __attribute__((section(".percpu"))) ____cacheline_aligned type name
+
+#define DECLARE_PER_CPU(type, name) extern type name
+
+extern uint64_t __per_cpu_offset[NR_CPUS];
+
+static inline uint64_t percpu_offset(void)
+{
+    uint64_t off;
+    __asm__ volatile("mrs %0, tpidr_el1" : "=r"(off));
+    return off;
+}
+
+#define this_cpu_ptr(ptr) \
+    ((__typeof__(ptr))((uintptr_t)(ptr) + percpu_offset()))
+
+#define per_cpu_ptr(ptr, cpu) \
+    ((__typeof__(ptr))((uintptr_t)(ptr) + __per_cpu_offset[(cpu)]))
+
+#define this_cpu_read(var) (*this_cpu_ptr(&(var)))
+#define this_cpu_write(var, val) (*this_cpu_ptr(&(var)) = (val))
+#define this_cpu_inc(var) ((*this_cpu_ptr(&(var)))++)
+#define per_cpu(var, cpu) (*per_cpu_ptr(&(var), (cpu)))
+
+void percpu_init(void);
+void percpu_setup_cpu(int cpu);
+
+#endif
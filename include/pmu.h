@@ -0,0 +1,85 @@
+#ifndef _PMU_H
+#define _PMU_H
+
+#include "tiny_types.h"
+
+/*
+ * PMUv3 event counters, used directly by the benchmarks. Counters are
+ * per CPU; the caller must stay on one CPU between start and read. Which
+ * events exist is advertised in PMCEID0/1_EL0; QEMU TCG only implements a
+ * few (cycles, instructions), so check pmu_event_supported() first.
+ */
+
+#define PMU_EV_L1D_TLB_REFILL 0x05
+#define PMU_EV_INST_RETIRED 0x08
+#define PMU_EV_CPU_CYCLES 0x11
+#define PMU_EV_L2D_TLB_REFILL 0x2d
+#define PMU_EV_DTLB_WALK 0x34
+
+#define PMCR_E (1UL << 0) // enable all counters
+#define PMCR_P (1UL << 1) // reset event counters
+#define PMCR_N_SHIFT 11
+#define PMCR_N_MASK 0x1f
+
+static inline uint32_t pmu_num_counters(void)
+{
+    uint64_t pmcr;
+
+    __asm__ volatile("mrs %0, pmcr_el0" : "=r"(pmcr));
+    return (pmcr >> PMCR_N_SHIFT) & PMCR_N_MASK;
+}
+
+// Common events 0x00-0x3f are advertised one bit each in PMCEID0/1
+static inline bool pmu_event_supported(uint32_t event)
+{
+    uint64_t ceid;
+
+    if (event < 32)
+        __asm__ volatile("mrs %0, pmceid0_el0" : "=r"(ceid));
+    else if (event < 64)
+        __asm__ volatile("mrs %0, pmceid1_el0" : "=r"(ceid));
+    else
+        return false;
+    return (ceid >> (event % 32)) & 1;
+}
+
+// Program counter idx for event and start it from zero, counting at all ELs
+static inline void pmu_counter_start(uint32_t idx, uint32_t event)
+{
+    uint64_t pmcr;
+
+    __asm__ volatile("msr pmselr_el0, %0\n\t"
+                     "isb\n\t"
+                     "msr pmxevtyper_el0, %1\n\t"
+                     "msr pmxevcntr_el0, xzr\n\t"
+                     "msr pmcntenset_el0, %2"
+                     :
+                     : "r"((uint64_t)idx), "r"((uint64_t)event), "r"(1UL << idx)
+                     : "memory");
+    __asm__ volatile("mrs %0, pmcr_el0" : "=r"(pmcr));
+    __asm__ volatile("msr pmcr_el0, %0\n\t"
+                     "isb" ::"r"(pmcr | PMCR_E)
+                     : "memory");
+}
+
+static inline uint64_t pmu_counter_read(uint32_t idx)
+{
+    uint64_t val;
+
+    __asm__ volatile("msr pmselr_el0, %1\n\t"
+                     "isb\n\t"
+                     "mrs %0, pmxevcntr_el0"
+                     : "=r"(val)
+                     : "r"((uint64_t)idx)
+                     : "memory");
+    return val;
+}
+
+static inline void pmu_counter_stop(uint32_t idx)
+{
+    __asm__ volatile("msr pmcntenclr_el0, %0\n\t"
+                     "isb" ::"r"(1UL << idx)
+                     : "memory");
+}
+
+#endif
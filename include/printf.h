@@ -103,6 +103,61 @@ extern "C"
      */
     int fctprintf(void (*out)(char character, void *arg), void *arg, const char *format, ...);
 
+/**
+ * Precompiled formats
+ * printf_compile() parses a format string once into a list of ops (a literal run followed by at
+ * most one conversion); snprintf_fmt() and friends then format records against it without
+ * parsing again. Compiled formats take the same conversions as snprintf_ except '*' width or
+ * precision and the floating point ones, which make printf_compile() fail.
+ * The format string must outlive the compiled format: literals point into it.
+ */
+#define PRINTF_FMT_MAX_OPS 16U
+
+    typedef struct
+    {
+        const char *lit;           // literal text before the conversion
+        unsigned short lit_len;
+        char spec;                 // conversion character, 0 for a trailing literal
+        unsigned char base;
+        unsigned int flags;
+        unsigned int width;
+        unsigned int precision;
+    } printf_op_t;
+
+    typedef struct
+    {
+        printf_op_t ops[PRINTF_FMT_MAX_OPS];
+        unsigned int nr_ops;
+        unsigned int nr_args;      // arguments one record consumes
+    } printf_fmt_t;
+
+    // One argument of a record for the array based calls; ints go in i or u
+    typedef union
+    {
+        long long i;
+        unsigned long long u;
+        const char *s;
+        const void *p;
+    } printf_arg_t;
+
+    /**
+     * Parse a format string into fmt
+     * \return 0, or -1 if the format has too many conversions or one that cannot be precompiled
+     */
+    int printf_compile(printf_fmt_t *fmt, const char *format);
+
+    /**
+     * snprintf_/vsnprintf_ against a precompiled format, same return value
+     */
+    int snprintf_fmt(char *buffer, size_t count, const printf_fmt_t *fmt, ...);
+    int vsnprintf_fmt(char *buffer, size_t count, const printf_fmt_t *fmt, va_list va);
+
+    /**
+     * Format nr records back to back, taking fmt->nr_args entries of args for each record
+     * \return The number of characters that COULD have been written, as for snprintf_
+     */
+    int snprintf_fmtv(char *buffer, size_t count, const printf_fmt_t *fmt, const printf_arg_t *args, size_t nr);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,49 @@
+#ifndef _RCU_H
+#define _RCU_H
+
+#include "atomic.h"
+#include "tiny_types.h"
+
+/*
+ * Quiescent-state based RCU.
+ *
+ * Kernel code is never preempted (only EL0 is), so a reader that does not
+ * sleep cannot be interrupted by a context switch. Read-side sections are
+ * therefore free: rcu_read_lock/unlock are compiler barriers, and the
+ * dependent load in rcu_dereference() is ordered by the address dependency.
+ *
+ * A CPU reports a quiescent state whenever it is provably outside any
+ * reader: entering schedule() or cond_resched(), the idle loop and IRQ
+ * exit towards EL0.
+ * An idle CPU sitting in wfi counts as quiescent for as long as it stays
+ * there. synchronize_rcu() starts a new grace period and waits until every
+ * other online CPU has reported since; call_rcu() hands the object to the
+ * "rcu" kthread, which batches callbacks behind one grace period.
+ *
+ * Writers serialise among themselves with their own lock and publish with
+ * rcu_assign_pointer(), a release store.
+ */
+
+struct rcu_head
+{
+    struct rcu_head *next;
+    void (*fn)(struct rcu_head *head);
+};
+
+#define rcu_read_lock() __asm__ volatile("" ::: "memory")
+#define rcu_read_unlock() __asm__ volatile("" ::: "memory")
+
+#define rcu_dereference(p) READ_ONCE(p)
+
+// Pointer-sized stlr: everything initialised before it is visible first
+#define rcu_assign_pointer(p, v) \
+    __asm__ volatile("stlr %1, %0" : "=Q"(p) : "r"(v) : "memory")
+
+void rcu_init(void);
+void rcu_quiescent_state(void);
+void rcu_idle_enter(void);
+void rcu_idle_exit(void);
+void synchronize_rcu(void);
+void call_rcu(struct rcu_head *head, void (*fn)(struct rcu_head *head));
+
+#endif
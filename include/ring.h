@@ -0,0 +1,154 @@
+#ifndef _RING_H
+#define _RING_H
+
+#include "atomic.h"
+#include "sched.h"
+#include "spin_lock.h"
+#include "tiny_types.h"
+
+/*
+ * Lock-free ring of 64-bit slots (pointers or handles), so tasks hand over
+ * buffers without copying them. Producer and consumer each own a head/tail
+ * pair on its own cache line:
+ *
+ *   head: slots reserved by the side (moved by CAS with several producers
+ *         or consumers, by a plain store for a single one)
+ *   tail: slots published to the other side, with release semantics
+ *
+ * Indices run freely and wrap at 2^32; size is a power of two so the slot
+ * is index & mask. With RING_F_DOORBELL a consumer can sleep until data
+ * arrives; producers then pay one barrier per burst and only take the
+ * wait lock when someone is actually asleep.
+ */
+
+#define RING_F_SP_ENQ (1 << 0) // single producer
+#define RING_F_SC_DEQ (1 << 1) // single consumer
+#define RING_F_SPSC (RING_F_SP_ENQ | RING_F_SC_DEQ)
+#define RING_F_DOORBELL (1 << 2) // consumers may sleep in ring_dequeue_wait
+
+struct ring_headtail
+{
+    volatile uint32_t head;
+    volatile uint32_t tail;
+};
+
+struct ring
+{
+    struct ring_headtail prod ____cacheline_aligned;
+    struct ring_headtail cons ____cacheline_aligned;
+
+    uint32_t size ____cacheline_aligned;
+    uint32_t mask;
+    uint32_t flags;
+    volatile uint32_t waiters; // consumers asleep on the doorbell
+    spinlock_t wait_lock;
+    struct wait_queue wq;
+
+    uint64_t slots[] ____cacheline_aligned;
+};
+
+// Bytes needed for a ring of `count` slots
+#define RING_BYTES(count) (sizeof(struct ring) + (count) * sizeof(uint64_t))
+
+int ring_init(struct ring *r, uint32_t count, uint32_t flags);
+struct ring *ring_create(uint32_t count, uint32_t flags);
+void ring_destroy(struct ring *r);
+void ring_doorbell(struct ring *r);
+uint32_t ring_dequeue_wait(struct ring *r, uint64_t *objs, uint32_t n);
+
+static inline uint32_t ring_count(const struct ring *r)
+{
+    return atomic_load_acquire32(&r->prod.tail) - READ_ONCE(r->cons.tail);
+}
+
+static inline uint32_t ring_free_count(const struct ring *r)
+{
+    return r->size - ring_count(r);
+}
+
+// Wait for earlier reservations on the same side, then publish ours
+static inline void __ring_publish(struct ring_headtail *ht, uint32_t old, uint32_t new,
+                                  bool single)
+{
+    if (!single)
+    {
+        while (READ_ONCE(ht->tail) != old)
+            cpu_relax();
+    }
+    atomic_store_release32(&ht->tail, new);
+}
+
+// Enqueue up to n objects, returns how many went in
+static inline uint32_t ring_enqueue_burst(struct ring *r, const uint64_t *objs, uint32_t n)
+{
+    bool single = r->flags & RING_F_SP_ENQ;
+    uint32_t head, free;
+
+    do
+    {
+        head = READ_ONCE(r->prod.head);
+        free = r->size + atomic_load_acquire32(&r->cons.tail) - head;
+        if (n > free)
+            n = free;
+        if (!n)
+            return 0;
+        if (single)
+        {
+            r->prod.head = head + n;
+            break;
+        }
+    } while (!atomic_cmpxchg32(&r->prod.head, head, head + n));
+
+    for (uint32_t i = 0; i < n; i++)
+        r->slots[(head + i) & r->mask] = objs[i];
+    __ring_publish(&r->prod, head, head + n, single);
+
+    // Pairs with the barrier in ring_dequeue_wait: either the consumer
+    // sees the new tail, or we see it waiting
+    if (r->flags & RING_F_DOORBELL)
+    {
+        smp_mb();
+        if (READ_ONCE(r->waiters))
+            ring_doorbell(r);
+    }
+    return n;
+}
+
+// Dequeue up to n objects, returns how many came out
+static inline uint32_t ring_dequeue_burst(struct ring *r, uint64_t *objs, uint32_t n)
+{
+    bool single = r->flags & RING_F_SC_DEQ;
+    uint32_t head, avail;
+
+    do
+    {
+        head = READ_ONCE(r->cons.head);
+        avail = atomic_load_acquire32(&r->prod.tail) - head;
+        if (n > avail)
+            n = avail;
+        if (!n)
+            return 0;
+        if (single)
+        {
+            r->cons.head = head + n;
+            break;
+        }
+    } while (!atomic_cmpxchg32(&r->cons.head, head, head + n));
+
+    for (uint32_t i = 0; i < n; i++)
+        objs[i] = r->slots[(head + i) & r->mask];
+    __ring_publish(&r->cons, head, head + n, single);
+    return n;
+}
+
+static inline bool ring_enqueue(struct ring *r, uint64_t obj)
+{
+    return ring_enqueue_burst(r, &obj, 1) == 1;
+}
+
+static inline bool ring_dequeue(struct ring *r, uint64_t *obj)
+{
+    return ring_dequeue_burst(r, obj, 1) == 1;
+}
+
+#endif
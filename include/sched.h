@@ -0,0 +1,124 @@
+#ifndef _SCHED_H
+#define _SCHED_H
+
+// struct cpu_context offsets, shared with asm/switch.S
+#define CTX_X19 0
+#define CTX_SP (12 * 8)
+#define CTX_PC (11 * 8)
+
+#ifndef __ASSEMBLY__
+
+#include "mmu.h"
+#include "percpu.h"
+#include "spin_lock.h"
+#include "timer.h"
+#include "tiny_types.h"
+
+#define TASK_STACK_ORDER 2 // 16KB: struct task at the bottom, stack on top
+#define TASK_STACK_SIZE (PAGE_SIZE << TASK_STACK_ORDER)
+#define MAX_TASKS 64
+#define TASK_NAME_LEN 16
+
+enum task_state
+{
+    TASK_RUNNING, // running or on a run queue
+    TASK_BLOCKED, // waiting on a wait queue or a timer
+    TASK_DEAD,
+};
+
+// Run queue priorities; the highest non-empty level always wins
+enum task_prio
+{
+    PRIO_HIGH,
+    PRIO_NORMAL,
+    PRIO_LOW,
+    NR_PRIO,
+};
+
+// Callee-saved state switched by cpu_switch_to
+struct cpu_context
+{
+    uint64_t x19, x20, x21, x22, x23, x24, x25, x26, x27, x28;
+    uint64_t fp; // x29
+    uint64_t pc; // x30
+    uint64_t sp;
+};
+
+struct mm;
+
+struct task
+{
+    struct cpu_context ctx; // must stay first, see switch.S
+    int pid;
+    int cpu;
+    enum task_state state;
+    enum task_prio prio;
+    bool on_rq;
+    struct task *rq_next;
+    struct task *wq_next;
+    struct mm *mm; // NULL for kernel threads
+    struct timer_event sleep_timer;
+    int exit_code;
+    char name[TASK_NAME_LEN];
+};
+
+struct wait_queue
+{
+    struct task *head;
+};
+
+struct run_queue
+{
+    spinlock_t lock;
+    struct task *head[NR_PRIO];
+    struct task *tail[NR_PRIO];
+    struct task *curr;
+    struct task *idle;
+    volatile bool need_resched;
+    uint64_t nr_switches;
+};
+
+DECLARE_PER_CPU(struct run_queue, runqueue);
+
+static inline struct task *get_current(void)
+{
+    return this_cpu_ptr(&runqueue)->curr;
+}
+#define current get_current()
+
+extern volatile uint64_t nr_user_tasks;
+
+void sched_init_cpu(void);
+void schedule(void);
+void schedule_tail(struct task *prev);
+void cond_resched(void);
+void sched_preempt_user(void);
+void sched_tick_handler(void);
+void sched_set_need_resched(void);
+void wake_up_task(struct task *t);
+void task_sleep_ns(uint64_t ns);
+void task_exit(int code) __attribute__((noreturn));
+void cpu_idle_once(void);
+bool sched_cpu_has_work(void);
+
+// pids map onto a fixed slot, which also indexes per-task side tables
+static inline int task_slot(int pid)
+{
+    return pid % MAX_TASKS;
+}
+
+typedef void (*kthread_fn_t)(void *arg);
+struct task *kthread_create(const char *name, kthread_fn_t fn, void *arg, int cpu,
+                            enum task_prio prio);
+struct task *task_create_user(const char *name, uint64_t entry, uint64_t arg,
+                              uint64_t lr, int cpu);
+void user_init(void);
+
+// Wait queues: the caller holds `lock`, which wait_queue_sleep drops
+// around the switch and re-takes before returning
+void wait_queue_sleep(struct wait_queue *wq, spinlock_t *lock);
+void wait_queue_wake_all(struct wait_queue *wq);
+
+#endif // __ASSEMBLY__
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef _SHELL_H
+#define _SHELL_H
+
+#include "tiny_types.h"
+
+/*
+ * UART console shell. The PL011 RX interrupt pushes bytes into an SPSC
+ * ring; a low-priority kernel thread sleeps on the ring's doorbell, edits
+ * the line and runs commands, so typing never delays other work.
+ *
+ * Commands are registered with SHELL_CMD() next to the code they drive;
+ * the descriptors land in the .shell_cmds section collected by link.lds.
+ * A command gets argv[0] = its name and returns 0 on success.
+ */
+
+#define SHELL_LINE_MAX 128
+#define SHELL_MAX_ARGS 8
+#define SHELL_RX_RING 256
+
+struct shell_cmd
+{
+    const char *name;
+    const char *help;
+    int (*fn)(int argc, char **argv);
+};
+
+#define SHELL_CMD(_name, _help, _fn)                                      \
+    static const struct shell_cmd __shell_cmd_##_name                     \
+        __attribute__((used, section(".shell_cmds"), aligned(8))) = {     \
+            .name = #_name,                                               \
+            .help = _help,                                                \
+            .fn = _fn,                                                    \
+    }
+
+int shell_init(int cpu);
+bool shell_halt_requested(void);
+
+#endif
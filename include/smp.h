@@ -0,0 +1,27 @@
+#ifndef _SMP_H
+#define _SMP_H
+
+#include "config.h"
+#include "tiny_types.h"
+
+// QEMU virt numbers CPUs linearly in MPIDR.Aff0 (up to 8 per cluster)
+static inline int smp_processor_id(void)
+{
+    uint64_t mpidr;
+    __asm__ volatile("mrs %0, mpidr_el1" : "=r"(mpidr));
+    return (int)(mpidr & 0xff);
+}
+
+extern volatile uint64_t cpu_online_mask;
+
+#define cpu_online(cpu) (((cpu_online_mask) >> (cpu)) & 1)
+
+#define for_each_online_cpu(cpu)          \
+    for ((cpu) = 0; (cpu) < NR_CPUS; (cpu)++) \
+        if (cpu_online(cpu))
+
+int smp_init(void);
+int num_online_cpus(void);
+void secondary_main(uint64_t cpu);
+
+#endif
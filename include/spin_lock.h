@@ -1,6 +1,8 @@
 #ifndef SPINLOCK_H
 #define SPINLOCK_H
 
+#include "percpu.h"
+
 typedef struct
 {
     volatile int lock;
@@ -14,4 +16,36 @@ extern void spin_lock(spinlock_t *lock);
 extern int spin_trylock(spinlock_t *lock);
 extern void spin_unlock(spinlock_t *lock);
 
+// Spinlocks this CPU holds, kept by asm/spinlock.S. Nothing may sleep while
+// it is non-zero: the kernel is not preemptible, so the next task to want
+// the same lock would spin forever.
+DECLARE_PER_CPU(uint32_t, spin_lock_depth);
+
+static inline bool in_spinlock(void)
+{
+    return this_cpu_read(spin_lock_depth) != 0;
+}
+
+/*
+ * Reader-writer lock (asm/spinlock.S): bit 31 is the writer, the low bits
+ * count readers. Readers share the lock word, so every read_lock still
+ * bounces its cache line between CPUs; see rcu.h for read-mostly data.
+ * A steady stream of readers can starve a writer.
+ */
+#define RW_LOCK_WRITER 0x80000000U
+
+typedef struct
+{
+    volatile unsigned int lock;
+} rwlock_t;
+
+static inline void rwlock_init(rwlock_t *lock)
+{
+    lock->lock = 0;
+}
+extern void read_lock(rwlock_t *lock);
+extern void read_unlock(rwlock_t *lock);
+extern void write_lock(rwlock_t *lock);
+extern void write_unlock(rwlock_t *lock);
+
 #endif // SPINLOCK_H
@@ -0,0 +1,56 @@
+#ifndef _STATS_H
+#define _STATS_H
+
+#include "percpu.h"
+#include "tiny_types.h"
+
+/*
+ * Per-CPU event counters.
+ *
+ * A counter is one plain uint64_t per CPU, bumped by its own CPU with an
+ * ordinary load/add/store: no atomics, no barriers, no shared cache line.
+ * Readers sum the per-CPU copies, so a total is a snapshot that may be a
+ * few events behind. A counter bumped from both task and IRQ context on
+ * the same CPU can lose an increment to that race.
+ *
+ * DEFINE_STAT() also places a descriptor in the .stats section, collected
+ * by link.lds between __stats_start and __stats_end, so a new counter
+ * needs no central list. STAT_REGISTER() exposes an existing per-CPU
+ * uint64_t (e.g. a field of a per-CPU struct) the same way.
+ */
+struct stat_desc
+{
+    const char *name;
+    const char *desc;
+    uint64_t *pcpu; // per-CPU template address
+};
+
+#define STAT_REGISTER(_name, _desc, _pcpu)                                \
+    static const struct stat_desc __stat_##_name                          \
+        __attribute__((used, section(".stats"), aligned(8))) = {          \
+            .name = #_name,                                               \
+            .desc = _desc,                                                \
+            .pcpu = (_pcpu),                                              \
+    }
+
+#define DEFINE_STAT(_name, _desc)           \
+    DEFINE_PER_CPU(uint64_t, stat_##_name); \
+    STAT_REGISTER(_name, _desc, &stat_##_name)
+
+#define DECLARE_STAT(_name) DECLARE_PER_CPU(uint64_t, stat_##_name)
+
+#define stat_inc(_name) this_cpu_inc(stat_##_name)
+#define stat_add(_name, _n) (*this_cpu_ptr(&stat_##_name) += (_n))
+
+enum stats_format
+{
+    STATS_HUMAN,
+    STATS_JSON,
+};
+
+uint64_t stat_read(const struct stat_desc *sd);
+const struct stat_desc *stat_find(const char *name);
+void stats_dump(enum stats_format fmt);
+int stats_start_periodic(uint64_t period_ms, enum stats_format fmt);
+
+#endif
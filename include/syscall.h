@@ -0,0 +1,47 @@
+#ifndef _SYSCALL_H
+#define _SYSCALL_H
+
+/*
+ * Syscall ABI: number in x8, arguments in x0-x5, result in x0.
+ * EL0 svc takes the fast path in asm/exception.S, which indexes
+ * syscall_table directly; everything else goes through the C decoder.
+ */
+#define SYS_NULL 0
+#define SYS_WRITE 1
+#define SYS_SLEEP 2
+#define SYS_SEND 3
+#define SYS_RECV 4
+#define SYS_EXIT 5
+#define SYS_GETPID 6
+#define SYS_MMAP 7
+#define NR_SYSCALLS 16
+
+#define ENOENT 2
+#define ESRCH 3
+#define ENOMEM 12
+#define EFAULT 14
+#define EINVAL 22
+#define ENOSYS 38
+
+// Largest message carried by SYS_SEND/SYS_RECV
+#define MSG_MAX 64
+
+#ifndef __ASSEMBLY__
+
+#include "exception.h"
+#include "tiny_types.h"
+
+typedef int64_t (*syscall_fn_t)(uint64_t a0, uint64_t a1, uint64_t a2,
+                                 uint64_t a3, uint64_t a4, uint64_t a5);
+
+extern const syscall_fn_t syscall_table[NR_SYSCALLS];
+
+void syscall_dispatch(struct trap_frame *frame);
+
+// Per-pid mailbox lifetime, driven by task creation and exit
+void mailbox_open(int pid);
+void mailbox_close(int pid);
+
+#endif // __ASSEMBLY__
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef _TIMER_H
+#define _TIMER_H
+
+#include "tiny_types.h"
+
+#define NSEC_PER_SEC 1000000000ULL
+#define NSEC_PER_MSEC 1000000ULL
+#define NSEC_PER_USEC 1000ULL
+
+// ARM generic timer: virtual counter value
+static inline uint64_t read_cntvct(void)
+{
+    uint64_t val;
+    __asm__ volatile("isb\n\t"
+                     "mrs %0, cntvct_el0"
+                     : "=r"(val)
+                     :
+                     : "memory");
+    return val;
+}
+
+// ARM generic timer: counter frequency in Hz
+static inline uint64_t read_cntfrq(void)
+{
+    uint64_t val;
+    __asm__ volatile("mrs %0, cntfrq_el0" : "=r"(val));
+    return val;
+}
+
+// Split the conversion so that ticks * 1e9 cannot overflow
+static inline uint64_t ticks_to_ns(uint64_t ticks)
+{
+    uint64_t freq = read_cntfrq();
+    return (ticks / freq) * NSEC_PER_SEC + (ticks % freq) * NSEC_PER_SEC / freq;
+}
+
+static inline uint64_t ns_to_ticks(uint64_t ns)
+{
+    uint64_t freq = read_cntfrq();
+    return (ns / NSEC_PER_SEC) * freq + (ns % NSEC_PER_SEC) * freq / NSEC_PER_SEC;
+}
+
+// One-shot software timers, kept per CPU and driven by the EL1 virtual timer
+struct timer_event
+{
+    uint64_t deadline; // CNTVCT ticks
+    void (*fn)(struct timer_event *ev);
+    void *data;
+    struct timer_event *next;
+    bool armed;
+};
+
+#define SCHED_TICK_NS (10 * 1000 * 1000ULL)
+
+void timer_init_cpu(void);
+void timer_add(struct timer_event *ev, uint64_t deadline);
+void timer_cancel(struct timer_event *ev);
+uint64_t timer_next_deadline(void);
+
+#endif
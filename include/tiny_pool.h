@@ -0,0 +1,59 @@
+#ifndef _TINY_POOL_H
+#define _TINY_POOL_H
+
+#include "config.h"
+#include "tiny_types.h"
+
+/*
+ * Fixed-size object pools, safe to use from IRQ context.
+ *
+ * All objects are carved out of pages at tiny_pool_create() time; nothing
+ * is allocated afterwards. Each CPU keeps a small front cache of free
+ * objects in the pool, touched only with local IRQs masked, so the common
+ * alloc/free is a handful of instructions with no shared cache line.
+ *
+ * Behind the caches sits a shared lock-free LIFO. Its head packs a 32-bit
+ * generation tag above the 32-bit object index (index + 1, 0 = empty),
+ * and every push or pop bumps the tag in the same ldaxr/stlxr CAS, so a
+ * head that was popped and pushed back in between (ABA) does not match.
+ * A free object stores the index of the next one in its first 4 bytes.
+ *
+ * The caches refill and drain TINY_POOL_BATCH objects at a time.
+ * "exhausted" counts allocations that found the pool empty; the high
+ * watermark is the most objects ever off the shared list, cached ones
+ * included.
+ */
+
+#define TINY_POOL_MAX 16
+#define TINY_POOL_CACHE 16
+#define TINY_POOL_BATCH 8
+#define TINY_POOL_NAME_LEN 16
+
+struct tiny_pool_cache
+{
+    uint32_t count;
+    void *objs[TINY_POOL_CACHE];
+    uint64_t allocs;
+    uint64_t frees;
+} ____cacheline_aligned;
+
+struct tiny_pool
+{
+    volatile uint64_t head; // tag << 32 | (index + 1)
+    volatile uint64_t nr_free; // objects on the shared list
+    volatile uint64_t high_watermark;
+    volatile uint64_t exhausted;
+    uint8_t *base;
+    uint32_t obj_size;
+    uint32_t nr_objs;
+    uint32_t order; // pages backing the objects
+    char name[TINY_POOL_NAME_LEN];
+    struct tiny_pool_cache cache[NR_CPUS];
+};
+
+struct tiny_pool *tiny_pool_create(const char *name, uint32_t obj_size, uint32_t nr_objs);
+void *tiny_pool_alloc(struct tiny_pool *pool);
+void tiny_pool_free(struct tiny_pool *pool, void *obj);
+void tiny_pool_dump(void);
+
+#endif
@@ -8,6 +8,10 @@ typedef unsigned short       uint16_t;
 typedef unsigned int         uint32_t;
 typedef unsigned long long   uint64_t;
 typedef unsigned long int	uintptr_t;
+typedef signed char          int8_t;
+typedef short                int16_t;
+typedef int                  int32_t;
+typedef long long            int64_t;
 
 typedef    _Bool  bool;
 
@@ -19,6 +23,19 @@ typedef    _Bool  bool;
 #define MIN(a, b)		((a) < (b) ? (a) : (b))
 #define MAX(a, b)		((a) > (b) ? (a) : (b))
 
+#define L1_CACHE_SHIFT 6
+#define L1_CACHE_BYTES (1 << L1_CACHE_SHIFT)
+
+// Plain alignment, for struct types and members: also pads sizeof() of a
+// struct up to a whole line
+#define ____cacheline_aligned __attribute__((aligned(L1_CACHE_BYTES)))
+// Global variables that get a cache line of their own: everything in this
+// section is line aligned, so no two of them can share a line
+#define __cacheline_aligned \
+    __attribute__((aligned(L1_CACHE_BYTES), section(".data.cacheline_aligned")))
+// Written once at boot, read on hot paths: keep away from written data
+#define __read_mostly __attribute__((section(".data.read_mostly")))
+
 #define vaddr_t uint64_t
 #define paddr_t uint64_t
 
@@ -1,7 +1,21 @@
 #ifndef _TINYIO_H
 #define _TINYIO_H
+#include "jump_label.h"
 #include "printf.h"
 
+void tiny_io_init(void);
+void tiny_io_set_base(unsigned long base);
+void uart_putchar(char c);
+void uart_write(const char *buf, size_t len);
+void uart_putchar_nonlock(char c);
+int uart_getc(void);
+void uart_rx_irq_enable(void);
+void uart_rx_irq_ack(void);
+
+// Vectored printf: nr records of a precompiled format, one UART write
+#define TINY_PRINTV_BUF 1024
+int tiny_printv(const printf_fmt_t *fmt, const printf_arg_t *args, size_t nr);
+
 // Log level definitions
 #define LOG_LEVEL_NONE 0
 #define LOG_LEVEL_ERROR 1
@@ -21,15 +35,51 @@
 #define LOG_NAME_INFO "INFO "
 #define LOG_NAME_DEBUG "DEBUG"
 
+/*
+ * Runtime log levels, one per module (source file). Every translation unit
+ * that includes this header gets its own log_module in the .log_modules
+ * section, named by -DLOG_MODULE from the Makefile, with one static key per
+ * level. A call site is a nop while its level is off for the module, so
+ * disabled tiny_debug()s cost nothing but the nop. LOG_LEVEL stays the hard
+ * ceiling: sites above it are not compiled at all and log_set_level()
+ * never raises a module past it.
+ */
+#ifndef LOG_MODULE
+#define LOG_MODULE "kernel"
+#endif
+
+struct log_module
+{
+    const char *name;
+    int level;
+    struct static_key keys[LOG_LEVEL_DEBUG]; // keys[n - 1] on: level n is printed
+};
+
+static struct log_module __log_module __attribute__((used, section(".log_modules"), aligned(8))) = {
+    .name = LOG_MODULE,
+    .level = LOG_LEVEL,
+    .keys = {
+        {.enabled = LOG_LEVEL >= LOG_LEVEL_ERROR},
+        {.enabled = LOG_LEVEL >= LOG_LEVEL_WARN},
+        {.enabled = LOG_LEVEL >= LOG_LEVEL_INFO},
+        {.enabled = LOG_LEVEL >= LOG_LEVEL_DEBUG},
+    },
+};
+
+const char *log_level_name(int level);
+int log_level_parse(const char *s);
+int log_set_level(const char *module, int level);
+void log_dump_levels(void);
+
 // Base logging macro with level check
-#define _tiny_log_base(level, level_name, color_start, color_end, format, ...) \
-    do                                                                         \
-    {                                                                          \
-        if (LOG_LEVEL >= level)                                                \
-        {                                                                      \
-            printf("[%s][%s:%d] " color_start format color_end,                \
-                   level_name, __FILE__, __LINE__, ##__VA_ARGS__);             \
-        }                                                                      \
+#define _tiny_log_base(level, level_name, color_start, color_end, format, ...)   \
+    do                                                                           \
+    {                                                                            \
+        if (LOG_LEVEL >= level && static_branch_unlikely(&__log_module.keys[level - 1])) \
+        {                                                                        \
+            printf("[%s][%s:%d] " color_start format color_end,                  \
+                   level_name, __FILE__, __LINE__, ##__VA_ARGS__);               \
+        }                                                                        \
     } while (0)
 
 // Individual log level macros
@@ -4,6 +4,36 @@
 #include "tinyio.h"
 #include "tiny_types.h"
 
+// Freestanding string helpers (src/string.c); gcc may also emit calls to these
+void *memset(void *dst, int c, size_t n);
+void *memcpy(void *dst, const void *src, size_t n);
+int memcmp(const void *a, const void *b, size_t n);
+size_t strlen(const char *s);
+int strcmp(const char *a, const char *b);
+int strncmp(const char *a, const char *b, size_t n);
+
+/*
+ * MMIO accessors. read8..write64 are single volatile accesses with no
+ * ordering of their own. Device memory (nGnRE) already keeps accesses to
+ * one device in program order; what the barriers below add is ordering
+ * against Normal memory: DMA buffers, rings and IPI payloads.
+ *
+ *  - *_relaxed(): no barrier, for registers that only carry their value
+ *    (configuration, FIFO data, interrupt acks).
+ *  - readX(): dmb oshld after the load, so later reads of memory the
+ *    device wrote are at least as new as the register value.
+ *  - writeX(): dmb oshst before the store, so memory written earlier is
+ *    visible to the device before the register write (doorbells).
+ *  - writel_batch(): one dmb oshst, then a list of relaxed writes.
+ *
+ * None of these wait for completion; a write whose side effect must have
+ * happened before the CPU goes on (e.g. masking an interrupt) needs
+ * mmio_complete(), a dsb.
+ */
+#define __iormb() __asm__ volatile("dmb oshld" ::: "memory")
+#define __iowmb() __asm__ volatile("dmb oshst" ::: "memory")
+#define mmio_complete() __asm__ volatile("dsb sy" ::: "memory")
+
 static inline uint8_t read8(const volatile void *addr)
 {
     return *(const volatile uint8_t *)addr;
@@ -44,8 +74,88 @@ static inline void write64(uint64_t value, volatile void *addr)
     *(volatile uint64_t *)addr = value;
 }
 
-// PSCI function IDs for system shutdown
+#define readb_relaxed(addr) read8(addr)
+#define readw_relaxed(addr) read16(addr)
+#define readl_relaxed(addr) read32(addr)
+#define readq_relaxed(addr) read64(addr)
+#define writeb_relaxed(value, addr) write8(value, addr)
+#define writew_relaxed(value, addr) write16(value, addr)
+#define writel_relaxed(value, addr) write32(value, addr)
+#define writeq_relaxed(value, addr) write64(value, addr)
+
+static inline uint8_t readb(const volatile void *addr)
+{
+    uint8_t value = read8(addr);
+
+    __iormb();
+    return value;
+}
+
+static inline uint16_t readw(const volatile void *addr)
+{
+    uint16_t value = read16(addr);
+
+    __iormb();
+    return value;
+}
+
+static inline uint32_t readl(const volatile void *addr)
+{
+    uint32_t value = read32(addr);
+
+    __iormb();
+    return value;
+}
+
+static inline uint64_t readq(const volatile void *addr)
+{
+    uint64_t value = read64(addr);
+
+    __iormb();
+    return value;
+}
+
+static inline void writeb(uint8_t value, volatile void *addr)
+{
+    __iowmb();
+    write8(value, addr);
+}
+
+static inline void writew(uint16_t value, volatile void *addr)
+{
+    __iowmb();
+    write16(value, addr);
+}
+
+static inline void writel(uint32_t value, volatile void *addr)
+{
+    __iowmb();
+    write32(value, addr);
+}
+
+static inline void writeq(uint64_t value, volatile void *addr)
+{
+    __iowmb();
+    write64(value, addr);
+}
+
+// One register write of a batch, at base + off
+struct mmio_write
+{
+    uint32_t off;
+    uint32_t value;
+};
+
+static inline void writel_batch(volatile void *base, const struct mmio_write *w, size_t n)
+{
+    __iowmb();
+    for (size_t i = 0; i < n; i++)
+        write32(w[i].value, (volatile uint8_t *)base + w[i].off);
+}
+
+// PSCI function IDs for system shutdown and secondary CPU bring-up
 #define PSCI_SYSTEM_OFF 0x84000008
+#define PSCI_CPU_ON_64 0xc4000003
 
 // ARM64 system shutdown function using PSCI
 static inline void system_shutdown(void)
@@ -0,0 +1,78 @@
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include "config.h"
+
+/*
+ * Flight recorder: an always-on ring of compact binary events per CPU.
+ *
+ * Each entry is 16 bytes, stamped with CNTVCT inside an IRQ-masked
+ * section, so a CPU's ring is in timestamp order and the rings of all
+ * CPUs merge on the common system counter. The oldest entries are
+ * overwritten; nothing is ever allocated or locked on the record path.
+ *
+ *   event          a                      b
+ *   irq_enter/exit -                      interrupt number
+ *   switch         previous pid           next pid
+ *   lock_acquire   spin iterations (*)    lock address, low 32 bits
+ *   lock_release   -                      lock address, low 32 bits
+ *   vq_kick        TRACE_VQ_ID            1 if the device was notified
+ *   vq_complete    TRACE_VQ_ID            bytes written by the device
+ *
+ * (*) LOCKPROF=1 builds only; 0 otherwise.
+ *
+ * Lock events are emitted by asm/spinlock.S for every spinlock (not the
+ * rwlocks): a byte load and a branch while tracing is off, a call into
+ * __trace_event() while it is on.
+ *
+ * trace_dump() prints JSON lines (a trace_meta header, then one "trace"
+ * line per event, oldest first); scripts/trace2perfetto.py turns a
+ * captured console log into Chrome/Perfetto trace JSON, keyed on the
+ * event names trace.c prints.
+ */
+
+#define TRACE_RING_EVENTS 2048 // per CPU, power of two
+
+// Event types; shared with asm/spinlock.S
+#define TRACE_NONE 0
+#define TRACE_IRQ_ENTER 1
+#define TRACE_IRQ_EXIT 2
+#define TRACE_SWITCH 3
+#define TRACE_LOCK_ACQUIRE 4
+#define TRACE_LOCK_RELEASE 5
+#define TRACE_VQ_KICK 6
+#define TRACE_VQ_COMPLETE 7
+#define NR_TRACE_TYPES 8
+
+#ifndef __ASSEMBLY__
+
+#include "tiny_types.h"
+
+#define TRACE_VQ_ID(slot, index) (((slot) << 8) | ((index) & 0xff))
+
+struct trace_entry
+{
+    uint64_t ts; // CNTVCT
+    uint8_t type;
+    uint8_t cpu;
+    uint16_t a;
+    uint32_t b;
+};
+
+extern volatile bool trace_on;
+
+void __trace_event(uint32_t type, uint32_t a, uint32_t b);
+
+static inline void trace_event(uint32_t type, uint32_t a, uint32_t b)
+{
+    if (trace_on)
+        __trace_event(type, a, b);
+}
+
+void trace_set(bool on);
+void trace_clear(void);
+void trace_dump(uint32_t last); // last events per CPU, 0 = the whole ring
+
+#endif // __ASSEMBLY__
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef _ULIB_H
+#define _ULIB_H
+
+/*
+ * EL0 side of the syscall ABI (see syscall.h). Everything here is inline:
+ * user code is linked at USER_TEXT_BASE and cannot call into the kernel
+ * image, so it must not depend on kernel helpers such as memcpy.
+ */
+
+#include "syscall.h"
+#include "tiny_types.h"
+
+static inline int64_t __syscall3(uint64_t nr, uint64_t a0, uint64_t a1, uint64_t a2)
+{
+    register uint64_t x8 __asm__("x8") = nr;
+    register uint64_t x0 __asm__("x0") = a0;
+    register uint64_t x1 __asm__("x1") = a1;
+    register uint64_t x2 __asm__("x2") = a2;
+
+    __asm__ volatile("svc #0" : "+r"(x0) : "r"(x8), "r"(x1), "r"(x2) : "memory");
+    return (int64_t)x0;
+}
+
+static inline int64_t u_write(const char *buf, uint64_t len)
+{
+    return __syscall3(SYS_WRITE, (uint64_t)buf, len, 0);
+}
+
+static inline int64_t u_sleep_ms(uint64_t ms)
+{
+    return __syscall3(SYS_SLEEP, ms, 0, 0);
+}
+
+static inline int64_t u_send(int pid, const void *buf, uint64_t len)
+{
+    return __syscall3(SYS_SEND, pid, (uint64_t)buf, len);
+}
+
+static inline int64_t u_recv(void *buf, uint64_t len, int *from)
+{
+    return __syscall3(SYS_RECV, (uint64_t)buf, len, (uint64_t)from);
+}
+
+static inline void u_exit(int code)
+{
+    __syscall3(SYS_EXIT, code, 0, 0);
+    while (1)
+        ;
+}
+
+static inline int u_getpid(void)
+{
+    return (int)__syscall3(SYS_GETPID, 0, 0, 0);
+}
+
+// Read-only file mapping; returns the address or a negative error
+static inline int64_t u_mmap(const char *path, uint64_t *size)
+{
+    return __syscall3(SYS_MMAP, (uint64_t)path, (uint64_t)size, 0);
+}
+
+// Line buffer, so that one line goes out in a single SYS_WRITE
+struct uline
+{
+    uint32_t len;
+    char buf[96];
+};
+
+static inline void uline_puts(struct uline *l, const char *s)
+{
+    while (*s && l->len < sizeof(l->buf))
+        l->buf[l->len++] = *s++;
+}
+
+static inline void uline_putu(struct uline *l, uint64_t v)
+{
+    char tmp[20];
+    int n = 0;
+
+    do
+    {
+        tmp[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v);
+    while (n && l->len < sizeof(l->buf))
+        l->buf[l->len++] = tmp[--n];
+}
+
+static inline void uline_flush(struct uline *l)
+{
+    u_write(l->buf, l->len);
+    l->len = 0;
+}
+
+// Programs in src/user; the entry gets one argument in x0
+void user_exit_stub(void);
+void user_hello(uint64_t arg);
+void user_ping(uint64_t peer);
+void user_pong(uint64_t arg);
+void user_mapcat(uint64_t arg);
+
+/*
+ * Kernel side: the user image is linked more than 4GB away from the
+ * kernel, out of adrp range, so take entry addresses from a literal pool.
+ */
+#define USER_SYM_ADDR(sym)                                \
+    ({                                                    \
+        uint64_t __addr;                                  \
+        __asm__("ldr %0, =" #sym : "=r"(__addr));         \
+        __addr;                                           \
+    })
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef _VIRTIO_H
+#define _VIRTIO_H
+
+#include "dma.h"
+#include "tiny_types.h"
+#include "tinystd.h"
+
+// virtio-mmio register layout (legacy v1 and modern v2)
+#define VIRTIO_MMIO_MAGIC 0x000
+#define VIRTIO_MMIO_VERSION 0x004
+#define VIRTIO_MMIO_DEVICE_ID 0x008
+#define VIRTIO_MMIO_VENDOR_ID 0x00c
+#define VIRTIO_MMIO_DEVICE_FEATURES 0x010
+#define VIRTIO_MMIO_DEVICE_FEATURES_SEL 0x014
+#define VIRTIO_MMIO_DRIVER_FEATURES 0x020
+#define VIRTIO_MMIO_DRIVER_FEATURES_SEL 0x024
+#define VIRTIO_MMIO_GUEST_PAGE_SIZE 0x028 // v1 only
+#define VIRTIO_MMIO_QUEUE_SEL 0x030
+#define VIRTIO_MMIO_QUEUE_NUM_MAX 0x034
+#define VIRTIO_MMIO_QUEUE_NUM 0x038
+#define VIRTIO_MMIO_QUEUE_ALIGN 0x03c // v1 only
+#define VIRTIO_MMIO_QUEUE_PFN 0x040   // v1 only
+#define VIRTIO_MMIO_QUEUE_READY 0x044
+#define VIRTIO_MMIO_QUEUE_NOTIFY 0x050
+#define VIRTIO_MMIO_INTERRUPT_STATUS 0x060
+#define VIRTIO_MMIO_INTERRUPT_ACK 0x064
+#define VIRTIO_MMIO_STATUS 0x070
+#define VIRTIO_MMIO_QUEUE_DESC_LOW 0x080
+#define VIRTIO_MMIO_QUEUE_DESC_HIGH 0x084
+#define VIRTIO_MMIO_QUEUE_AVAIL_LOW 0x090
+#define VIRTIO_MMIO_QUEUE_AVAIL_HIGH 0x094
+#define VIRTIO_MMIO_QUEUE_USED_LOW 0x0a0
+#define VIRTIO_MMIO_QUEUE_USED_HIGH 0x0a4
+#define VIRTIO_MMIO_CONFIG 0x100
+
+#define VIRTIO_MMIO_MAGIC_VALUE 0x74726976 // "virt"
+
+#define VIRTIO_STATUS_ACK 1
+#define VIRTIO_STATUS_DRIVER 2
+#define VIRTIO_STATUS_DRIVER_OK 4
+#define VIRTIO_STATUS_FEATURES_OK 8
+#define VIRTIO_STATUS_FAILED 128
+
+#define VIRTIO_INT_USED (1 << 0)
+#define VIRTIO_INT_CONFIG (1 << 1)
+
+#define VIRTIO_ID_NET 1
+#define VIRTIO_ID_BLK 2
+
+#define VIRTIO_F_VERSION_1 32
+
+// Split virtqueue
+#define VRING_DESC_F_NEXT 1
+#define VRING_DESC_F_WRITE 2
+#define VRING_AVAIL_F_NO_INTERRUPT 1
+#define VRING_USED_F_NO_NOTIFY 1
+#define VRING_ALIGN 4096
+
+struct vring_desc
+{
+    uint64_t addr;
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+};
+
+struct vring_avail
+{
+    uint16_t flags;
+    volatile uint16_t idx;
+    uint16_t ring[];
+};
+
+struct vring_used_elem
+{
+    uint32_t id;
+    uint32_t len;
+};
+
+struct vring_used
+{
+    volatile uint16_t flags;
+    volatile uint16_t idx;
+    struct vring_used_elem ring[];
+};
+
+// Device memory is coherent on QEMU virt; ordering only needs dmb
+#define virtio_wmb() __asm__ volatile("dmb oshst" ::: "memory")
+#define virtio_rmb() __asm__ volatile("dmb oshld" ::: "memory")
+#define virtio_mb() __asm__ volatile("dmb osh" ::: "memory")
+
+struct virtio_dev;
+
+/*
+ * One split virtqueue. Not locked: each driver serialises its own queues.
+ * cookies[head] is handed back by virtqueue_get() when the chain that
+ * starts at descriptor `head` completes.
+ */
+struct virtqueue
+{
+    struct virtio_dev *dev;
+    uint32_t index;
+    uint32_t num;
+    struct vring_desc *desc;
+    struct vring_avail *avail;
+    struct vring_used *used;
+    uint16_t free_head;
+    uint16_t num_free;
+    uint16_t last_used;
+    void **cookies;
+    uint64_t notifies;
+    uint64_t notifies_skipped;
+};
+
+// One scatter-gather element of a request
+struct vq_buf
+{
+    paddr_t addr;
+    uint32_t len;
+    bool write; // device writes into it
+};
+
+struct virtio_dev
+{
+    uintptr_t base;
+    uint32_t irq;
+    uint32_t device_id;
+    uint32_t version; // 1: legacy, 2: modern
+    uint64_t features;
+    int slot;
+    struct dma_dev dma;
+    void *priv;
+};
+
+// Relaxed: ring memory is ordered explicitly (virtio_*mb, writel_batch)
+static inline uint32_t virtio_read32(struct virtio_dev *dev, uint32_t off)
+{
+    return readl_relaxed((volatile void *)(dev->base + off));
+}
+
+static inline void virtio_write32(struct virtio_dev *dev, uint32_t off, uint32_t val)
+{
+    writel_relaxed(val, (volatile void *)(dev->base + off));
+}
+
+static inline uint8_t virtio_config_read8(struct virtio_dev *dev, uint32_t off)
+{
+    return readb_relaxed((volatile void *)(dev->base + VIRTIO_MMIO_CONFIG + off));
+}
+
+static inline uint16_t virtio_config_read16(struct virtio_dev *dev, uint32_t off)
+{
+    return readw_relaxed((volatile void *)(dev->base + VIRTIO_MMIO_CONFIG + off));
+}
+
+static inline uint32_t virtio_config_read32(struct virtio_dev *dev, uint32_t off)
+{
+    return readl_relaxed((volatile void *)(dev->base + VIRTIO_MMIO_CONFIG + off));
+}
+
+// Device drivers, matched on the virtio device id at probe time
+struct virtio_driver
+{
+    uint32_t device_id;
+    const char *name;
+    int (*probe)(struct virtio_dev *dev);
+};
+
+int virtio_probe_all(void);
+uint64_t virtio_negotiate(struct virtio_dev *dev, uint64_t wanted);
+void virtio_driver_ok(struct virtio_dev *dev);
+void virtio_fail(struct virtio_dev *dev);
+uint32_t virtio_ack_irq(struct virtio_dev *dev);
+
+int virtqueue_setup(struct virtio_dev *dev, struct virtqueue *vq, uint32_t index,
+                    uint32_t num);
+int virtqueue_add(struct virtqueue *vq, const struct vq_buf *bufs, uint32_t n, void *cookie);
+void virtqueue_kick(struct virtqueue *vq);
+void *virtqueue_get(struct virtqueue *vq, uint32_t *len);
+void virtqueue_disable_cb(struct virtqueue *vq);
+bool virtqueue_enable_cb(struct virtqueue *vq);
+
+static inline bool virtqueue_has_used(const struct virtqueue *vq)
+{
+    return vq->last_used != vq->used->idx;
+}
+
+int virtio_net_probe(struct virtio_dev *dev);
+int virtio_blk_probe(struct virtio_dev *dev);
+
+#endif
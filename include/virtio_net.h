@@ -0,0 +1,40 @@
+#ifndef _VIRTIO_NET_H
+#define _VIRTIO_NET_H
+
+#include "tiny_types.h"
+
+#define VIRTIO_NET_F_MAC 5
+#define VIRTIO_NET_F_STATUS 16
+
+#define VNET_RXQ 0
+#define VNET_TXQ 1
+#define VNET_QUEUE_SIZE 128
+#define VNET_BUF_SIZE 2048 // virtio_net_hdr + one 1514-byte frame
+#define VNET_MAX_FRAME 1514
+#define VNET_TX_MAX_SEGS 8 // descriptors per mbuf chain on transmit
+
+// Without VIRTIO_NET_F_MRG_RXBUF, legacy devices omit num_buffers
+struct virtio_net_hdr
+{
+    uint8_t flags;
+    uint8_t gso_type;
+    uint16_t hdr_len;
+    uint16_t gso_size;
+    uint16_t csum_start;
+    uint16_t csum_offset;
+    uint16_t num_buffers; // modern (VERSION_1) only
+};
+
+// Runs in NAPI context (poll thread or IRQ); the frame is only valid
+// until the handler returns
+typedef void (*net_rx_handler_t)(const uint8_t *frame, uint32_t len, void *arg);
+
+struct mbuf;
+
+int net_tx(const void *frame, uint32_t len);
+int net_tx_mbuf(struct mbuf *m);
+void net_set_rx_handler(net_rx_handler_t fn, void *arg);
+const uint8_t *net_mac(void);
+void net_dump(void);
+
+#endif
@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""Parse the JSON lines printed by the in-kernel benchmark runner and diff
+them against a stored baseline.
+
+Usage:
+    bench_compare.py LOG [--baseline FILE] [--save] [--threshold PCT]
+
+LOG is the captured QEMU console output (`make bench` tees it to
+build/bench/bench.log). Non-JSON lines (boot logs etc.) are ignored.
+Exit status is 1 when any p50/p99 regresses by more than --threshold percent.
+"""
+
+import argparse
+import json
+import os
+import sys
+
+METRICS = ("p50", "p99")
+
+
+def parse_log(path):
+    results = {}
+    meta = {}
+    with open(path, "r", errors="replace") as f:
+        for line in f:
+            start = line.find("{\"type\":")
+            if start < 0:
+                continue
+            try:
+                rec = json.loads(line[start:].strip())
+            except json.JSONDecodeError:
+                continue
+            if rec.get("type") == "bench":
+                results[rec["name"]] = rec
+            elif rec.get("type") == "bench_meta":
+                meta = rec
+    return meta, results
+
+
+def load_baseline(path):
+    baseline = {}
+    with open(path, "r") as f:
+        for line in f:
+            line = line.strip()
+            if line:
+                rec = json.loads(line)
+                baseline[rec["name"]] = rec
+    return baseline
+
+
+def save_baseline(path, results):
+    with open(path, "w") as f:
+        for name in sorted(results):
+            f.write(json.dumps(results[name], sort_keys=True) + "\n")
+    print(f"baseline written to {path} ({len(results)} benchmarks)")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("log")
+    ap.add_argument("--baseline", default="scripts/bench_baseline.jsonl")
+    ap.add_argument("--save", action="store_true",
+                    help="store this run as the new baseline")
+    ap.add_argument("--threshold", type=float, default=10.0,
+                    help="regression threshold in percent (default 10)")
+    args = ap.parse_args()
+
+    meta, results = parse_log(args.log)
+    if not results:
+        print("no benchmark results found in", args.log, file=sys.stderr)
+        return 2
+
+    if args.save:
+        save_baseline(args.baseline, results)
+        return 0
+
+    baseline = {}
+    if os.path.exists(args.baseline):
+        baseline = load_baseline(args.baseline)
+    else:
+        print(f"no baseline at {args.baseline}; run `make bench_baseline` to create one")
+
+    if meta:
+        print(f"version={meta.get('version')} cntfrq={meta.get('cntfrq')}")
+
+    header = f"{'benchmark':32} {'p50 ns':>12} {'p99 ns':>12} {'d p50':>8} {'d p99':>8}"
+    print(header)
+    print("-" * len(header))
+
+    regressions = []
+    for name in sorted(results):
+        cur = results[name]
+        base = baseline.get(name)
+        deltas = []
+        for m in METRICS:
+            if base and float(base[m]) > 0:
+                d = (float(cur[m]) - float(base[m])) * 100.0 / float(base[m])
+                deltas.append(f"{d:+7.1f}%")
+                if d > args.threshold:
+                    regressions.append((name, m, d))
+            else:
+                deltas.append(f"{'new':>8}")
+        print(f"{name:32} {float(cur['p50']):12.3f} {float(cur['p99']):12.3f} "
+              f"{deltas[0]} {deltas[1]}")
+
+    for name in sorted(set(baseline) - set(results)):
+        print(f"{name:32} {'missing':>12}")
+
+    if regressions:
+        print()
+        for name, m, d in regressions:
+            print(f"REGRESSION {name} {m} {d:+.1f}% (threshold {args.threshold}%)")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""Convert the flight-recorder dump printed by `trace dump` (or by a fatal
+exception) into Chrome trace JSON, which Perfetto and chrome://tracing load.
+
+Usage:
+    trace2perfetto.py LOG [-o OUT]
+
+LOG is the captured QEMU console output. Non-JSON lines are ignored; when
+the log holds several dumps, the last one wins. Each CPU gets three tracks:
+the running task, interrupts, and virtqueue/lock activity. Lock holds are
+async slices keyed by the lock address, since they need not nest.
+"""
+
+import argparse
+import json
+import sys
+
+
+def parse_log(path):
+    meta = None
+    events = []
+    with open(path, "r", errors="replace") as f:
+        for line in f:
+            start = line.find("{\"type\":")
+            if start < 0:
+                continue
+            try:
+                rec = json.loads(line[start:].strip())
+            except json.JSONDecodeError:
+                continue
+            if rec.get("type") == "trace_meta":
+                meta = rec
+                events = []
+            elif rec.get("type") == "trace" and meta is not None:
+                events.append(rec)
+    return meta, events
+
+
+def tid(cpu, track):
+    return cpu * 4 + track
+
+
+TRACK_TASK, TRACK_IRQ, TRACK_IO = 0, 1, 2
+
+
+def convert(meta, events):
+    freq = meta["cntfrq"]
+    # Every CPU reads the same system counter, so a stable sort by
+    # timestamp replays the dump in the order it happened
+    events.sort(key=lambda e: e["ts"])
+    base = events[0]["ts"] if events else 0
+    out = []
+    running = {}  # cpu -> pid currently on it
+    irq_depth = {}  # cpu -> open irq_enter slices
+
+    def us(e):
+        return (e["ts"] - base) * 1e6 / freq
+
+    for cpu in range(meta["cpus"]):
+        for track, name in ((TRACK_TASK, "tasks"), (TRACK_IRQ, "irq"), (TRACK_IO, "io")):
+            out.append({"ph": "M", "name": "thread_name", "pid": 0,
+                        "tid": tid(cpu, track),
+                        "args": {"name": "cpu%d %s" % (cpu, name)}})
+
+    for e in events:
+        cpu, ev, a, b, ts = e["cpu"], e["ev"], e["a"], e["b"], us(e)
+        if ev == "irq_enter":
+            irq_depth[cpu] = irq_depth.get(cpu, 0) + 1
+            out.append({"ph": "B", "name": "irq %d" % b, "pid": 0,
+                        "tid": tid(cpu, TRACK_IRQ), "ts": ts})
+        elif ev == "irq_exit":
+            if irq_depth.get(cpu, 0) == 0:
+                continue  # its enter was overwritten
+            irq_depth[cpu] -= 1
+            out.append({"ph": "E", "pid": 0, "tid": tid(cpu, TRACK_IRQ), "ts": ts})
+        elif ev == "switch":
+            if cpu in running:
+                out.append({"ph": "E", "pid": 0, "tid": tid(cpu, TRACK_TASK), "ts": ts})
+            running[cpu] = b
+            out.append({"ph": "B", "name": "pid %d" % b, "pid": 0,
+                        "tid": tid(cpu, TRACK_TASK), "ts": ts,
+                        "args": {"prev": a}})
+        elif ev == "lock_acquire":
+            out.append({"ph": "b", "cat": "lock", "name": "lock 0x%x" % b,
+                        "id": "0x%x" % b, "pid": 0, "tid": tid(cpu, TRACK_IO),
+                        "ts": ts, "args": {"spins": a}})
+        elif ev == "lock_release":
+            out.append({"ph": "e", "cat": "lock", "name": "lock 0x%x" % b,
+                        "id": "0x%x" % b, "pid": 0, "tid": tid(cpu, TRACK_IO),
+                        "ts": ts})
+        elif ev in ("vq_kick", "vq_complete"):
+            args = {"slot": a >> 8, "queue": a & 0xff}
+            if ev == "vq_kick":
+                args["notified"] = bool(b)
+            else:
+                args["len"] = b
+            out.append({"ph": "i", "s": "t", "name": ev, "pid": 0,
+                        "tid": tid(cpu, TRACK_IO), "ts": ts, "args": args})
+
+    # Close whatever was still open when the dump was taken
+    end = us(events[-1]) if events else 0
+    for cpu in running:
+        out.append({"ph": "E", "pid": 0, "tid": tid(cpu, TRACK_TASK), "ts": end})
+    for cpu, depth in irq_depth.items():
+        out.extend({"ph": "E", "pid": 0, "tid": tid(cpu, TRACK_IRQ), "ts": end}
+                   for _ in range(depth))
+    return {"traceEvents": out, "displayTimeUnit": "ns"}
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("log")
+    ap.add_argument("-o", "--output", help="output file (default: stdout)")
+    args = ap.parse_args()
+
+    meta, events = parse_log(args.log)
+    if meta is None:
+        print("no trace dump in %s" % args.log, file=sys.stderr)
+        return 1
+    trace = convert(meta, events)
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(trace, f)
+    else:
+        json.dump(trace, sys.stdout)
+        sys.stdout.write("\n")
+    print("%d events from %d cpus" % (len(events), meta["cpus"]), file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,176 @@
+/*
+ * File: bench.c
+ * Date: 2026-10-18
+ * Description: Benchmark runner. Walks the .bench section, runs every case
+ *              with warmup + timed samples and prints one JSON line per
+ *              case, parsed on the host by scripts/bench_compare.py.
+ */
+
+#include "bench.h"
+#include "atomic.h"
+#include "ipi.h"
+#include "shell.h"
+#include "smp.h"
+#include "timer.h"
+#include "tinystd.h"
+
+#ifndef VM_VERSION
+#define VM_VERSION "null"
+#endif
+
+extern const struct bench_case __bench_start[];
+extern const struct bench_case __bench_end[];
+
+static uint64_t samples[BENCH_MAX_SAMPLES];
+
+// Fan-out state for bench_run_on_all_cpus(); one run at a time
+static void (*all_cpus_fn)(uint64_t iters);
+static uint64_t all_cpus_iters;
+static volatile uint64_t all_cpus_done;
+
+// Shell sort, no allocation and good enough for a few thousand samples
+static void sort_samples(uint64_t *v, uint32_t n)
+{
+    for (uint32_t gap = n / 2; gap > 0; gap /= 2)
+    {
+        for (uint32_t i = gap; i < n; i++)
+        {
+            uint64_t tmp = v[i];
+            uint32_t j = i;
+            while (j >= gap && v[j - gap] > tmp)
+            {
+                v[j] = v[j - gap];
+                j -= gap;
+            }
+            v[j] = tmp;
+        }
+    }
+}
+
+static uint64_t percentile(const uint64_t *sorted, uint32_t n, uint32_t pct)
+{
+    uint32_t idx = (uint32_t)(((uint64_t)n * pct + 99) / 100);
+    return sorted[idx ? idx - 1 : 0];
+}
+
+// Samples are kept as picoseconds per operation so that sub-ns costs
+// survive integer division; printed as ns with three decimals.
+static void print_ns(const char *key, uint64_t ps)
+{
+    printf(",\"%s\":%llu.%03llu", key, ps / 1000, ps % 1000);
+}
+
+static void all_cpus_worker(void *arg)
+{
+    all_cpus_fn(all_cpus_iters);
+    atomic_add_return(&all_cpus_done, 1);
+}
+
+// For multi-CPU cases: fn(iters) on every online CPU, this one included,
+// and back once all of them have returned
+void bench_run_on_all_cpus(void (*fn)(uint64_t iters), uint64_t iters)
+{
+    uint64_t want = num_online_cpus();
+
+    all_cpus_fn = fn;
+    all_cpus_iters = iters;
+    WRITE_ONCE(all_cpus_done, 0);
+    smp_wmb();
+    smp_call_function_many(cpu_online_mask, all_cpus_worker, NULL);
+    while (atomic_load_acquire(&all_cpus_done) != want)
+        cpu_relax();
+}
+
+static void bench_one(const struct bench_case *bc)
+{
+    uint32_t n = MIN(bc->samples, (uint32_t)BENCH_MAX_SAMPLES);
+    uint64_t batch = bc->batch ? bc->batch : 1;
+    uint64_t sum = 0;
+
+    if (n == 0)
+        return;
+    if (bc->init && bc->init() != 0)
+    {
+        printf("{\"type\":\"bench_skip\",\"name\":\"%s\"}\n", bc->name);
+        return;
+    }
+
+    for (uint32_t i = 0; i < bc->warmup; i++)
+        bc->run(batch);
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+        uint64_t t0 = read_cntvct();
+        bc->run(batch);
+        uint64_t t1 = read_cntvct();
+        samples[i] = ticks_to_ns((t1 - t0) * 1000) / batch;
+        sum += samples[i];
+    }
+
+    if (bc->fini)
+        bc->fini();
+
+    sort_samples(samples, n);
+
+    printf("{\"type\":\"bench\",\"name\":\"%s\",\"unit\":\"ns/op\",\"batch\":%llu,\"samples\":%u",
+           bc->name, batch, n);
+    print_ns("min", samples[0]);
+    print_ns("p50", percentile(samples, n, 50));
+    print_ns("p90", percentile(samples, n, 90));
+    print_ns("p99", percentile(samples, n, 99));
+    print_ns("max", samples[n - 1]);
+    print_ns("mean", sum / n);
+    printf("}\n");
+}
+
+static void bench_header(void)
+{
+    printf("{\"type\":\"bench_meta\",\"version\":\"%s\",\"cntfrq\":%llu}\n",
+           VM_VERSION, read_cntfrq());
+}
+
+int bench_run(const char *name)
+{
+    for (const struct bench_case *bc = __bench_start; bc < __bench_end; bc++)
+    {
+        if (strcmp(bc->name, name) == 0)
+        {
+            bench_header();
+            bench_one(bc);
+            return 0;
+        }
+    }
+    tiny_warn("bench: no benchmark named '%s'\n", name);
+    return -1;
+}
+
+void bench_run_all(void)
+{
+    bench_header();
+    for (const struct bench_case *bc = __bench_start; bc < __bench_end; bc++)
+        bench_one(bc);
+    printf("{\"type\":\"bench_done\",\"count\":%u}\n", (uint32_t)(__bench_end - __bench_start));
+}
+
+// bench <name>|all|list
+static int cmd_bench(int argc, char **argv)
+{
+    if (!(__bench_end - __bench_start))
+    {
+        printf("bench: no benchmarks in this image (make BENCH=1)\n");
+        return -1;
+    }
+    if (argc < 2 || !strcmp(argv[1], "list"))
+    {
+        for (const struct bench_case *bc = __bench_start; bc < __bench_end; bc++)
+            printf("  %s\n", bc->name);
+        return 0;
+    }
+    if (!strcmp(argv[1], "all"))
+    {
+        bench_run_all();
+        return 0;
+    }
+    return bench_run(argv[1]);
+}
+SHELL_CMD(bench, "run a benchmark: bench <name>|all|list", cmd_bench);
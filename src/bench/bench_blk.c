@@ -0,0 +1,104 @@
+/*
+ * File: bench_blk.c
+ * Date: 2026-10-18
+ * Description: Block layer throughput against the virtio-blk disk: 32 x 4KB
+ *              reads at queue depth 1 and 32, and adjacent reads submitted
+ *              under a plug so that they merge into a few large requests.
+ */
+
+#include "atomic.h"
+#include "bench.h"
+#include "blk.h"
+#include "page_alloc.h"
+
+#define BLK_BENCH_REQS 32
+#define BLK_BENCH_SECTORS 8 // 4KB
+
+static struct blk_device *bench_bd;
+static uint8_t *bench_buf;
+static struct blk_request bench_rq[BLK_BENCH_REQS];
+static volatile uint64_t bench_done;
+static uint64_t bench_pos;
+
+static void blk_bench_done(struct blk_request *rq, int status)
+{
+    atomic_add_return(&bench_done, 1);
+}
+
+static int blk_bench_init_depth(uint32_t depth)
+{
+    bench_bd = blk_get(0);
+    if (!bench_bd || bench_bd->capacity < 4096)
+        return -1;
+    if (!bench_buf)
+        bench_buf = alloc_pages(5); // 32 x 4KB
+    if (!bench_buf)
+        return -1;
+    blk_set_depth(bench_bd, depth);
+    return 0;
+}
+
+static int blk_bench_init_qd1(void)
+{
+    return blk_bench_init_depth(1);
+}
+
+static int blk_bench_init_qd32(void)
+{
+    return blk_bench_init_depth(32);
+}
+
+static void blk_bench_fini(void)
+{
+    blk_dump(bench_bd);
+    blk_set_depth(bench_bd, bench_bd->hw_depth);
+}
+
+// One timed op is one 4KB read; `stride` in sectors between requests
+static void blk_bench_issue(uint64_t batch, uint32_t stride, bool plug)
+{
+    uint64_t span = (uint64_t)BLK_BENCH_REQS * stride;
+
+    if (batch > BLK_BENCH_REQS)
+        batch = BLK_BENCH_REQS;
+    if (bench_pos + span > bench_bd->capacity)
+        bench_pos = 0;
+
+    WRITE_ONCE(bench_done, 0);
+    if (plug)
+        blk_start_plug(bench_bd);
+    for (uint64_t i = 0; i < batch; i++)
+    {
+        struct blk_request *rq = &bench_rq[i];
+
+        rq->op = BLK_READ;
+        rq->sector = bench_pos + i * stride;
+        rq->nr_sectors = BLK_BENCH_SECTORS;
+        rq->buf = bench_buf + i * (BLK_BENCH_SECTORS << BLK_SECTOR_SHIFT);
+        rq->done = blk_bench_done;
+        blk_submit(bench_bd, rq);
+    }
+    if (plug)
+        blk_finish_plug(bench_bd);
+    while (atomic_load_acquire(&bench_done) != batch)
+        cpu_relax();
+    bench_pos += span;
+}
+
+// Gaps between the reads keep them from merging
+static void bench_blk_scattered(uint64_t batch)
+{
+    blk_bench_issue(batch, 2 * BLK_BENCH_SECTORS, false);
+}
+
+static void bench_blk_merged(uint64_t batch)
+{
+    blk_bench_issue(batch, BLK_BENCH_SECTORS, true);
+}
+
+BENCH_DEFINE_FULL(blk_read_4k_qd1, blk_bench_init_qd1, bench_blk_scattered, blk_bench_fini,
+                  BLK_BENCH_REQS, 4, 128);
+BENCH_DEFINE_FULL(blk_read_4k_qd32, blk_bench_init_qd32, bench_blk_scattered,
+                  blk_bench_fini, BLK_BENCH_REQS, 4, 128);
+BENCH_DEFINE_FULL(blk_read_4k_merged, blk_bench_init_qd32, bench_blk_merged, blk_bench_fini,
+                  BLK_BENCH_REQS, 4, 128);
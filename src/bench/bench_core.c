@@ -0,0 +1,94 @@
+/*
+ * File: bench_core.c
+ * Date: 2026-10-18
+ * Description: Baseline micro-benchmarks for the primitives everything else
+ *              is built on: counter reads, spin locks, formatting, memcpy.
+ */
+
+#include "bench.h"
+#include "spin_lock.h"
+#include "timer.h"
+#include "tinystd.h"
+
+static void bench_cntvct(uint64_t batch)
+{
+    while (batch--)
+        (void)read_cntvct();
+}
+BENCH_DEFINE(cntvct_read, bench_cntvct);
+
+static spinlock_t bench_lock;
+
+static void bench_spin_lock(uint64_t batch)
+{
+    while (batch--)
+    {
+        spin_lock(&bench_lock);
+        spin_unlock(&bench_lock);
+    }
+}
+BENCH_DEFINE(spin_lock_uncontended, bench_spin_lock);
+
+static void bench_spin_trylock(uint64_t batch)
+{
+    while (batch--)
+    {
+        if (spin_trylock(&bench_lock) == 0)
+            spin_unlock(&bench_lock);
+    }
+}
+BENCH_DEFINE(spin_trylock_uncontended, bench_spin_trylock);
+
+static char fmt_buf[128];
+
+static void bench_snprintf(uint64_t batch)
+{
+    while (batch--)
+        snprintf(fmt_buf, sizeof(fmt_buf), "{\"cpu\":%u,\"irq\":%llu,\"exc\":%llu}",
+                 1U, 123456ULL, 42ULL);
+}
+BENCH_DEFINE_FULL(snprintf_stats_line, NULL, bench_snprintf, NULL, 8, 4, 512);
+
+// The same line from a format parsed once, one record per call and 8 per call
+#define FMT_BENCH_RECORDS 8
+
+static printf_fmt_t stats_fmt;
+static char fmtv_buf[FMT_BENCH_RECORDS * 64];
+static printf_arg_t stats_args[FMT_BENCH_RECORDS][3];
+
+static int fmt_bench_init(void)
+{
+    for (int r = 0; r < FMT_BENCH_RECORDS; r++)
+    {
+        stats_args[r][0].u = r;
+        stats_args[r][1].u = 123456;
+        stats_args[r][2].u = 42;
+    }
+    return printf_compile(&stats_fmt, "{\"cpu\":%u,\"irq\":%llu,\"exc\":%llu}\n");
+}
+
+static void bench_snprintf_fmt(uint64_t batch)
+{
+    while (batch--)
+        snprintf_fmt(fmt_buf, sizeof(fmt_buf), &stats_fmt, 1U, 123456ULL, 42ULL);
+}
+BENCH_DEFINE_FULL(snprintf_fmt_stats_line, fmt_bench_init, bench_snprintf_fmt, NULL, 8, 4, 512);
+
+// batch counts records: the per-op figure is ns per line, records/s = 1e9 / ns
+static void bench_snprintf_fmtv(uint64_t batch)
+{
+    for (; batch >= FMT_BENCH_RECORDS; batch -= FMT_BENCH_RECORDS)
+        snprintf_fmtv(fmtv_buf, sizeof(fmtv_buf), &stats_fmt, &stats_args[0][0], FMT_BENCH_RECORDS);
+}
+BENCH_DEFINE_FULL(snprintf_fmtv_stats_line, fmt_bench_init, bench_snprintf_fmtv, NULL,
+                  FMT_BENCH_RECORDS * 4, 4, 512);
+
+static uint8_t copy_src[4096] __attribute__((aligned(64)));
+static uint8_t copy_dst[4096] __attribute__((aligned(64)));
+
+static void bench_memcpy(uint64_t batch)
+{
+    while (batch--)
+        memcpy(copy_dst, copy_src, sizeof(copy_dst));
+}
+BENCH_DEFINE_FULL(memcpy_4k, NULL, bench_memcpy, NULL, 4, 4, 512);
@@ -0,0 +1,88 @@
+/*
+ * File: bench_coro.c
+ * Date: 2026-10-18
+ * Description: Coroutine cost: a yield round trip through the event loop,
+ *              and a thousand coroutines started at once, each sleeping
+ *              on a timer before it finishes.
+ */
+
+#include "atomic.h"
+#include "bench.h"
+#include "coro.h"
+#include "smp.h"
+
+#define CORO_BENCH_FANOUT 1024
+
+struct coro_bench
+{
+    struct coro co;
+    uint64_t left; // yields still to do
+};
+
+static struct coro_bench yielder;
+static struct coro_bench fanout[CORO_BENCH_FANOUT];
+static volatile uint64_t coros_done;
+static int loop_cpu;
+
+// The runner spins on the boot CPU, so the coroutines run on another one
+static int coro_bench_init(void)
+{
+    if (num_online_cpus() < 2)
+        return -1;
+    loop_cpu = num_online_cpus() - 1;
+    return 0;
+}
+
+static void coro_bench_done(struct coro *co)
+{
+    atomic_add_return(&coros_done, 1);
+}
+
+static void coro_bench_wait(uint64_t want)
+{
+    while (atomic_load_acquire(&coros_done) != want)
+        cpu_relax();
+}
+
+static int yield_loop(struct coro *co)
+{
+    struct coro_bench *b = co->arg;
+
+    CORO_BEGIN(co);
+    while (b->left)
+    {
+        b->left--;
+        CORO_YIELD(co);
+    }
+    CORO_END(co);
+}
+
+static void bench_coro_yield(uint64_t batch)
+{
+    WRITE_ONCE(coros_done, 0);
+    yielder.left = batch;
+    yielder.co.done = coro_bench_done;
+    coro_start(&yielder.co, yield_loop, &yielder, loop_cpu);
+    coro_bench_wait(1);
+}
+BENCH_DEFINE_FULL(coro_yield, coro_bench_init, bench_coro_yield, NULL, 256, 4, 256);
+
+static int sleep_once(struct coro *co)
+{
+    CORO_BEGIN(co);
+    CORO_SLEEP_NS(co, 10000);
+    CORO_END(co);
+}
+
+static void bench_coro_fanout(uint64_t batch)
+{
+    WRITE_ONCE(coros_done, 0);
+    for (uint64_t i = 0; i < batch; i++)
+    {
+        fanout[i].co.done = coro_bench_done;
+        coro_start(&fanout[i].co, sleep_once, &fanout[i], loop_cpu);
+    }
+    coro_bench_wait(batch);
+}
+BENCH_DEFINE_FULL(coro_fanout, coro_bench_init, bench_coro_fanout, NULL, CORO_BENCH_FANOUT, 2,
+                  64);
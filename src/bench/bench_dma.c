@@ -0,0 +1,51 @@
+/*
+ * File: bench_dma.c
+ * Date: 2026-10-18
+ * Description: Streaming DMA sync cost for a non-coherent device: one 4KB
+ *              buffer, and an 8-segment chain synced segment by segment
+ *              (a dsb each) against once as a scatter-gather list.
+ */
+
+#include "bench.h"
+#include "dma.h"
+#include "virtio.h"
+
+#define DMA_BENCH_SEGS 8
+#define DMA_BENCH_SEG_SIZE 512
+
+static const struct dma_dev noncoherent = {.coherent = false};
+static uint8_t dma_buf[DMA_BENCH_SEGS * DMA_BENCH_SEG_SIZE] __attribute__((aligned(64)));
+static struct vq_buf dma_sg[DMA_BENCH_SEGS];
+
+static int dma_bench_init(void)
+{
+    for (int i = 0; i < DMA_BENCH_SEGS; i++)
+        dma_sg[i] = (struct vq_buf){(paddr_t)&dma_buf[i * DMA_BENCH_SEG_SIZE], DMA_BENCH_SEG_SIZE,
+                                    i == DMA_BENCH_SEGS - 1};
+    return 0;
+}
+
+static void bench_dma_sync_4k(uint64_t batch)
+{
+    while (batch--)
+        dma_sync_for_device(&noncoherent, (dma_addr_t)dma_buf, sizeof(dma_buf), DMA_TO_DEVICE);
+}
+BENCH_DEFINE_FULL(dma_sync_4k, dma_bench_init, bench_dma_sync_4k, NULL, 8, 4, 512);
+
+static void bench_dma_sync_each(uint64_t batch)
+{
+    while (batch--)
+    {
+        for (int i = 0; i < DMA_BENCH_SEGS; i++)
+            dma_sync_for_device(&noncoherent, dma_sg[i].addr, dma_sg[i].len,
+                                dma_sg[i].write ? DMA_FROM_DEVICE : DMA_TO_DEVICE);
+    }
+}
+BENCH_DEFINE_FULL(dma_sync_chain_each, dma_bench_init, bench_dma_sync_each, NULL, 8, 4, 512);
+
+static void bench_dma_sync_sg(uint64_t batch)
+{
+    while (batch--)
+        dma_sync_sg_for_device(&noncoherent, dma_sg, DMA_BENCH_SEGS);
+}
+BENCH_DEFINE_FULL(dma_sync_chain_sg, dma_bench_init, bench_dma_sync_sg, NULL, 8, 4, 512);
@@ -0,0 +1,62 @@
+/*
+ * File: bench_ipi.c
+ * Date: 2026-10-18
+ * Description: Cross-CPU call latency: cpu0 <-> cpu1 ping-pong round trip
+ *              and a multicast call acknowledged by every other CPU.
+ */
+
+#include "atomic.h"
+#include "bench.h"
+#include "ipi.h"
+#include "smp.h"
+
+static volatile uint64_t pong_seen;
+static volatile uint64_t acks;
+
+static int ipi_bench_init(void)
+{
+    return cpu_online(1) ? 0 : -1;
+}
+
+static void ping_done(void *arg)
+{
+    WRITE_ONCE(pong_seen, 1);
+}
+
+// Runs on cpu1 and answers straight back to cpu0
+static void pong(void *arg)
+{
+    smp_call_function(0, ping_done, NULL);
+}
+
+static void bench_ipi_pingpong(uint64_t batch)
+{
+    while (batch--)
+    {
+        WRITE_ONCE(pong_seen, 0);
+        smp_call_function(1, pong, NULL);
+        while (!READ_ONCE(pong_seen))
+            cpu_relax();
+    }
+}
+BENCH_DEFINE_FULL(ipi_pingpong, ipi_bench_init, bench_ipi_pingpong, NULL, 1, 16, 512);
+
+static void ack(void *arg)
+{
+    atomic_add_return(&acks, 1);
+}
+
+static void bench_ipi_multicast(uint64_t batch)
+{
+    uint64_t others = cpu_online_mask & ~(1UL << smp_processor_id());
+    uint64_t want = num_online_cpus() - 1;
+
+    while (batch--)
+    {
+        WRITE_ONCE(acks, 0);
+        smp_call_function_many(others, ack, NULL);
+        while (atomic_load_acquire(&acks) != want)
+            cpu_relax();
+    }
+}
+BENCH_DEFINE_FULL(ipi_multicast, ipi_bench_init, bench_ipi_multicast, NULL, 1, 16, 512);
@@ -0,0 +1,47 @@
+/*
+ * File: bench_percpu.c
+ * Date: 2026-10-18
+ * Description: False-sharing demonstration. Every online CPU increments
+ *              its own counter; once with the counters packed into one
+ *              cache line, once as cache-line aligned per-CPU variables.
+ */
+
+#include "bench.h"
+#include "percpu.h"
+#include "smp.h"
+
+static volatile uint64_t packed_counter[NR_CPUS];
+static DEFINE_PER_CPU_ALIGNED(volatile uint64_t, percpu_counter);
+
+static int fs_bench_init(void)
+{
+    return num_online_cpus() > 1 ? 0 : -1;
+}
+
+static void packed_worker(uint64_t iters)
+{
+    volatile uint64_t *c = &packed_counter[smp_processor_id()];
+
+    for (uint64_t i = 0; i < iters; i++)
+        (*c)++;
+}
+
+static void percpu_worker(uint64_t iters)
+{
+    volatile uint64_t *c = this_cpu_ptr(&percpu_counter);
+
+    for (uint64_t i = 0; i < iters; i++)
+        (*c)++;
+}
+
+static void bench_packed(uint64_t batch)
+{
+    bench_run_on_all_cpus(packed_worker, batch);
+}
+BENCH_DEFINE_FULL(false_sharing_packed, fs_bench_init, bench_packed, NULL, 4096, 4, 128);
+
+static void bench_percpu(uint64_t batch)
+{
+    bench_run_on_all_cpus(percpu_worker, batch);
+}
+BENCH_DEFINE_FULL(false_sharing_percpu, fs_bench_init, bench_percpu, NULL, 4096, 4, 128);
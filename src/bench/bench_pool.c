@@ -0,0 +1,63 @@
+/*
+ * File: bench_pool.c
+ * Date: 2026-10-18
+ * Description: tiny_pool cost: alloc + free served by the per-CPU cache,
+ *              bursts larger than the cache that go through the shared
+ *              tagged free list, and the same bursts on every CPU at once.
+ */
+
+#include "bench.h"
+#include "smp.h"
+#include "tiny_pool.h"
+
+#define POOL_BENCH_OBJS 1024
+#define POOL_BENCH_BURST 64 // > TINY_POOL_CACHE: refills and drains every time
+
+static struct tiny_pool *bench_pool;
+
+static int pool_bench_init(void)
+{
+    if (!bench_pool)
+        bench_pool = tiny_pool_create("bench", 64, POOL_BENCH_OBJS);
+    return bench_pool ? 0 : -1;
+}
+
+static int pool_bench_init_smp(void)
+{
+    return num_online_cpus() > 1 ? pool_bench_init() : -1;
+}
+
+static void pool_burst(uint64_t rounds)
+{
+    void *objs[POOL_BENCH_BURST];
+
+    for (uint64_t r = 0; r < rounds; r++)
+    {
+        for (int i = 0; i < POOL_BENCH_BURST; i++)
+            objs[i] = tiny_pool_alloc(bench_pool);
+        for (int i = 0; i < POOL_BENCH_BURST; i++)
+        {
+            if (objs[i])
+                tiny_pool_free(bench_pool, objs[i]);
+        }
+    }
+}
+
+static void bench_pool_cached(uint64_t batch)
+{
+    for (uint64_t i = 0; i < batch; i++)
+        tiny_pool_free(bench_pool, tiny_pool_alloc(bench_pool));
+}
+BENCH_DEFINE_FULL(pool_alloc_free, pool_bench_init, bench_pool_cached, NULL, 256, 16, 1024);
+
+static void bench_pool_burst(uint64_t batch)
+{
+    pool_burst(batch);
+}
+BENCH_DEFINE_FULL(pool_burst, pool_bench_init, bench_pool_burst, NULL, 4, 16, 512);
+
+static void bench_pool_burst_all(uint64_t batch)
+{
+    bench_run_on_all_cpus(pool_burst, batch);
+}
+BENCH_DEFINE_FULL(pool_burst_allcpus, pool_bench_init_smp, bench_pool_burst_all, NULL, 4, 4, 256);
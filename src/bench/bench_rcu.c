@@ -0,0 +1,158 @@
+/*
+ * File: bench_rcu.c
+ * Date: 2026-10-18
+ * Description: Reader scaling of a read-mostly table: RCU readers against
+ *              rwlock readers, on one CPU and on every online CPU at once,
+ *              plus the cost of a synchronize_rcu() grace period, also with
+ *              a CPU busy in a cond_resched() poll loop.
+ */
+
+#include "atomic.h"
+#include "bench.h"
+#include "rcu.h"
+#include "sched.h"
+#include "smp.h"
+#include "spin_lock.h"
+
+#define RCU_BENCH_SLOTS 8
+
+struct rcu_bench_table
+{
+    uint64_t slot[RCU_BENCH_SLOTS];
+};
+
+static struct rcu_bench_table rcu_bench_tables[2];
+static struct rcu_bench_table *rcu_bench_cur = &rcu_bench_tables[0];
+static rwlock_t rcu_bench_rwlock;
+
+static volatile uint64_t rcu_bench_sink;
+
+static uint64_t read_rcu(uint64_t iters)
+{
+    uint64_t sum = 0;
+
+    for (uint64_t i = 0; i < iters; i++)
+    {
+        rcu_read_lock();
+        sum += rcu_dereference(rcu_bench_cur)->slot[i & (RCU_BENCH_SLOTS - 1)];
+        rcu_read_unlock();
+    }
+    return sum;
+}
+
+static uint64_t read_rwlock(uint64_t iters)
+{
+    uint64_t sum = 0;
+
+    for (uint64_t i = 0; i < iters; i++)
+    {
+        read_lock(&rcu_bench_rwlock);
+        sum += rcu_bench_cur->slot[i & (RCU_BENCH_SLOTS - 1)];
+        read_unlock(&rcu_bench_rwlock);
+    }
+    return sum;
+}
+
+static void rcu_worker(uint64_t iters)
+{
+    rcu_bench_sink += read_rcu(iters);
+}
+
+static void rwlock_worker(uint64_t iters)
+{
+    rcu_bench_sink += read_rwlock(iters);
+}
+
+static int rcu_bench_init(void)
+{
+    rwlock_init(&rcu_bench_rwlock);
+    for (int i = 0; i < RCU_BENCH_SLOTS; i++)
+        rcu_bench_tables[0].slot[i] = i;
+    return 0;
+}
+
+static int rcu_bench_init_smp(void)
+{
+    return num_online_cpus() > 1 ? rcu_bench_init() : -1;
+}
+
+static void bench_rcu_read(uint64_t batch)
+{
+    rcu_bench_sink += read_rcu(batch);
+}
+BENCH_DEFINE_FULL(rcu_read, rcu_bench_init, bench_rcu_read, NULL, 1024, 16, 512);
+
+static void bench_rwlock_read(uint64_t batch)
+{
+    rcu_bench_sink += read_rwlock(batch);
+}
+BENCH_DEFINE_FULL(rwlock_read, rcu_bench_init, bench_rwlock_read, NULL, 1024, 16, 512);
+
+// Same work per CPU as above: flat latency means the readers scale
+static void bench_rcu_read_all(uint64_t batch)
+{
+    bench_run_on_all_cpus(rcu_worker, batch);
+}
+BENCH_DEFINE_FULL(rcu_read_allcpus, rcu_bench_init_smp, bench_rcu_read_all, NULL, 1024, 4, 256);
+
+static void bench_rwlock_read_all(uint64_t batch)
+{
+    bench_run_on_all_cpus(rwlock_worker, batch);
+}
+BENCH_DEFINE_FULL(rwlock_read_allcpus, rcu_bench_init_smp, bench_rwlock_read_all, NULL, 1024, 4,
+                  256);
+
+// Publish the other copy and wait out the readers of the old one
+static void bench_rcu_update(uint64_t batch)
+{
+    for (uint64_t i = 0; i < batch; i++)
+    {
+        struct rcu_bench_table *old = rcu_bench_cur;
+        struct rcu_bench_table *new = old == &rcu_bench_tables[0] ? &rcu_bench_tables[1]
+                                                                   : &rcu_bench_tables[0];
+
+        *new = *old;
+        new->slot[0]++;
+        rcu_assign_pointer(rcu_bench_cur, new);
+        synchronize_rcu();
+    }
+}
+BENCH_DEFINE_FULL(rcu_synchronize, rcu_bench_init, bench_rcu_update, NULL, 1, 4, 128);
+
+/*
+ * A kthread that only calls cond_resched(), as the NAPI thread does in
+ * poll mode, on a CPU with nothing else to run: it never schedules, so
+ * grace periods complete only if cond_resched() reports quiescent states.
+ * A regression shows up as this case hanging.
+ */
+static volatile bool poller_stop;
+static volatile bool poller_running;
+
+static void rcu_poller(void *arg)
+{
+    WRITE_ONCE(poller_running, true);
+    while (!READ_ONCE(poller_stop))
+        cond_resched();
+    WRITE_ONCE(poller_running, false);
+}
+
+static int rcu_poll_bench_init(void)
+{
+    if (rcu_bench_init_smp())
+        return -1;
+    WRITE_ONCE(poller_stop, false);
+    if (!kthread_create("rcu-poll", rcu_poller, NULL, num_online_cpus() - 1, PRIO_NORMAL))
+        return -1;
+    while (!READ_ONCE(poller_running))
+        cpu_relax();
+    return 0;
+}
+
+static void rcu_poll_bench_fini(void)
+{
+    WRITE_ONCE(poller_stop, true);
+    while (READ_ONCE(poller_running))
+        cpu_relax();
+}
+BENCH_DEFINE_FULL(rcu_synchronize_polling, rcu_poll_bench_init, bench_rcu_update,
+                  rcu_poll_bench_fini, 1, 4, 128);
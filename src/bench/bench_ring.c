@@ -0,0 +1,189 @@
+/*
+ * File: bench_ring.c
+ * Date: 2026-10-18
+ * Description: Ring IPC cost. Single-core cases measure the enqueue +
+ *              dequeue path per object; cross-core cases run an echo or
+ *              drain kthread on cpu1 for round-trip latency and streaming
+ *              throughput, with and without the doorbell.
+ */
+
+#include "atomic.h"
+#include "bench.h"
+#include "ring.h"
+#include "sched.h"
+#include "smp.h"
+
+#define RING_SLOTS 1024
+#define RING_BURST 32
+
+static struct ring *ring_a; // cpu0 -> cpu1
+static struct ring *ring_b; // cpu1 -> cpu0
+static volatile uint64_t peer_stop;
+static volatile uint64_t peer_done;
+static volatile uint64_t drained;
+
+static int ring_local_init(uint32_t flags)
+{
+    ring_a = ring_create(RING_SLOTS, flags);
+    return ring_a ? 0 : -1;
+}
+
+static int ring_spsc_init(void)
+{
+    return ring_local_init(RING_F_SPSC);
+}
+
+static int ring_mpmc_init(void)
+{
+    return ring_local_init(0);
+}
+
+static void ring_local_fini(void)
+{
+    ring_destroy(ring_a);
+    ring_a = NULL;
+}
+
+static void bench_ring_single(uint64_t batch)
+{
+    uint64_t obj;
+
+    while (batch--)
+    {
+        ring_enqueue(ring_a, batch);
+        ring_dequeue(ring_a, &obj);
+    }
+}
+
+// One timed op is one object, moved in bursts of RING_BURST
+static void bench_ring_burst(uint64_t batch)
+{
+    uint64_t objs[RING_BURST];
+
+    for (uint32_t i = 0; i < RING_BURST; i++)
+        objs[i] = i;
+    for (; batch >= RING_BURST; batch -= RING_BURST)
+    {
+        ring_enqueue_burst(ring_a, objs, RING_BURST);
+        ring_dequeue_burst(ring_a, objs, RING_BURST);
+    }
+}
+
+BENCH_DEFINE_FULL(ring_spsc_single, ring_spsc_init, bench_ring_single, ring_local_fini,
+                  64, 16, 1024);
+BENCH_DEFINE_FULL(ring_spsc_burst32, ring_spsc_init, bench_ring_burst, ring_local_fini,
+                  256, 16, 1024);
+BENCH_DEFINE_FULL(ring_mpmc_burst32, ring_mpmc_init, bench_ring_burst, ring_local_fini,
+                  256, 16, 1024);
+
+// cpu1 side: bounce every object from ring_a back through ring_b
+static void ring_echo(void *arg)
+{
+    bool sleep = (uint64_t)arg;
+    uint64_t objs[RING_BURST];
+
+    while (!READ_ONCE(peer_stop))
+    {
+        uint32_t n = sleep ? ring_dequeue_wait(ring_a, objs, RING_BURST)
+                           : ring_dequeue_burst(ring_a, objs, RING_BURST);
+        if (n)
+            ring_enqueue_burst(ring_b, objs, n);
+        else
+            cpu_relax();
+    }
+    atomic_store_release(&peer_done, 1);
+}
+
+// cpu1 side: drain ring_a and count
+static void ring_drain(void *arg)
+{
+    uint64_t objs[RING_BURST];
+
+    while (!READ_ONCE(peer_stop))
+    {
+        uint32_t n = ring_dequeue_burst(ring_a, objs, RING_BURST);
+        if (n)
+            atomic_store_release(&drained, drained + n);
+        else
+            cpu_relax();
+    }
+    atomic_store_release(&peer_done, 1);
+}
+
+static int ring_xcore_start(kthread_fn_t fn, uint32_t flags, void *arg)
+{
+    if (!cpu_online(1))
+        return -1;
+    ring_a = ring_create(RING_SLOTS, RING_F_SPSC | flags);
+    ring_b = ring_create(RING_SLOTS, RING_F_SPSC);
+    if (!ring_a || !ring_b)
+        return -1;
+    peer_stop = 0;
+    peer_done = 0;
+    drained = 0;
+    return kthread_create("ring-peer", fn, arg, 1, PRIO_HIGH) ? 0 : -1;
+}
+
+static int ring_pingpong_init(void)
+{
+    return ring_xcore_start(ring_echo, 0, (void *)0);
+}
+
+static int ring_doorbell_init(void)
+{
+    return ring_xcore_start(ring_echo, RING_F_DOORBELL, (void *)1);
+}
+
+static int ring_stream_init(void)
+{
+    return ring_xcore_start(ring_drain, 0, NULL);
+}
+
+static void ring_xcore_fini(void)
+{
+    WRITE_ONCE(peer_stop, 1);
+    // Kick a sleeping echo thread so it sees the stop flag
+    ring_enqueue(ring_a, 0);
+    while (!atomic_load_acquire(&peer_done))
+        cpu_relax();
+    ring_destroy(ring_a);
+    ring_destroy(ring_b);
+    ring_a = ring_b = NULL;
+}
+
+static void bench_ring_pingpong(uint64_t batch)
+{
+    uint64_t obj;
+
+    while (batch--)
+    {
+        ring_enqueue(ring_a, batch);
+        while (!ring_dequeue(ring_b, &obj))
+            cpu_relax();
+    }
+}
+
+static void bench_ring_stream(uint64_t batch)
+{
+    uint64_t objs[RING_BURST];
+    uint64_t target = drained + batch;
+
+    for (uint32_t i = 0; i < RING_BURST; i++)
+        objs[i] = i;
+    while (batch)
+    {
+        uint32_t n = ring_enqueue_burst(ring_a, objs, MIN(batch, (uint64_t)RING_BURST));
+        if (!n)
+            cpu_relax();
+        batch -= n;
+    }
+    while (atomic_load_acquire(&drained) != target)
+        cpu_relax();
+}
+
+BENCH_DEFINE_FULL(ring_xcore_pingpong, ring_pingpong_init, bench_ring_pingpong,
+                  ring_xcore_fini, 1, 16, 512);
+BENCH_DEFINE_FULL(ring_xcore_doorbell, ring_doorbell_init, bench_ring_pingpong,
+                  ring_xcore_fini, 1, 16, 512);
+BENCH_DEFINE_FULL(ring_xcore_stream, ring_stream_init, bench_ring_stream,
+                  ring_xcore_fini, 4096, 4, 256);
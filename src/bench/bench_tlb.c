@@ -0,0 +1,158 @@
+/*
+ * File: bench_tlb.c
+ * Date: 2026-10-18
+ * Description: TLB reach: the same 8MB of RAM touched one word per page
+ *              through 4KB pages, 2MB blocks and the 1GB identity map,
+ *              with TLB refills counted by the PMU where it has them.
+ */
+
+#include "bench.h"
+#include "mmap.h"
+#include "mmu.h"
+#include "page_alloc.h"
+#include "pmu.h"
+#include "tinystd.h"
+
+#define TLB_BENCH_BLOCKS 4 // 8MB: twice what the A72's 1024-entry L2 TLB covers in 4KB pages
+#define TLB_BENCH_BYTES (TLB_BENCH_BLOCKS * L2_BLOCK_SIZE)
+#define TLB_BENCH_PAGES (TLB_BENCH_BYTES >> PAGE_SHIFT)
+#define TLB_BENCH_STRIDE 1031 // prime: visits every page, never two neighbours in a row
+#define TLB_BENCH_COUNTER 0
+
+static const uint32_t tlb_events[] = {PMU_EV_DTLB_WALK, PMU_EV_L2D_TLB_REFILL,
+                                      PMU_EV_L1D_TLB_REFILL};
+
+static void *blocks[TLB_BENCH_BLOCKS];
+static vaddr_t va_4k, va_2m;
+static bool tlb_ready;
+
+static uint8_t *tlb_base;
+static uint32_t tlb_cursor;
+static uint64_t tlb_accesses;
+static int tlb_event = -1;
+
+// One 2MB block backs each quarter of both views, so they see the same bytes
+static int tlb_setup(void)
+{
+    if (tlb_ready)
+        return 0;
+    for (int b = 0; b < TLB_BENCH_BLOCKS; b++)
+    {
+        if (!blocks[b] && !(blocks[b] = alloc_huge(L2_BLOCK_SIZE)))
+            return -1;
+    }
+    va_4k = kmap_reserve(TLB_BENCH_BYTES, L2_BLOCK_SIZE);
+    va_2m = kmap_reserve(TLB_BENCH_BYTES, L2_BLOCK_SIZE);
+    if (!va_4k || !va_2m)
+        return -1;
+    for (int b = 0; b < TLB_BENCH_BLOCKS; b++)
+    {
+        vaddr_t off = (vaddr_t)b * L2_BLOCK_SIZE;
+        int prot = PROT_KERNEL | PROT_READ | PROT_WRITE;
+
+        for (vaddr_t p = 0; p < L2_BLOCK_SIZE; p += PAGE_SIZE)
+        {
+            if (mm_map_page(&init_mm, va_4k + off + p, (paddr_t)blocks[b] + p, prot, false))
+                return -1;
+        }
+        if (mm_map_huge(&init_mm, va_2m + off, (paddr_t)blocks[b], L2_BLOCK_SIZE, prot, false))
+            return -1;
+    }
+    __asm__ volatile("isb" ::: "memory");
+    tlb_ready = true;
+    return 0;
+}
+
+static int tlb_start(uint8_t *base)
+{
+    tlb_base = base;
+    tlb_cursor = 0;
+    tlb_accesses = 0;
+    tlb_event = -1;
+    for (uint32_t i = 0; i < sizeof(tlb_events) / sizeof(tlb_events[0]); i++)
+    {
+        if (pmu_num_counters() && pmu_event_supported(tlb_events[i]))
+        {
+            tlb_event = tlb_events[i];
+            pmu_counter_start(TLB_BENCH_COUNTER, tlb_event);
+            break;
+        }
+    }
+    return 0;
+}
+
+static int tlb_init_4k(void)
+{
+    return tlb_setup() ? -1 : tlb_start((uint8_t *)va_4k);
+}
+
+static int tlb_init_2m(void)
+{
+    return tlb_setup() ? -1 : tlb_start((uint8_t *)va_2m);
+}
+
+// The kernel's identity map already covers RAM with 1GB blocks
+static int tlb_init_1g(void)
+{
+    return tlb_setup() ? -1 : tlb_start(NULL);
+}
+
+// 4 x 2MB blocks are not contiguous: the identity view goes block by block
+static inline volatile uint64_t *tlb_word(uint32_t page)
+{
+    uint64_t off = (uint64_t)page << PAGE_SHIFT;
+
+    if (!tlb_base)
+        return (volatile uint64_t *)((uint8_t *)blocks[off >> L2_BLOCK_SHIFT] +
+                                     (off & (L2_BLOCK_SIZE - 1)));
+    return (volatile uint64_t *)(tlb_base + off);
+}
+
+static void bench_tlb_touch(uint64_t batch)
+{
+    uint32_t c = tlb_cursor;
+
+    for (uint64_t i = 0; i < batch; i++)
+    {
+        (void)*tlb_word(c);
+        c = (c + TLB_BENCH_STRIDE) & (TLB_BENCH_PAGES - 1);
+    }
+    tlb_cursor = c;
+    tlb_accesses += batch;
+}
+
+static void tlb_report(const char *name)
+{
+    uint64_t refills;
+
+    if (tlb_event < 0)
+    {
+        printf("{\"type\":\"pmu\",\"name\":\"%s\",\"event\":null}\n", name);
+        return;
+    }
+    refills = pmu_counter_read(TLB_BENCH_COUNTER);
+    pmu_counter_stop(TLB_BENCH_COUNTER);
+    printf("{\"type\":\"pmu\",\"name\":\"%s\",\"event\":\"0x%02x\",\"accesses\":%llu,"
+           "\"refills\":%llu,\"per_1k_accesses\":%llu}\n",
+           name, tlb_event, tlb_accesses, refills,
+           tlb_accesses ? refills * 1000 / tlb_accesses : 0);
+}
+
+static void tlb_fini_4k(void)
+{
+    tlb_report("tlb_4k");
+}
+
+static void tlb_fini_2m(void)
+{
+    tlb_report("tlb_2m");
+}
+
+static void tlb_fini_1g(void)
+{
+    tlb_report("tlb_1g");
+}
+
+BENCH_DEFINE_FULL(tlb_4k, tlb_init_4k, bench_tlb_touch, tlb_fini_4k, TLB_BENCH_PAGES, 4, 256);
+BENCH_DEFINE_FULL(tlb_2m, tlb_init_2m, bench_tlb_touch, tlb_fini_2m, TLB_BENCH_PAGES, 4, 256);
+BENCH_DEFINE_FULL(tlb_1g, tlb_init_1g, bench_tlb_touch, tlb_fini_1g, TLB_BENCH_PAGES, 4, 256);
@@ -0,0 +1,21 @@
+/*
+ * File: bench_trap.c
+ * Date: 2026-10-18
+ * Description: Exception entry/exit cost: a null syscall issued from EL1,
+ *              which goes through SAVE_REGS, the ESR jump table and
+ *              syscall_dispatch.
+ */
+
+#include "bench.h"
+#include "syscall.h"
+
+static void bench_svc_null(uint64_t batch)
+{
+    while (batch--)
+    {
+        register uint64_t x8 __asm__("x8") = SYS_NULL;
+        register uint64_t x0 __asm__("x0");
+        __asm__ volatile("svc #0" : "=r"(x0) : "r"(x8) : "memory");
+    }
+}
+BENCH_DEFINE(svc_null_el1, bench_svc_null);
@@ -0,0 +1,354 @@
+/*
+ * File: blk.c
+ * Date: 2026-10-18
+ * Description: Asynchronous block layer: per-CPU sorted submission queues
+ *              with adjacent-sector merging, depth-limited dispatch to the
+ *              driver and completion callbacks.
+ */
+
+#include "blk.h"
+#include "atomic.h"
+#include "irq.h"
+#include "mbuf.h"
+#include "smp.h"
+#include "stats.h"
+#include "timer.h"
+#include "tinystd.h"
+
+#define BLK_MAX_DEVICES 4
+
+DEFINE_STAT(blk_requests, "block requests submitted, before merging");
+DEFINE_STAT(blk_completions, "block device requests completed, after merging");
+
+static struct blk_device *blk_devs[BLK_MAX_DEVICES];
+static uint32_t blk_count;
+
+int blk_register(struct blk_device *bd)
+{
+    if (blk_count >= BLK_MAX_DEVICES)
+        return -1;
+    for (int i = 0; i < NR_CPUS; i++)
+        spinlock_init(&bd->swq[i].lock);
+    spinlock_init(&bd->dispatch_lock);
+    if (!bd->depth || bd->depth > bd->hw_depth)
+        bd->depth = bd->hw_depth;
+    blk_devs[blk_count++] = bd;
+    tiny_info("blk: %s, %llu sectors, depth %u (hw %u), %u segs per request\n", bd->name,
+              bd->capacity, bd->depth, bd->hw_depth, bd->max_segs);
+    return 0;
+}
+
+struct blk_device *blk_get(int index)
+{
+    return index >= 0 && (uint32_t)index < blk_count ? blk_devs[index] : NULL;
+}
+
+void blk_set_depth(struct blk_device *bd, uint32_t depth)
+{
+    WRITE_ONCE(bd->depth, MAX(1U, MIN(depth, bd->hw_depth)));
+    blk_run_queue(bd);
+}
+
+static bool blk_can_merge(struct blk_device *bd, struct blk_request *a, struct blk_request *b)
+{
+    return a->op == b->op && a->op != BLK_FLUSH &&
+           a->sector + a->total_sectors == b->sector &&
+           a->total_sectors + b->total_sectors <= bd->max_sectors &&
+           a->nr_segs + b->nr_segs <= bd->max_segs;
+}
+
+// Append chain b behind chain a
+static void blk_merge(struct blk_request *a, struct blk_request *b)
+{
+    a->merged_tail->merged = b;
+    a->merged_tail = b->merged_tail;
+    a->total_sectors += b->total_sectors;
+    a->nr_segs += b->nr_segs;
+}
+
+// swq->lock held: sorted insert, merging with the neighbours where possible
+static bool blk_swq_insert(struct blk_device *bd, struct blk_swq *q, struct blk_request *rq)
+{
+    struct blk_request **pp = &q->head;
+    struct blk_request *prev = NULL;
+
+    while (*pp && (*pp)->sector < rq->sector)
+    {
+        prev = *pp;
+        pp = &(*pp)->next;
+    }
+
+    if (prev && blk_can_merge(bd, prev, rq))
+    {
+        blk_merge(prev, rq);
+        // The grown request may now touch its successor as well
+        if (prev->next && blk_can_merge(bd, prev, prev->next))
+        {
+            struct blk_request *succ = prev->next;
+            prev->next = succ->next;
+            blk_merge(prev, succ);
+            q->count--;
+        }
+        return true;
+    }
+    if (*pp && blk_can_merge(bd, rq, *pp))
+    {
+        struct blk_request *succ = *pp;
+        rq->next = succ->next;
+        blk_merge(rq, succ);
+        *pp = rq;
+        return true;
+    }
+
+    rq->next = *pp;
+    *pp = rq;
+    q->count++;
+    return false;
+}
+
+int blk_submit(struct blk_device *bd, struct blk_request *rq)
+{
+    struct blk_swq *q;
+    uint64_t flags;
+    bool merged;
+
+    if (rq->op != BLK_FLUSH &&
+        (!rq->nr_sectors || rq->sector + rq->nr_sectors > bd->capacity))
+        return -1;
+    if (rq->mb && rq->mb->pkt_len != rq->nr_sectors << BLK_SECTOR_SHIFT)
+        return -1;
+
+    rq->next = NULL;
+    rq->merged = NULL;
+    rq->merged_tail = rq;
+    rq->total_sectors = rq->nr_sectors;
+    rq->nr_segs = rq->op == BLK_FLUSH ? 0 : rq->mb ? mbuf_nsegs(rq->mb) : 1;
+    if (rq->nr_segs > bd->max_segs)
+        return -1;
+    rq->status = 0;
+    rq->submit_ticks = read_cntvct();
+    stat_inc(blk_requests);
+
+    flags = local_irq_save();
+    q = &bd->swq[smp_processor_id()];
+    spin_lock(&q->lock);
+    merged = blk_swq_insert(bd, q, rq);
+    spin_unlock(&q->lock);
+    atomic_add_return(&bd->stats.submitted, 1);
+    if (merged)
+        atomic_add_return(&bd->stats.merged, 1);
+    if (!q->plugged)
+        blk_run_queue(bd);
+    local_irq_restore(flags);
+    return 0;
+}
+
+static struct blk_request *blk_pick(struct blk_device *bd)
+{
+    for (int i = 0; i < NR_CPUS; i++)
+    {
+        struct blk_swq *q = &bd->swq[(bd->next_swq + i) % NR_CPUS];
+        struct blk_request *rq;
+
+        if (!READ_ONCE(q->head) || q->plugged)
+            continue;
+        spin_lock(&q->lock);
+        rq = q->head;
+        if (rq)
+        {
+            q->head = rq->next;
+            q->count--;
+        }
+        spin_unlock(&q->lock);
+        if (rq)
+        {
+            bd->next_swq = (bd->next_swq + i + 1) % NR_CPUS;
+            return rq;
+        }
+    }
+    return NULL;
+}
+
+// Put a refused request back at the front of its queue
+static void blk_requeue(struct blk_device *bd, struct blk_request *rq)
+{
+    struct blk_swq *q = &bd->swq[(bd->next_swq + NR_CPUS - 1) % NR_CPUS];
+
+    spin_lock(&q->lock);
+    rq->next = q->head;
+    q->head = rq;
+    q->count++;
+    spin_unlock(&q->lock);
+}
+
+// dispatch_lock held
+static void __blk_dispatch(struct blk_device *bd)
+{
+    while (bd->inflight < bd->depth)
+    {
+        struct blk_request *rq = blk_pick(bd);
+
+        if (!rq)
+            break;
+        atomic_add_return32(&bd->inflight, 1);
+        if (bd->queue_rq(bd, rq))
+        {
+            atomic_add_return32(&bd->inflight, -1);
+            blk_requeue(bd, rq);
+            bd->stats.busy++;
+            break;
+        }
+        bd->stats.dispatched++;
+        if (bd->inflight > bd->stats.max_inflight)
+            bd->stats.max_inflight = bd->inflight;
+    }
+}
+
+// Whoever holds dispatch_lock re-checks run_pending before leaving, so a
+// failed trylock never strands a request. Each side stores (run_pending,
+// the unlock) and then loads what the other stored; without a full barrier
+// in between ARMv8 lets the load pass the store and both miss each other.
+void blk_run_queue(struct blk_device *bd)
+{
+    uint64_t flags = local_irq_save();
+
+    WRITE_ONCE(bd->run_pending, 1);
+    smp_mb(); // run_pending before the lock word is read
+    while (READ_ONCE(bd->run_pending))
+    {
+        if (spin_trylock(&bd->dispatch_lock))
+        {
+            if (READ_ONCE(bd->dispatch_lock.lock))
+                break;
+            continue; // spurious stlxr failure
+        }
+        WRITE_ONCE(bd->run_pending, 0);
+        smp_mb();
+        __blk_dispatch(bd);
+        spin_unlock(&bd->dispatch_lock);
+        smp_mb(); // the unlock before run_pending is read again
+    }
+    local_irq_restore(flags);
+}
+
+void blk_start_plug(struct blk_device *bd)
+{
+    uint64_t flags = local_irq_save();
+
+    bd->swq[smp_processor_id()].plugged++;
+    local_irq_restore(flags);
+}
+
+void blk_finish_plug(struct blk_device *bd)
+{
+    uint64_t flags = local_irq_save();
+
+    bd->swq[smp_processor_id()].plugged--;
+    local_irq_restore(flags);
+    blk_run_queue(bd);
+}
+
+// Driver side: the whole merged chain finished with `status`
+void blk_complete(struct blk_device *bd, struct blk_request *rq, int status)
+{
+    uint64_t now = read_cntvct();
+
+    atomic_add_return32(&bd->inflight, -1);
+    stat_inc(blk_completions);
+    bd->stats.completed++;
+    bd->stats.sectors += rq->total_sectors;
+    if (status)
+        bd->stats.errors++;
+
+    while (rq)
+    {
+        struct blk_request *next = rq->merged;
+
+        bd->stats.lat_ticks += now - rq->submit_ticks;
+        rq->status = status;
+        if (rq->done)
+            rq->done(rq, status);
+        rq = next;
+    }
+    blk_run_queue(bd);
+}
+
+void blk_completion_init(struct blk_completion *c)
+{
+    c->done = false;
+    c->status = 0;
+    spinlock_init(&c->lock);
+    c->wq.head = NULL;
+}
+
+void blk_complete_sync(struct blk_request *rq, int status)
+{
+    struct blk_completion *c = rq->priv;
+
+    spin_lock(&c->lock);
+    c->status = status;
+    c->done = true;
+    wait_queue_wake_all(&c->wq);
+    spin_unlock(&c->lock);
+}
+
+// Idle tasks (boot code in kernel_main) cannot block, so they spin
+int blk_wait(struct blk_completion *c)
+{
+    uint64_t flags;
+
+    if (current->pid == 0)
+    {
+        while (!READ_ONCE(c->done))
+            cpu_relax();
+        return c->status;
+    }
+
+    flags = local_irq_save();
+    spin_lock(&c->lock);
+    while (!c->done)
+        wait_queue_sleep(&c->wq, &c->lock);
+    spin_unlock(&c->lock);
+    local_irq_restore(flags);
+    return c->status;
+}
+
+static int blk_rw_sync(struct blk_device *bd, enum blk_op op, uint64_t sector, void *buf,
+                       uint32_t nr_sectors)
+{
+    struct blk_completion c;
+    struct blk_request rq;
+
+    blk_completion_init(&c);
+    rq.op = op;
+    rq.sector = sector;
+    rq.nr_sectors = nr_sectors;
+    rq.buf = buf;
+    rq.mb = NULL;
+    rq.done = blk_complete_sync;
+    rq.priv = &c;
+    if (blk_submit(bd, &rq))
+        return -1;
+    return blk_wait(&c);
+}
+
+int blk_read(struct blk_device *bd, uint64_t sector, void *buf, uint32_t nr_sectors)
+{
+    return blk_rw_sync(bd, BLK_READ, sector, buf, nr_sectors);
+}
+
+int blk_write(struct blk_device *bd, uint64_t sector, const void *buf, uint32_t nr_sectors)
+{
+    return blk_rw_sync(bd, BLK_WRITE, sector, (void *)buf, nr_sectors);
+}
+
+void blk_dump(struct blk_device *bd)
+{
+    struct blk_stats *s = &bd->stats;
+
+    tiny_info("blk %s: submitted %llu, merged %llu, dispatched %llu, completed %llu, "
+              "errors %llu, busy %llu, %llu sectors, max inflight %u/%u, avg lat %llu us\n",
+              bd->name, s->submitted, s->merged, s->dispatched, s->completed, s->errors,
+              s->busy, s->sectors, s->max_inflight, bd->depth,
+              s->submitted ? ticks_to_ns(s->lat_ticks / s->submitted) / NSEC_PER_USEC : 0);
+}
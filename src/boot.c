@@ -0,0 +1,47 @@
+/*
+ * File: boot.c
+ * Date: 2026-10-18
+ * Description: Boot hand-over state and boot-phase latency report.
+ *              startup.S fills in boot_info right after zeroing .bss.
+ */
+
+#include "boot.h"
+#include "timer.h"
+#include "tinyio.h"
+
+struct boot_info boot_info;
+
+static const char *const boot_phase_names[BOOT_TS_MAX] = {
+    [BOOT_TS_ENTRY] = "entry",
+    [BOOT_TS_MMU] = "mmu",
+    [BOOT_TS_BSS] = "bss",
+    [BOOT_TS_MAIN] = "main",
+};
+
+void boot_mark(int phase)
+{
+    if (phase >= 0 && phase < BOOT_TS_MAX)
+        boot_info.ts[phase] = read_cntvct();
+}
+
+static uint64_t ticks_to_us(uint64_t ticks)
+{
+    return ticks_to_ns(ticks) / NSEC_PER_USEC;
+}
+
+void boot_report(void)
+{
+    uint64_t *ts = boot_info.ts;
+
+    tiny_info("boot: dtb at 0x%lx\n", (unsigned long)boot_info.dtb_pa);
+    // QEMU starts the virtual counter at reset, so this is reset -> _start
+    tiny_info("boot: reset -> %s: %llu us\n", boot_phase_names[BOOT_TS_ENTRY],
+              ticks_to_us(ts[BOOT_TS_ENTRY]));
+    for (int i = BOOT_TS_ENTRY + 1; i < BOOT_TS_MAX; i++)
+    {
+        tiny_info("boot: %s -> %s: %llu us\n", boot_phase_names[i - 1],
+                  boot_phase_names[i], ticks_to_us(ts[i] - ts[i - 1]));
+    }
+    tiny_info("boot: _start -> kernel_main: %llu us\n",
+              ticks_to_us(ts[BOOT_TS_MAIN] - ts[BOOT_TS_ENTRY]));
+}
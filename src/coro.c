@@ -0,0 +1,202 @@
+/*
+ * File: coro.c
+ * Date: 2026-10-18
+ * Description: Stackless coroutines: per-CPU event loop threads, wakeups
+ *              from timers, block completions and one-shot events.
+ */
+
+#include "coro.h"
+#include "atomic.h"
+#include "blk.h"
+#include "irq.h"
+#include "shell.h"
+#include "smp.h"
+#include "stats.h"
+#include "tinystd.h"
+
+static DEFINE_PER_CPU_ALIGNED(struct coro_loop, coro_loop);
+
+STAT_REGISTER(coro_resumes, "coroutine resumptions", &coro_loop.resumes);
+STAT_REGISTER(coro_wakeups, "coroutine wakeups", &coro_loop.wakeups);
+
+// Any context, any CPU: the coroutine runs next on its own CPU's loop
+void coro_wake(struct coro *co, int result)
+{
+    struct coro_loop *lp = per_cpu_ptr(&coro_loop, co->cpu);
+    uint64_t flags = local_irq_save();
+
+    spin_lock(&lp->lock);
+    co->result = result;
+    if (!co->queued)
+    {
+        co->queued = 1;
+        co->next = NULL;
+        if (lp->tail)
+            lp->tail->next = co;
+        else
+            lp->head = co;
+        lp->tail = co;
+    }
+    lp->wakeups++;
+    wait_queue_wake_all(&lp->wq);
+    spin_unlock(&lp->lock);
+    local_irq_restore(flags);
+}
+
+static struct coro *coro_next(struct coro_loop *lp)
+{
+    uint64_t flags = local_irq_save();
+    struct coro *co;
+
+    spin_lock(&lp->lock);
+    while (!lp->head)
+        wait_queue_sleep(&lp->wq, &lp->lock);
+    co = lp->head;
+    lp->head = co->next;
+    if (!lp->head)
+        lp->tail = NULL;
+    co->queued = 0;
+    lp->resumes++;
+    spin_unlock(&lp->lock);
+    local_irq_restore(flags);
+    return co;
+}
+
+static void coro_loop_thread(void *arg)
+{
+    struct coro_loop *lp = this_cpu_ptr(&coro_loop);
+
+    while (1)
+    {
+        struct coro *co = coro_next(lp);
+
+        if (co->fn(co) == CORO_DONE)
+        {
+            atomic_add_return(&lp->live, -1);
+            if (co->done)
+                co->done(co);
+        }
+        cond_resched();
+    }
+}
+
+void coro_init(void)
+{
+    int cpu;
+
+    for_each_online_cpu(cpu)
+    {
+        struct coro_loop *lp = per_cpu_ptr(&coro_loop, cpu);
+        char name[TASK_NAME_LEN];
+
+        spinlock_init(&lp->lock);
+        snprintf(name, sizeof(name), "coro/%d", cpu);
+        lp->task = kthread_create(name, coro_loop_thread, NULL, cpu, PRIO_NORMAL);
+        if (!lp->task)
+            tiny_error("coro: cannot start the loop on cpu%d\n", cpu);
+    }
+}
+
+// co->done, if wanted, must be set before this; an offline cpu means this one
+void coro_start(struct coro *co, coro_fn_t fn, void *arg, int cpu)
+{
+    if (cpu < 0 || cpu >= NR_CPUS || !cpu_online(cpu) || !per_cpu_ptr(&coro_loop, cpu)->task)
+        cpu = smp_processor_id();
+    co->resume = 0;
+    co->queued = 0;
+    co->cpu = cpu;
+    co->result = 0;
+    co->fn = fn;
+    co->arg = arg;
+    co->timer.armed = false;
+    atomic_add_return(&per_cpu_ptr(&coro_loop, cpu)->live, 1);
+    coro_wake(co, 0);
+}
+
+static void coro_timer_fn(struct timer_event *ev)
+{
+    coro_wake(ev->data, 0);
+}
+
+// Runs on the coroutine's own CPU, so the timer fires there too
+void coro_sleep_arm(struct coro *co, uint64_t ns)
+{
+    co->timer.fn = coro_timer_fn;
+    co->timer.data = co;
+    timer_add(&co->timer, read_cntvct() + ns_to_ticks(ns));
+}
+
+void coro_event_init(struct coro_event *ev)
+{
+    spinlock_init(&ev->lock);
+    ev->fired = false;
+    ev->result = 0;
+    ev->waiter = NULL;
+}
+
+void coro_event_signal(struct coro_event *ev, int result)
+{
+    uint64_t flags = local_irq_save();
+    struct coro *waiter;
+
+    spin_lock(&ev->lock);
+    ev->fired = true;
+    ev->result = result;
+    waiter = ev->waiter;
+    ev->waiter = NULL;
+    spin_unlock(&ev->lock);
+    local_irq_restore(flags);
+    if (waiter)
+        coro_wake(waiter, result);
+}
+
+// Already signalled: resume straight away with its result
+void coro_event_arm(struct coro *co, struct coro_event *ev)
+{
+    uint64_t flags = local_irq_save();
+    bool fired;
+
+    spin_lock(&ev->lock);
+    fired = ev->fired;
+    if (!fired)
+        ev->waiter = co;
+    spin_unlock(&ev->lock);
+    local_irq_restore(flags);
+    if (fired)
+        coro_wake(co, ev->result);
+}
+
+static void coro_blk_done(struct blk_request *rq, int status)
+{
+    coro_wake(rq->priv, status);
+}
+
+// A request the block layer refuses completes at once with -1
+void coro_blk_arm(struct coro *co, struct blk_device *bd, struct blk_request *rq)
+{
+    rq->done = coro_blk_done;
+    rq->priv = co;
+    if (blk_submit(bd, rq))
+        coro_wake(co, -1);
+}
+
+void coro_dump(void)
+{
+    int cpu;
+
+    tiny_info("coro: per-CPU event loops\n");
+    for_each_online_cpu(cpu)
+    {
+        struct coro_loop *lp = per_cpu_ptr(&coro_loop, cpu);
+
+        printf("  cpu%d: live %llu, resumes %llu, wakeups %llu%s\n", cpu, lp->live,
+               lp->resumes, lp->wakeups, lp->head ? ", ready" : "");
+    }
+}
+
+static int cmd_coro(int argc, char **argv)
+{
+    coro_dump();
+    return 0;
+}
+SHELL_CMD(coro, "coroutine event loops", cmd_coro);
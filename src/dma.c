@@ -0,0 +1,199 @@
+/*
+ * File: dma.c
+ * Date: 2026-10-18
+ * Description: DMA mapping: coherent allocations, streaming buffer cache
+ *              maintenance by line range with batched barriers.
+ */
+
+#include "dma.h"
+#include "mmap.h"
+#include "mmu.h"
+#include "page_alloc.h"
+#include "tinystd.h"
+#include "virtio.h"
+
+#define CTR_DMINLINE_SHIFT 16
+#define CTR_DMINLINE_MASK 0xf
+
+static uint32_t dcache_line = 64; // until dma_init() reads CTR_EL0
+
+void dma_init(void)
+{
+    uint64_t ctr;
+
+    __asm__ volatile("mrs %0, ctr_el0" : "=r"(ctr));
+    dcache_line = 4U << ((ctr >> CTR_DMINLINE_SHIFT) & CTR_DMINLINE_MASK);
+    tiny_debug("dma: %u-byte data cache lines\n", dcache_line);
+}
+
+uint32_t dma_cache_line(void)
+{
+    return dcache_line;
+}
+
+// Each loop walks [addr, addr + size) by line; the caller issues the dsb
+#define DCACHE_RANGE_OP(name, insn)                                  \
+    static void name(uint64_t addr, uint64_t size)                  \
+    {                                                               \
+        uint64_t end = addr + size;                                 \
+                                                                    \
+        for (addr &= ~(uint64_t)(dcache_line - 1); addr < end;      \
+             addr += dcache_line)                                   \
+            __asm__ volatile(insn ", %0" ::"r"(addr) : "memory");   \
+    }
+
+DCACHE_RANGE_OP(dcache_clean_range, "dc cvac")
+DCACHE_RANGE_OP(dcache_clean_inval_range, "dc civac")
+
+// A partial line at either end also holds CPU data next to the buffer, so
+// it is cleaned and invalidated; only whole lines are simply discarded
+static void dcache_inval_range(uint64_t addr, uint64_t size)
+{
+    uint64_t mask = dcache_line - 1;
+    uint64_t end = addr + size;
+
+    if (end & mask)
+    {
+        end &= ~mask;
+        __asm__ volatile("dc civac, %0" ::"r"(end) : "memory");
+    }
+    if (addr & mask)
+    {
+        __asm__ volatile("dc civac, %0" ::"r"(addr & ~mask) : "memory");
+        addr = (addr | mask) + 1;
+    }
+    for (; addr < end; addr += dcache_line)
+        __asm__ volatile("dc ivac, %0" ::"r"(addr) : "memory");
+}
+
+// RAM is identity mapped; anything else is a KMAP alias
+static dma_addr_t dma_virt_to_phys(void *cpu)
+{
+    vaddr_t va = (vaddr_t)cpu;
+    uint64_t *pte;
+
+    if (va < KMAP_BASE || va >= KMAP_END)
+        return va;
+    pte = mm_walk(&init_mm, va, false);
+    if (!pte || !(*pte & PTE_VALID))
+        return 0;
+    return (*pte & PTE_ADDR_MASK) | (va & (PAGE_SIZE - 1));
+}
+
+static uint32_t dma_order(uint64_t size)
+{
+    uint32_t order = 0;
+
+    while ((PAGE_SIZE << order) < size)
+        order++;
+    return order;
+}
+
+// Zeroed; non-coherent devices get a non-cacheable KMAP alias of the pages
+void *dma_alloc_coherent(const struct dma_dev *dev, uint64_t size, dma_addr_t *handle)
+{
+    uint32_t order = dma_order(size);
+    uint8_t *mem = alloc_zeroed_pages(order);
+    vaddr_t va;
+
+    if (!mem)
+        return NULL;
+    *handle = (dma_addr_t)mem;
+    if (dev && dev->coherent)
+        return mem;
+
+    // No dirty line of the cacheable alias may land on top of device writes
+    dcache_clean_inval_range((uint64_t)mem, PAGE_SIZE << order);
+    dma_sync_fence();
+    va = kmap_reserve(PAGE_SIZE << order, PAGE_SIZE);
+    if (!va)
+        goto fail;
+    for (uint64_t off = 0; off < (PAGE_SIZE << order); off += PAGE_SIZE)
+    {
+        if (mm_map_page(&init_mm, va + off, (paddr_t)mem + off,
+                        PROT_KERNEL | PROT_READ | PROT_WRITE | PROT_NOCACHE, false))
+            goto fail; // the KMAP range is lost, as any kmap_reserve() one
+    }
+    __asm__ volatile("isb" ::: "memory");
+    return (void *)va;
+
+fail:
+    free_pages(mem, order);
+    return NULL;
+}
+
+void dma_free_coherent(const struct dma_dev *dev, void *cpu, uint64_t size)
+{
+    uint32_t order = dma_order(size);
+    dma_addr_t pa = dma_virt_to_phys(cpu);
+
+    if (!(dev && dev->coherent))
+    {
+        for (uint64_t off = 0; off < (PAGE_SIZE << order); off += PAGE_SIZE)
+            mm_unmap_page(&init_mm, (vaddr_t)cpu + off);
+    }
+    free_pages((void *)pa, order);
+}
+
+void __dma_sync_for_device(const struct dma_dev *dev, dma_addr_t addr, uint64_t size,
+                           enum dma_dir dir)
+{
+    if (dev && dev->coherent)
+        return;
+    if (dir == DMA_TO_DEVICE)
+        dcache_clean_range(addr, size);
+    else
+        dcache_clean_inval_range(addr, size); // partial lines at the ends keep CPU data
+}
+
+// Lines the CPU pulled in speculatively while the device owned the buffer
+void __dma_sync_for_cpu(const struct dma_dev *dev, dma_addr_t addr, uint64_t size,
+                        enum dma_dir dir)
+{
+    if ((dev && dev->coherent) || dir == DMA_TO_DEVICE)
+        return;
+    dcache_inval_range(addr, size);
+}
+
+void dma_sync_for_device(const struct dma_dev *dev, dma_addr_t addr, uint64_t size,
+                         enum dma_dir dir)
+{
+    if (dev && dev->coherent)
+        return;
+    __dma_sync_for_device(dev, addr, size, dir);
+    dma_sync_fence();
+}
+
+void dma_sync_for_cpu(const struct dma_dev *dev, dma_addr_t addr, uint64_t size,
+                      enum dma_dir dir)
+{
+    if ((dev && dev->coherent) || dir == DMA_TO_DEVICE)
+        return;
+    __dma_sync_for_cpu(dev, addr, size, dir);
+    dma_sync_fence();
+}
+
+dma_addr_t dma_map(const struct dma_dev *dev, void *cpu, uint64_t size, enum dma_dir dir)
+{
+    dma_addr_t addr = dma_virt_to_phys(cpu);
+
+    if (addr)
+        dma_sync_for_device(dev, addr, size, dir);
+    return addr;
+}
+
+void dma_unmap(const struct dma_dev *dev, dma_addr_t addr, uint64_t size, enum dma_dir dir)
+{
+    dma_sync_for_cpu(dev, addr, size, dir);
+}
+
+// One scatter-gather chain, one barrier
+void dma_sync_sg_for_device(const struct dma_dev *dev, const struct vq_buf *bufs, uint32_t n)
+{
+    if (dev && dev->coherent)
+        return;
+    for (uint32_t i = 0; i < n; i++)
+        __dma_sync_for_device(dev, bufs[i].addr, bufs[i].len,
+                              bufs[i].write ? DMA_FROM_DEVICE : DMA_TO_DEVICE);
+    dma_sync_fence();
+}
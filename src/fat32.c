@@ -0,0 +1,311 @@
+/*
+ * File: fat32.c
+ * Date: 2026-10-18
+ * Description: Read-only FAT32 for the page cache. Finds the volume on
+ *              the first block device (bare or in MBR partition 1), looks
+ *              up 8.3 paths and turns cluster chains into extent lists.
+ */
+
+#include "fat32.h"
+#include "page_alloc.h"
+#include "spin_lock.h"
+#include "tinystd.h"
+
+#define FAT_EOC 0x0ffffff8
+#define FAT_ENTRY_MASK 0x0fffffff
+
+#define DIRENT_SIZE 32
+#define ATTR_VOLUME_ID 0x08
+#define ATTR_DIRECTORY 0x10
+#define ATTR_LFN 0x0f
+#define DIRENT_FREE 0xe5
+
+static struct fat_volume vol;
+static bool vol_mounted;
+
+// Open files live until shutdown, so mappings can keep pointers to them
+static struct fat_file fat_files[FAT_MAX_OPEN];
+static uint32_t fat_nr_files;
+static spinlock_t fat_files_lock;
+
+static inline uint16_t le16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool fat32_bpb_valid(const uint8_t *bs)
+{
+    return bs[510] == 0x55 && bs[511] == 0xaa && le16(bs + 11) == BLK_SECTOR_SIZE &&
+           bs[13] && !(bs[13] & (bs[13] - 1)) && le16(bs + 17) == 0 && le32(bs + 36) &&
+           !memcmp(bs + 82, "FAT32   ", 8);
+}
+
+int fat32_mount(struct blk_device *bd)
+{
+    uint8_t *bs = alloc_page();
+    int ret = -1;
+
+    if (!bs)
+        return -1;
+    vol.part_start = 0;
+    if (blk_read(bd, 0, bs, 1))
+        goto out;
+    if (!fat32_bpb_valid(bs))
+    {
+        // MBR: take partition 1 if it is FAT32 (LBA)
+        uint8_t type = bs[446 + 4];
+        if (bs[510] != 0x55 || bs[511] != 0xaa || (type != 0x0b && type != 0x0c))
+            goto out;
+        vol.part_start = le32(bs + 446 + 8);
+        if (blk_read(bd, vol.part_start, bs, 1) || !fat32_bpb_valid(bs))
+            goto out;
+    }
+
+    vol.bd = bd;
+    vol.sectors_per_cluster = bs[13];
+    vol.cluster_shift = __builtin_ctz(bs[13]);
+    vol.fat_start = vol.part_start + le16(bs + 14);
+    vol.data_start = vol.fat_start + (uint64_t)bs[16] * le32(bs + 36);
+    vol.root_cluster = le32(bs + 44);
+    vol.nr_clusters = (le32(bs + 32) - (vol.data_start - vol.part_start)) >> vol.cluster_shift;
+    vol_mounted = true;
+    tiny_info("fat32: %s at sector %llu, %u clusters of %u bytes, root cluster %u\n",
+              bd->name, vol.part_start, vol.nr_clusters,
+              vol.sectors_per_cluster * BLK_SECTOR_SIZE, vol.root_cluster);
+    ret = 0;
+out:
+    if (ret)
+        tiny_warn("fat32: no FAT32 volume on %s\n", bd->name);
+    free_page(bs);
+    return ret;
+}
+
+bool fat32_mounted(void)
+{
+    return vol_mounted;
+}
+
+struct blk_device *fat32_bdev(void)
+{
+    return vol.bd;
+}
+
+static inline uint64_t cluster_sector(uint32_t cluster)
+{
+    return vol.data_start + ((uint64_t)(cluster - 2) << vol.cluster_shift);
+}
+
+static bool cluster_valid(uint32_t cluster)
+{
+    return cluster >= 2 && cluster - 2 < vol.nr_clusters;
+}
+
+// Next cluster in the chain, 0 at the end or on error. `buf` caches one
+// FAT sector, tagged with its number in *cached.
+static uint32_t fat_next(uint32_t cluster, uint8_t *buf, uint64_t *cached)
+{
+    uint64_t off = (uint64_t)cluster * 4;
+    uint64_t sector = vol.fat_start + off / BLK_SECTOR_SIZE;
+    uint32_t next;
+
+    if (*cached != sector)
+    {
+        if (blk_read(vol.bd, sector, buf, 1))
+            return 0;
+        *cached = sector;
+    }
+    next = le32(buf + off % BLK_SECTOR_SIZE) & FAT_ENTRY_MASK;
+    return next < FAT_EOC && cluster_valid(next) ? next : 0;
+}
+
+// "readme.txt" -> "README  TXT"; false if it is not a valid 8.3 name
+static bool fat_short_name(const char *s, uint32_t len, char out[11])
+{
+    uint32_t i = 0, o = 0;
+
+    memset(out, ' ', 11);
+    for (; i < len && s[i] != '.'; i++)
+    {
+        if (o >= 8)
+            return false;
+        out[o++] = s[i] >= 'a' && s[i] <= 'z' ? s[i] - 'a' + 'A' : s[i];
+    }
+    if (i < len)
+    {
+        o = 8;
+        for (i++; i < len; i++)
+        {
+            if (o >= 11 || s[i] == '.')
+                return false;
+            out[o++] = s[i] >= 'a' && s[i] <= 'z' ? s[i] - 'a' + 'A' : s[i];
+        }
+    }
+    return len && out[0] != ' ';
+}
+
+// Look `name` up in the directory starting at `dir`; fills *entry (32 bytes)
+static int fat_lookup(uint32_t dir, const char name[11], uint8_t *entry, uint8_t *buf)
+{
+    uint8_t *fat_buf = buf + BLK_SECTOR_SIZE * vol.sectors_per_cluster;
+    uint64_t fat_cached = ~0ULL;
+    uint32_t cluster_bytes = vol.sectors_per_cluster * BLK_SECTOR_SIZE;
+
+    while (dir)
+    {
+        if (blk_read(vol.bd, cluster_sector(dir), buf, vol.sectors_per_cluster))
+            return -1;
+        for (uint32_t off = 0; off < cluster_bytes; off += DIRENT_SIZE)
+        {
+            uint8_t *de = buf + off;
+
+            if (de[0] == 0)
+                return -1; // end of directory
+            if (de[0] == DIRENT_FREE || de[11] == ATTR_LFN || (de[11] & ATTR_VOLUME_ID))
+                continue;
+            if (!memcmp(de, name, 11))
+            {
+                memcpy(entry, de, DIRENT_SIZE);
+                return 0;
+            }
+        }
+        dir = fat_next(dir, fat_buf, &fat_cached);
+    }
+    return -1;
+}
+
+static int fat_build_extents(struct fat_file *f, uint8_t *fat_buf)
+{
+    uint64_t fat_cached = ~0ULL;
+    uint32_t cluster = f->first_cluster;
+    uint32_t index = 0;
+
+    f->nr_extents = 0;
+    while (cluster)
+    {
+        struct fat_extent *e = f->nr_extents ? &f->extents[f->nr_extents - 1] : NULL;
+
+        if (e && e->cluster + e->count == cluster)
+        {
+            e->count++;
+        }
+        else
+        {
+            if (f->nr_extents == FAT_MAX_EXTENTS)
+                return -1; // too fragmented
+            e = &f->extents[f->nr_extents++];
+            e->file_cluster = index;
+            e->cluster = cluster;
+            e->count = 1;
+        }
+        index++;
+        if ((uint64_t)index << (vol.cluster_shift + BLK_SECTOR_SHIFT) >= f->size)
+            break;
+        cluster = fat_next(cluster, fat_buf, &fat_cached);
+    }
+    return 0;
+}
+
+static struct fat_file *fat_find_open(const char *path)
+{
+    for (uint32_t i = 0; i < fat_nr_files; i++)
+    {
+        if (!strcmp(fat_files[i].path, path))
+            return &fat_files[i];
+    }
+    return NULL;
+}
+
+// Opening the same path twice returns the same file, so the page cache
+// is shared by everyone mapping it
+struct fat_file *fat32_open(const char *path)
+{
+    struct fat_file tmp, *f;
+    uint8_t entry[DIRENT_SIZE];
+    uint8_t *buf;
+    uint32_t dir;
+    char name[11];
+    int order = 0;
+
+    if (!vol_mounted || strlen(path) >= FAT_NAME_LEN)
+        return NULL;
+    spin_lock(&fat_files_lock);
+    f = fat_find_open(path);
+    spin_unlock(&fat_files_lock);
+    if (f)
+        return f;
+
+    // One cluster of directory data plus one FAT sector
+    while ((PAGE_SIZE << order) < (vol.sectors_per_cluster + 1) * BLK_SECTOR_SIZE)
+        order++;
+    buf = alloc_pages(order);
+    if (!buf)
+        return NULL;
+
+    dir = vol.root_cluster;
+    memset(entry, 0, sizeof(entry));
+    entry[11] = ATTR_DIRECTORY;
+    for (const char *p = path; *p;)
+    {
+        const char *end;
+
+        while (*p == '/')
+            p++;
+        if (!*p)
+            break;
+        for (end = p; *end && *end != '/'; end++)
+            ;
+        if (!(entry[11] & ATTR_DIRECTORY) || !fat_short_name(p, end - p, name) ||
+            fat_lookup(dir, name, entry, buf))
+            goto fail;
+        dir = ((uint32_t)le16(entry + 20) << 16) | le16(entry + 26);
+        p = end;
+    }
+    if (entry[11] & ATTR_DIRECTORY)
+        goto fail;
+
+    memset(&tmp, 0, sizeof(tmp));
+    snprintf(tmp.path, FAT_NAME_LEN, "%s", path);
+    tmp.size = le32(entry + 28);
+    tmp.first_cluster = cluster_valid(dir) ? dir : 0;
+    if (tmp.size && (!tmp.first_cluster || fat_build_extents(&tmp, buf)))
+        goto fail;
+    free_pages(buf, order);
+
+    spin_lock(&fat_files_lock);
+    f = fat_find_open(path);
+    if (!f && fat_nr_files < FAT_MAX_OPEN)
+    {
+        f = &fat_files[fat_nr_files];
+        memcpy(f, &tmp, sizeof(tmp));
+        fat_nr_files++;
+    }
+    spin_unlock(&fat_files_lock);
+    if (f)
+        tiny_debug("fat32: %s, %u bytes in %u extent(s)\n", f->path, f->size, f->nr_extents);
+    return f;
+
+fail:
+    free_pages(buf, order);
+    return NULL;
+}
+
+// Disk sector holding sector `file_sector` of the file, -1 past the chain
+int64_t fat32_bmap(const struct fat_file *f, uint64_t file_sector)
+{
+    uint64_t index = file_sector >> vol.cluster_shift;
+
+    for (uint32_t i = 0; i < f->nr_extents; i++)
+    {
+        const struct fat_extent *e = &f->extents[i];
+
+        if (index >= e->file_cluster && index < e->file_cluster + e->count)
+            return cluster_sector(e->cluster + (index - e->file_cluster)) +
+                   (file_sector & (vol.sectors_per_cluster - 1));
+    }
+    return -1;
+}
@@ -0,0 +1,360 @@
+/*
+ * File: fdt.c
+ * Date: 2026-10-18
+ * Description: Zero-allocation flattened device tree walker. One pass over
+ *              the structure block at boot fills dev_table with the memory
+ *              bank, PL011, GIC, timer PPIs, PSCI conduit and virtio-mmio
+ *              slots; nothing looks at the blob again afterwards.
+ */
+
+#include "fdt.h"
+#include "config.h"
+#include "mmu.h"
+#include "tinystd.h"
+
+#define FDT_BEGIN_NODE 0x1
+#define FDT_END_NODE 0x2
+#define FDT_PROP 0x3
+#define FDT_NOP 0x4
+#define FDT_END 0x9
+
+#define FDT_ALIGN(x) (((x) + 3) & ~3U)
+
+struct fdt_header
+{
+    uint32_t magic;
+    uint32_t totalsize;
+    uint32_t off_dt_struct;
+    uint32_t off_dt_strings;
+    uint32_t off_mem_rsvmap;
+    uint32_t version;
+    uint32_t last_comp_version;
+    uint32_t boot_cpuid_phys;
+    uint32_t size_dt_strings;
+    uint32_t size_dt_struct;
+};
+
+// Properties of interest collected while walking one node
+struct fdt_node
+{
+    const char *compatible;
+    uint32_t compatible_len;
+    const char *device_type;
+    const char *method;
+    const uint8_t *reg;
+    uint32_t reg_len;
+    const uint8_t *interrupts;
+    uint32_t interrupts_len;
+    bool dma_coherent;
+    uint32_t address_cells; // applies to the children of this node
+    uint32_t size_cells;
+};
+
+struct device_table dev_table;
+
+static inline uint32_t fdt32(const void *p)
+{
+    return __builtin_bswap32(*(const uint32_t *)p);
+}
+
+static uint64_t fdt_cells(const uint8_t *p, uint32_t cells)
+{
+    uint64_t val = 0;
+
+    while (cells--)
+    {
+        val = (val << 32) | fdt32(p);
+        p += 4;
+    }
+    return val;
+}
+
+static bool fdt_compatible(const struct fdt_node *node, const char *compat)
+{
+    const char *s = node->compatible;
+    const char *end = s + node->compatible_len;
+
+    while (s && s < end)
+    {
+        if (strcmp(s, compat) == 0)
+            return true;
+        s += strlen(s) + 1;
+    }
+    return false;
+}
+
+static bool fdt_reg(const struct fdt_node *node, const struct fdt_node *parent,
+                    int index, struct fdt_reg *out)
+{
+    uint32_t stride = (parent->address_cells + parent->size_cells) * 4;
+
+    if (!node->reg || stride == 0 || (uint32_t)(index + 1) * stride > node->reg_len)
+        return false;
+    out->base = fdt_cells(node->reg + index * stride, parent->address_cells);
+    out->size = fdt_cells(node->reg + index * stride + parent->address_cells * 4,
+                          parent->size_cells);
+    return true;
+}
+
+// GIC interrupt specifier: <type number flags>, type 0 = SPI, 1 = PPI
+static uint32_t fdt_irq(const struct fdt_node *node, int index)
+{
+    const uint8_t *spec = node->interrupts + index * 12;
+
+    if (!node->interrupts || (uint32_t)(index + 1) * 12 > node->interrupts_len)
+        return 0;
+    return fdt32(spec + 4) + (fdt32(spec) == 1 ? 16 : 32);
+}
+
+static void fdt_add_virtio(const struct fdt_node *node, const struct fdt_node *parent)
+{
+    struct fdt_reg reg;
+    uint32_t i;
+
+    if (dev_table.nr_virtio >= FDT_MAX_VIRTIO || !fdt_reg(node, parent, 0, &reg))
+        return;
+
+    // QEMU emits the slots top-down; keep the table sorted by address
+    i = dev_table.nr_virtio++;
+    while (i > 0 && dev_table.virtio[i - 1].base > reg.base)
+    {
+        dev_table.virtio[i] = dev_table.virtio[i - 1];
+        i--;
+    }
+    dev_table.virtio[i].base = reg.base;
+    dev_table.virtio[i].size = reg.size;
+    dev_table.virtio[i].irq = fdt_irq(node, 0);
+    dev_table.virtio[i].dma_coherent = node->dma_coherent;
+}
+
+static void fdt_node_done(const struct fdt_node *node, const struct fdt_node *parent)
+{
+    if (node->device_type && strcmp(node->device_type, "memory") == 0)
+    {
+        if (dev_table.memory.size == 0)
+            fdt_reg(node, parent, 0, &dev_table.memory);
+    }
+    else if (node->device_type && strcmp(node->device_type, "cpu") == 0)
+    {
+        dev_table.nr_cpus++;
+    }
+
+    if (!node->compatible)
+        return;
+
+    if (fdt_compatible(node, "arm,pl011"))
+    {
+        if (dev_table.uart.base == 0)
+        {
+            fdt_reg(node, parent, 0, &dev_table.uart);
+            dev_table.uart_irq = fdt_irq(node, 0);
+        }
+    }
+    else if (fdt_compatible(node, "arm,cortex-a15-gic") || fdt_compatible(node, "arm,gic-400"))
+    {
+        dev_table.gic_version = 2;
+        fdt_reg(node, parent, 0, &dev_table.gic_dist);
+        fdt_reg(node, parent, 1, &dev_table.gic_cpu);
+    }
+    else if (fdt_compatible(node, "arm,gic-v3"))
+    {
+        dev_table.gic_version = 3;
+        fdt_reg(node, parent, 0, &dev_table.gic_dist);
+        fdt_reg(node, parent, 1, &dev_table.gic_cpu);
+    }
+    else if (fdt_compatible(node, "arm,armv8-timer"))
+    {
+        for (int i = 0; i < TIMER_IRQ_MAX; i++)
+            dev_table.timer_irq[i] = fdt_irq(node, i);
+    }
+    else if (fdt_compatible(node, "virtio,mmio"))
+    {
+        fdt_add_virtio(node, parent);
+    }
+    else if (fdt_compatible(node, "arm,psci") || fdt_compatible(node, "arm,psci-0.2") ||
+             fdt_compatible(node, "arm,psci-1.0"))
+    {
+        dev_table.psci_hvc = node->method && strcmp(node->method, "hvc") == 0;
+    }
+}
+
+static void fdt_node_prop(struct fdt_node *node, const char *name,
+                          const uint8_t *val, uint32_t len)
+{
+    if (strcmp(name, "compatible") == 0)
+    {
+        node->compatible = (const char *)val;
+        node->compatible_len = len;
+    }
+    else if (strcmp(name, "device_type") == 0)
+        node->device_type = (const char *)val;
+    else if (strcmp(name, "reg") == 0)
+    {
+        node->reg = val;
+        node->reg_len = len;
+    }
+    else if (strcmp(name, "interrupts") == 0)
+    {
+        node->interrupts = val;
+        node->interrupts_len = len;
+    }
+    else if (strcmp(name, "method") == 0)
+        node->method = (const char *)val;
+    else if (strcmp(name, "dma-coherent") == 0)
+        node->dma_coherent = true;
+    else if (strcmp(name, "#address-cells") == 0 && len == 4)
+        node->address_cells = fdt32(val);
+    else if (strcmp(name, "#size-cells") == 0 && len == 4)
+        node->size_cells = fdt32(val);
+}
+
+static int fdt_walk(const uint8_t *blob)
+{
+    const struct fdt_header *hdr = (const struct fdt_header *)blob;
+    uint32_t totalsize = fdt32(&hdr->totalsize);
+    const char *strings = (const char *)blob + fdt32(&hdr->off_dt_strings);
+    const uint8_t *p = blob + fdt32(&hdr->off_dt_struct);
+    const uint8_t *end = blob + totalsize;
+    struct fdt_node stack[FDT_MAX_DEPTH];
+    int depth = -1;
+
+    while (p + 4 <= end)
+    {
+        uint32_t token = fdt32(p);
+        p += 4;
+
+        switch (token)
+        {
+        case FDT_BEGIN_NODE:
+            if (++depth >= FDT_MAX_DEPTH)
+                return -1;
+            memset(&stack[depth], 0, sizeof(stack[depth]));
+            stack[depth].address_cells = 2;
+            stack[depth].size_cells = 1;
+            p += FDT_ALIGN(strlen((const char *)p) + 1);
+            break;
+        case FDT_PROP:
+        {
+            uint32_t len = fdt32(p);
+            const char *name = strings + fdt32(p + 4);
+            if (depth < 0)
+                return -1;
+            fdt_node_prop(&stack[depth], name, p + 8, len);
+            p += 8 + FDT_ALIGN(len);
+            break;
+        }
+        case FDT_END_NODE:
+            if (depth < 0)
+                return -1;
+            if (depth > 0)
+                fdt_node_done(&stack[depth], &stack[depth - 1]);
+            depth--;
+            break;
+        case FDT_NOP:
+            break;
+        case FDT_END:
+            return depth == -1 ? 0 : -1;
+        default:
+            return -1;
+        }
+    }
+    return -1;
+}
+
+// Only dereference candidates inside the RAM window the boot page table maps
+static bool fdt_probe(paddr_t pa)
+{
+    const struct fdt_header *hdr = (const struct fdt_header *)pa;
+    paddr_t ram_end = DEFAULT_RAM_BASE + (paddr_t)BOOT_RAM_GB * L1_BLOCK_SIZE;
+
+    if (pa < DEFAULT_RAM_BASE || pa + sizeof(*hdr) > ram_end || (pa & 7))
+        return false;
+    if (fdt32(&hdr->magic) != FDT_MAGIC || fdt32(&hdr->version) < 16)
+        return false;
+    return pa + fdt32(&hdr->totalsize) <= ram_end;
+}
+
+static void fdt_defaults(void)
+{
+    memset(&dev_table, 0, sizeof(dev_table));
+    dev_table.memory.base = DEFAULT_RAM_BASE;
+    dev_table.memory.size = (uint64_t)BOOT_RAM_GB * L1_BLOCK_SIZE;
+    dev_table.uart.base = UART_BASE_ADDR;
+    dev_table.uart.size = 0x1000;
+    dev_table.uart_irq = DEFAULT_UART_IRQ;
+    dev_table.gic_version = 2;
+    dev_table.gic_dist.base = DEFAULT_GIC_DIST_BASE;
+    dev_table.gic_dist.size = 0x10000;
+    dev_table.gic_cpu.base = DEFAULT_GIC_CPU_BASE;
+    dev_table.gic_cpu.size = 0x10000;
+    dev_table.timer_irq[TIMER_IRQ_SEC_PHYS] = 29;
+    dev_table.timer_irq[TIMER_IRQ_PHYS] = 30;
+    dev_table.timer_irq[TIMER_IRQ_VIRT] = 27;
+    dev_table.timer_irq[TIMER_IRQ_HYP] = 26;
+    dev_table.nr_cpus = 1;
+    dev_table.psci_hvc = true;
+    dev_table.nr_virtio = DEFAULT_VIRTIO_SLOTS;
+    for (uint32_t i = 0; i < DEFAULT_VIRTIO_SLOTS; i++)
+    {
+        dev_table.virtio[i].base = DEFAULT_VIRTIO_BASE + i * DEFAULT_VIRTIO_STRIDE;
+        dev_table.virtio[i].size = DEFAULT_VIRTIO_STRIDE;
+        dev_table.virtio[i].irq = DEFAULT_VIRTIO_IRQ + i;
+    }
+}
+
+int fdt_init(paddr_t dtb_pa)
+{
+    struct device_table defaults;
+
+    fdt_defaults();
+    if (!fdt_probe(dtb_pa))
+        dtb_pa = FDT_FALLBACK_ADDR;
+    if (!fdt_probe(dtb_pa))
+    {
+        tiny_warn("fdt: no device tree found, using QEMU virt defaults\n");
+        return -1;
+    }
+
+    // Walk into a clean table, then fill anything the blob did not describe
+    defaults = dev_table;
+    memset(&dev_table, 0, sizeof(dev_table));
+    if (fdt_walk((const uint8_t *)dtb_pa) < 0)
+    {
+        tiny_warn("fdt: malformed device tree at 0x%lx, using defaults\n", (unsigned long)dtb_pa);
+        dev_table = defaults;
+        return -1;
+    }
+
+    if (dev_table.memory.size == 0)
+        dev_table.memory = defaults.memory;
+    if (dev_table.uart.base == 0)
+    {
+        dev_table.uart = defaults.uart;
+        dev_table.uart_irq = defaults.uart_irq;
+    }
+    if (dev_table.gic_version == 0)
+    {
+        dev_table.gic_version = defaults.gic_version;
+        dev_table.gic_dist = defaults.gic_dist;
+        dev_table.gic_cpu = defaults.gic_cpu;
+    }
+    if (dev_table.timer_irq[TIMER_IRQ_VIRT] == 0)
+        memcpy(dev_table.timer_irq, defaults.timer_irq, sizeof(dev_table.timer_irq));
+    if (dev_table.nr_cpus == 0)
+        dev_table.nr_cpus = 1;
+    dev_table.valid = true;
+    return 0;
+}
+
+void fdt_dump(void)
+{
+    tiny_info("fdt: memory 0x%llx size 0x%llx, %u cpu(s), psci %s\n",
+              dev_table.memory.base, dev_table.memory.size, dev_table.nr_cpus,
+              dev_table.psci_hvc ? "hvc" : "smc");
+    tiny_info("fdt: uart 0x%llx irq %u, gicv%u dist 0x%llx cpu 0x%llx\n",
+              dev_table.uart.base, dev_table.uart_irq, dev_table.gic_version,
+              dev_table.gic_dist.base, dev_table.gic_cpu.base);
+    tiny_info("fdt: timer ppi virt %u phys %u, %u virtio-mmio slot(s)\n",
+              dev_table.timer_irq[TIMER_IRQ_VIRT], dev_table.timer_irq[TIMER_IRQ_PHYS],
+              dev_table.nr_virtio);
+}
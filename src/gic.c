@@ -0,0 +1,112 @@
+/*
+ * File: gic.c
+ * Date: 2026-10-18
+ * Description: GICv2 distributor / CPU interface driver. Register frames
+ *              come from the device tree (dev_table).
+ */
+
+#include "gic.h"
+#include "fdt.h"
+#include "smp.h"
+#include "tinystd.h"
+
+static uintptr_t gicd __read_mostly;
+static uintptr_t gicc __read_mostly;
+static uint32_t gic_nr_irqs __read_mostly;
+
+// GIC CPU interface mask for each logical CPU, read back from ITARGETSR0
+static uint8_t gic_cpu_map[NR_CPUS] __read_mostly;
+
+int gic_init(void)
+{
+    if (dev_table.gic_version != 2)
+    {
+        tiny_error("gic: GICv%u not supported, boot QEMU with gic-version=2\n",
+                   dev_table.gic_version);
+        return -1;
+    }
+    gicd = dev_table.gic_dist.base;
+    gicc = dev_table.gic_cpu.base;
+
+    writel_relaxed(0, (void *)(gicd + GICD_CTLR));
+    gic_nr_irqs = 32 * ((readl_relaxed((void *)(gicd + GICD_TYPER)) & 0x1f) + 1);
+    if (gic_nr_irqs > GIC_SPURIOUS)
+        gic_nr_irqs = GIC_SPURIOUS;
+
+    // SPIs: disabled, default priority, routed to the boot CPU
+    for (uint32_t i = GIC_SPI_BASE; i < gic_nr_irqs; i += 32)
+    {
+        writel_relaxed(0xffffffff, (void *)(gicd + GICD_ICENABLER + i / 8));
+        writel_relaxed(0xffffffff, (void *)(gicd + GICD_ICPENDR + i / 8));
+    }
+    for (uint32_t i = GIC_SPI_BASE; i < gic_nr_irqs; i++)
+    {
+        writeb_relaxed(GIC_IRQ_PRIO, (void *)(gicd + GICD_IPRIORITYR + i));
+        writeb_relaxed(0x01, (void *)(gicd + GICD_ITARGETSR + i));
+    }
+
+    writel_relaxed(1, (void *)(gicd + GICD_CTLR));
+    tiny_info("gic: GICv2 with %u interrupt lines\n", gic_nr_irqs);
+    return 0;
+}
+
+// Banked SGI/PPI setup and the CPU interface, run on every CPU
+void gic_cpu_init(void)
+{
+    int cpu = smp_processor_id();
+
+    gic_cpu_map[cpu] = readb_relaxed((void *)(gicd + GICD_ITARGETSR));
+
+    writel_relaxed(0xffff0000, (void *)(gicd + GICD_ICENABLER));
+    writel_relaxed(0x0000ffff, (void *)(gicd + GICD_ISENABLER));
+    for (uint32_t i = 0; i < GIC_SPI_BASE; i++)
+        writeb_relaxed(GIC_IRQ_PRIO, (void *)(gicd + GICD_IPRIORITYR + i));
+
+    writel_relaxed(0xf0, (void *)(gicc + GICC_PMR));
+    writel_relaxed(0, (void *)(gicc + GICC_BPR));
+    writel_relaxed(1, (void *)(gicc + GICC_CTLR));
+}
+
+void gic_enable_irq(uint32_t irq)
+{
+    writel_relaxed(1U << (irq % 32), (void *)(gicd + GICD_ISENABLER + (irq / 32) * 4));
+}
+
+void gic_disable_irq(uint32_t irq)
+{
+    writel_relaxed(1U << (irq % 32), (void *)(gicd + GICD_ICENABLER + (irq / 32) * 4));
+}
+
+void gic_set_target(uint32_t irq, int cpu)
+{
+    if (irq >= GIC_SPI_BASE && irq < gic_nr_irqs && gic_cpu_map[cpu])
+        writeb_relaxed(gic_cpu_map[cpu], (void *)(gicd + GICD_ITARGETSR + irq));
+}
+
+// One SGIR write reaches every CPU in cpumask (bit n = logical CPU n)
+void gic_send_sgi(uint64_t cpumask, uint32_t sgi)
+{
+    uint32_t targets = 0;
+
+    for (int cpu = 0; cpu < NR_CPUS; cpu++)
+    {
+        if (cpumask & (1UL << cpu))
+            targets |= gic_cpu_map[cpu];
+    }
+    if (!targets)
+        return;
+
+    // Ordered: the payload (e.g. call queue entries) is visible before the SGI
+    writel((targets << 16) | (sgi & 0xf), (void *)(gicd + GICD_SGIR));
+}
+
+uint32_t gic_ack(void)
+{
+    // Ordered: the sender's payload is read after the acknowledge
+    return readl((void *)(gicc + GICC_IAR));
+}
+
+void gic_eoi(uint32_t iar)
+{
+    writel_relaxed(iar, (void *)(gicc + GICC_EOIR));
+}
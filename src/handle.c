@@ -1,18 +1,227 @@
 #include "tinyio.h"
 #include <config.h>
 #include "tiny_types.h"
+#include "exception.h"
+#include "gic.h"
+#include "irq.h"
+#include "mmap.h"
+#include "sched.h"
+#include "smp.h"
+#include "stats.h"
+#include "syscall.h"
+#include "trace.h"
+
+DEFINE_STAT(sync_exceptions, "synchronous exceptions taken in C (svc fast path excluded)");
+
+static const char *const exc_kind_names[] = {"Synchronous", "IRQ", "FIQ", "SError"};
+static const char *const exc_src_names[] = {"EL1t", "EL1h", "EL0 (AArch64)", "EL0 (AArch32)"};
+
+static const char *esr_class_name(uint32_t ec)
+{
+    switch (ec)
+    {
+    case ESR_EC_UNKNOWN:
+        return "unknown";
+    case ESR_EC_WFX:
+        return "wfi/wfe";
+    case ESR_EC_FP_ASIMD:
+        return "fp/simd access";
+    case ESR_EC_ILL:
+        return "illegal execution state";
+    case ESR_EC_SVC64:
+        return "svc";
+    case ESR_EC_SYS64:
+        return "msr/mrs trap";
+    case ESR_EC_IABT_LOW:
+    case ESR_EC_IABT_CUR:
+        return "instruction abort";
+    case ESR_EC_PC_ALIGN:
+        return "pc alignment";
+    case ESR_EC_DABT_LOW:
+    case ESR_EC_DABT_CUR:
+        return "data abort";
+    case ESR_EC_SP_ALIGN:
+        return "sp alignment";
+    case ESR_EC_SERROR:
+        return "serror";
+    case ESR_EC_BRK64:
+        return "brk";
+    default:
+        return "reserved";
+    }
+}
+
+// Data/instruction fault status code
+static const char *fsc_name(uint32_t fsc)
+{
+    switch (fsc & 0x3c)
+    {
+    case 0x00:
+        return "address size fault";
+    case 0x04:
+        return "translation fault";
+    case 0x08:
+        return "access flag fault";
+    case 0x0c:
+        return "permission fault";
+    }
+    switch (fsc)
+    {
+    case 0x10:
+        return "synchronous external abort";
+    case 0x21:
+        return "alignment fault";
+    case 0x30:
+        return "tlb conflict";
+    default:
+        return "other";
+    }
+}
+
+static inline uint64_t read_far(void)
+{
+    uint64_t far;
+    __asm__ volatile("mrs %0, far_el1" : "=r"(far));
+    return far;
+}
+
+void fault_report(const struct trap_frame *frame, uint64_t esr, const char *why)
+{
+    uint32_t ec = (esr >> ESR_EC_SHIFT) & ESR_EC_MASK;
+    uint32_t iss = esr & ESR_ISS_MASK;
+
+    tiny_error("==== %s on cpu%d ====\n", why, smp_processor_id());
+    tiny_error("esr 0x%llx: class 0x%02x (%s), iss 0x%x\n", esr, ec, esr_class_name(ec), iss);
+    if (ec == ESR_EC_DABT_LOW || ec == ESR_EC_DABT_CUR ||
+        ec == ESR_EC_IABT_LOW || ec == ESR_EC_IABT_CUR)
+    {
+        uint32_t fsc = iss & ESR_ISS_FSC_MASK;
+        tiny_error("far 0x%llx: %s, level %u%s\n", read_far(), fsc_name(fsc), fsc & 3,
+                   (ec == ESR_EC_DABT_LOW || ec == ESR_EC_DABT_CUR)
+                       ? ((iss & ESR_ISS_WNR) ? ", write" : ", read")
+                       : "");
+    }
+    tiny_error("elr 0x%llx spsr 0x%llx sp_el0 0x%llx (from %s)\n", frame->elr, frame->spsr,
+               frame->sp_el0, frame_from_user(frame) ? "EL0" : "EL1");
+    for (int i = 0; i < 30; i += 3)
+    {
+        tiny_error("x%-2d %016llx x%-2d %016llx x%-2d %016llx\n", i, frame->regs[i],
+                   i + 1, frame->regs[i + 1], i + 2, frame->regs[i + 2]);
+    }
+    tiny_error("x30 %016llx\n", frame->regs[30]);
+}
+
+void panic(const char *fmt, ...)
+{
+    va_list va;
+
+    __asm__ volatile("msr daifset, #0xf" ::: "memory");
+    printf("[PANIC][cpu%d] ", smp_processor_id());
+    va_start(va, fmt);
+    vprintf(fmt, va);
+    va_end(va);
+    while (1)
+        __asm__ volatile("wfi");
+}
+
+static void do_unhandled(struct trap_frame *frame, uint64_t esr)
+{
+    fault_report(frame, esr, "Unhandled synchronous exception");
+    panic("unhandled exception class 0x%02llx\n", (esr >> ESR_EC_SHIFT) & ESR_EC_MASK);
+}
+
+static void do_svc(struct trap_frame *frame, uint64_t esr)
+{
+    syscall_dispatch(frame);
+}
+
+// Translation faults inside a file mapping are demand paging
+static bool try_vm_fault(struct trap_frame *frame, uint64_t esr)
+{
+    uint32_t ec = (esr >> ESR_EC_SHIFT) & ESR_EC_MASK;
+    bool dabt = ec == ESR_EC_DABT_LOW || ec == ESR_EC_DABT_CUR;
+    bool iabt = ec == ESR_EC_IABT_LOW || ec == ESR_EC_IABT_CUR;
+    uint64_t far = read_far();
+    int ret;
+
+    if ((!dabt && !iabt) || (esr & ESR_ISS_FSC_MASK & 0x3c) != 0x04)
+        return false;
+    // The fault may sleep on I/O; let the device IRQs in if they were on
+    if (!(frame->spsr & SPSR_I))
+        local_irq_enable();
+    ret = vm_fault(far, dabt && (esr & ESR_ISS_WNR), iabt, frame_from_user(frame));
+    local_irq_disable();
+    return ret == 0;
+}
+
+// A faulting EL0 task is killed; a kernel fault is fatal
+static void do_abort(struct trap_frame *frame, uint64_t esr)
+{
+    if (try_vm_fault(frame, esr))
+        return;
+    if (frame_from_user(frame))
+    {
+        fault_report(frame, esr, "User fault");
+        tiny_error("killing task %d (%s)\n", current->pid, current->name);
+        task_exit(-EFAULT);
+    }
+    fault_report(frame, esr, "Kernel fault");
+    panic("%s at 0x%llx\n", esr_class_name((esr >> ESR_EC_SHIFT) & ESR_EC_MASK), frame->elr);
+}
+
+// brk #imm: report and step over it, so it can be used as a soft assert
+static void do_brk(struct trap_frame *frame, uint64_t esr)
+{
+    tiny_warn("brk #0x%llx at 0x%llx\n", esr & 0xffff, frame->elr);
+    frame->elr += 4;
+}
+
+// O(1) dispatch on ESR_EL1.EC
+static const exc_handler_t sync_handlers[ESR_EC_MAX] = {
+    [0 ... ESR_EC_MAX - 1] = do_unhandled,
+    [ESR_EC_SVC64] = do_svc,
+    [ESR_EC_IABT_LOW] = do_abort,
+    [ESR_EC_IABT_CUR] = do_abort,
+    [ESR_EC_PC_ALIGN] = do_abort,
+    [ESR_EC_DABT_LOW] = do_abort,
+    [ESR_EC_DABT_CUR] = do_abort,
+    [ESR_EC_SP_ALIGN] = do_abort,
+    [ESR_EC_BRK64] = do_brk,
+};
 
 void handle_sync_exception(uint64_t *stack_pointer)
 {
+    uint64_t esr;
+
+    __asm__ volatile("mrs %0, esr_el1" : "=r"(esr));
+    stat_inc(sync_exceptions);
+    sync_handlers[(esr >> ESR_EC_SHIFT) & ESR_EC_MASK]((struct trap_frame *)stack_pointer, esr);
 }
 
 void handle_irq_exception(uint64_t *stack_pointer)
 {
+    uint32_t iar = gic_ack();
+    uint32_t irq = gic_irq_of(iar);
+
+    if (irq >= GIC_SPURIOUS)
+        return;
+
+    irq_dispatch(irq);
+    gic_eoi(iar);
+
+    if (frame_from_user((struct trap_frame *)stack_pointer))
+        sched_preempt_user();
 }
 
 void invalid_exception(uint64_t *stack_pointer, uint64_t kind, uint64_t source)
 {
-    tiny_error("Invalid exception occurred!\n");
-    while (1)
-        ;
-}
\ No newline at end of file
+    uint64_t esr;
+
+    __asm__ volatile("mrs %0, esr_el1" : "=r"(esr));
+    tiny_error("Invalid exception occurred: %s from %s\n",
+               exc_kind_names[kind & 3], exc_src_names[source & 3]);
+    fault_report((struct trap_frame *)stack_pointer, esr, "Invalid exception");
+    trace_set(false); // other CPUs stop overwriting the rings
+    trace_dump(0);
+    panic("invalid exception\n");
+}
@@ -0,0 +1,177 @@
+/*
+ * File: idle.c
+ * Date: 2026-10-18
+ * Description: Idle governor: poll or wfi, chosen from the recent idle
+ *              history and the next timer deadline, with wake latency
+ *              and host CPU residency accounting.
+ */
+
+#include "idle.h"
+#include "atomic.h"
+#include "irq.h"
+#include "rcu.h"
+#include "sched.h"
+#include "shell.h"
+#include "smp.h"
+#include "stats.h"
+#include "timer.h"
+#include "tinystd.h"
+
+DEFINE_PER_CPU_ALIGNED(struct idle_state, idle_state);
+
+STAT_REGISTER(idle_polls, "idle periods that polled first", &idle_state.polls);
+STAT_REGISTER(idle_poll_hits, "polls that found work before wfi", &idle_state.poll_hits);
+STAT_REGISTER(idle_wfis, "wfi halts", &idle_state.wfis);
+STAT_REGISTER(idle_ipis_saved, "reschedule SGIs skipped for polling CPUs", &idle_state.ipis_saved);
+STAT_REGISTER(idle_wfi_ns, "ns halted in wfi (host CPU saved)", &idle_state.wfi_ns);
+STAT_REGISTER(idle_poll_ns, "ns spent polling", &idle_state.poll_ns);
+
+static const char *const idle_mode_names[NR_IDLE_MODES] = {"poll", "wfi"};
+
+// Expected idle time left: history, cut short by the next timer
+static uint64_t idle_predict_ns(struct idle_state *is, uint64_t now)
+{
+    uint64_t deadline = timer_next_deadline();
+    uint64_t until_timer = deadline > now ? ticks_to_ns(deadline - now) : 0;
+
+    return MIN(is->predicted_ns, until_timer);
+}
+
+static bool idle_poll(struct idle_state *is, uint64_t now)
+{
+    uint64_t end = now + ns_to_ticks(IDLE_POLL_NS);
+    bool hit;
+
+    is->polls++;
+    WRITE_ONCE(is->polling, 1);
+    smp_mb(); // pairs with idle_wake_polling(): either we see the flag or they see polling
+    while (!sched_cpu_has_work() && read_cntvct() < end)
+        cpu_relax();
+    WRITE_ONCE(is->polling, 0);
+    smp_mb();
+    hit = sched_cpu_has_work();
+    is->poll_ns += ticks_to_ns(read_cntvct() - now);
+    if (hit)
+        is->poll_hits++;
+    return hit;
+}
+
+static void idle_wfi(struct idle_state *is)
+{
+    uint64_t t0, t1;
+
+    local_irq_disable();
+    if (!sched_cpu_has_work())
+    {
+        rcu_idle_enter();
+        t0 = read_cntvct();
+        __asm__ volatile("wfi");
+        t1 = read_cntvct();
+        rcu_idle_exit();
+        is->wfis++;
+        is->wfi_ns += ticks_to_ns(t1 - t0);
+    }
+    local_irq_enable();
+}
+
+// One round of idling: returns once there is work or an interrupt was taken
+void idle_enter(void)
+{
+    struct idle_state *is = this_cpu_ptr(&idle_state);
+    uint64_t now = read_cntvct();
+
+    if (!is->predicted_ns)
+        is->predicted_ns = IDLE_PREDICT_INIT_NS;
+    if (!is->idle_start)
+    {
+        is->idle_start = now;
+        WRITE_ONCE(is->wake_ts, 0);
+    }
+
+    if (idle_predict_ns(is, now) < IDLE_POLL_NS)
+    {
+        is->last_mode = IDLE_POLL;
+        if (idle_poll(is, now))
+            return;
+    }
+    is->last_mode = IDLE_WFI;
+    idle_wfi(is);
+}
+
+// Work found: close the idle period, feed the history and the latency counters
+void idle_exit(void)
+{
+    struct idle_state *is = this_cpu_ptr(&idle_state);
+    uint64_t now = read_cntvct();
+    uint64_t wake_ts = READ_ONCE(is->wake_ts);
+    enum idle_mode mode = is->last_mode;
+    uint64_t period;
+
+    if (!is->idle_start)
+        return;
+    period = ticks_to_ns(now - is->idle_start);
+    is->predicted_ns -= is->predicted_ns >> IDLE_EWMA_SHIFT;
+    is->predicted_ns += period >> IDLE_EWMA_SHIFT;
+    is->idle_start = 0;
+
+    if (wake_ts && wake_ts <= now)
+    {
+        uint64_t lat = ticks_to_ns(now - wake_ts);
+
+        is->wakeups[mode]++;
+        is->wake_lat_ns[mode] += lat;
+        if (lat > is->wake_lat_max_ns[mode])
+            is->wake_lat_max_ns[mode] = lat;
+    }
+}
+
+// A task was made runnable on cpu at ts; only the first stamp of an idle period counts
+void idle_note_wake(int cpu, uint64_t ts)
+{
+    struct idle_state *is = per_cpu_ptr(&idle_state, cpu);
+
+    if (READ_ONCE(is->idle_start) && !READ_ONCE(is->wake_ts))
+        atomic_cmpxchg(&is->wake_ts, 0, ts);
+}
+
+// need_resched is already set for cpu; true if it is polling and will see it without an SGI
+bool idle_wake_polling(int cpu)
+{
+    struct idle_state *is = per_cpu_ptr(&idle_state, cpu);
+
+    smp_mb();
+    if (!READ_ONCE(is->polling))
+        return false;
+    this_cpu_inc(idle_state.ipis_saved);
+    return true;
+}
+
+void idle_dump(void)
+{
+    tiny_info("idle: poll budget %llu us\n", IDLE_POLL_NS / NSEC_PER_USEC);
+    for (int cpu = 0; cpu < NR_CPUS; cpu++)
+    {
+        struct idle_state *is = per_cpu_ptr(&idle_state, cpu);
+
+        if (!cpu_online(cpu))
+            continue;
+        printf("  cpu%d: predicted %llu us, polls %llu (hits %llu), wfi %llu, sgi saved %llu, "
+               "wfi %llu ms, poll %llu ms\n",
+               cpu, is->predicted_ns / NSEC_PER_USEC, is->polls, is->poll_hits, is->wfis,
+               is->ipis_saved, is->wfi_ns / NSEC_PER_MSEC, is->poll_ns / NSEC_PER_MSEC);
+        for (int m = 0; m < NR_IDLE_MODES; m++)
+        {
+            if (!is->wakeups[m])
+                continue;
+            printf("        wake from %-4s: %llu, avg %llu ns, max %llu ns\n", idle_mode_names[m],
+                   is->wakeups[m], is->wake_lat_ns[m] / is->wakeups[m], is->wake_lat_max_ns[m]);
+        }
+    }
+}
+
+static int cmd_idle(int argc, char **argv)
+{
+    idle_dump();
+    return 0;
+}
+SHELL_CMD(idle, "idle governor residency and wake latency", cmd_idle);
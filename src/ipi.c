@@ -0,0 +1,190 @@
+/*
+ * File: ipi.c
+ * Date: 2026-10-18
+ * Description: SGI-based inter-processor calls. Each CPU has an MPSC call
+ *              queue (a Treiber stack pushed with LL/SC, drained with one
+ *              xchg). A sender only raises an SGI when it finds the queue
+ *              empty; otherwise the pending SGI already covers its entry.
+ */
+
+#include "ipi.h"
+#include "atomic.h"
+#include "gic.h"
+#include "irq.h"
+#include "percpu.h"
+#include "sched.h"
+#include "smp.h"
+#include "stats.h"
+#include "tinystd.h"
+
+#define IPI_CSD_SLOTS 32
+
+// Remote CPUs push here, so keep the head on a line of its own
+struct call_queue
+{
+    volatile uint64_t head; // struct call_single_data *
+} ____cacheline_aligned;
+
+static DEFINE_PER_CPU(struct call_queue, call_queue);
+static DEFINE_PER_CPU(struct call_single_data, csd_pool[IPI_CSD_SLOTS]);
+DEFINE_PER_CPU(struct ipi_stats, ipi_stats);
+STAT_REGISTER(ipi_sent, "SGIs raised", &ipi_stats.sent);
+STAT_REGISTER(ipi_received, "SGIs taken", &ipi_stats.received);
+STAT_REGISTER(ipi_coalesced, "cross-calls queued behind a pending SGI", &ipi_stats.coalesced);
+
+// Called with IRQs off; only the owning CPU sets busy
+static struct call_single_data *csd_alloc(void)
+{
+    struct call_single_data *pool = this_cpu_ptr(&csd_pool[0]);
+
+    for (;;)
+    {
+        for (int i = 0; i < IPI_CSD_SLOTS; i++)
+        {
+            struct call_single_data *csd = &pool[i];
+            if (!csd->busy)
+            {
+                csd->busy = 1;
+                return csd;
+            }
+        }
+        // All slots in flight: serve our own queue so that two CPUs
+        // flooding each other cannot deadlock with IRQs masked.
+        ipi_flush_call_queue();
+        cpu_relax();
+    }
+}
+
+// Returns true if the queue was empty, i.e. the caller must raise the SGI
+static bool call_queue_push(int cpu, struct call_single_data *csd)
+{
+    struct call_queue *q = per_cpu_ptr(&call_queue, cpu);
+    uint64_t old;
+
+    do
+    {
+        old = READ_ONCE(q->head);
+        csd->next = (struct call_single_data *)old;
+    } while (!atomic_cmpxchg(&q->head, old, (uint64_t)csd));
+    return old == 0;
+}
+
+void ipi_flush_call_queue(void)
+{
+    struct call_single_data *list, *fifo = NULL, *next;
+
+    list = (struct call_single_data *)atomic_xchg(&this_cpu_ptr(&call_queue)->head, 0);
+
+    // The stack is LIFO; reverse it so calls run in submission order
+    while (list)
+    {
+        next = list->next;
+        list->next = fifo;
+        fifo = list;
+        list = next;
+    }
+
+    while (fifo)
+    {
+        smp_call_func_t fn = fifo->fn;
+        void *arg = fifo->arg;
+
+        next = fifo->next;
+        atomic_store_release32(&fifo->busy, 0);
+        fn(arg);
+        this_cpu_inc(ipi_stats.calls);
+        fifo = next;
+    }
+}
+
+static void queue_call(int cpu, smp_call_func_t fn, void *arg, uint64_t *sgi_mask)
+{
+    struct call_single_data *csd = csd_alloc();
+
+    csd->fn = fn;
+    csd->arg = arg;
+    if (call_queue_push(cpu, csd))
+        *sgi_mask |= 1UL << cpu;
+    else
+        this_cpu_inc(ipi_stats.coalesced);
+}
+
+int smp_call_function(int cpu, smp_call_func_t fn, void *arg)
+{
+    uint64_t flags, sgi_mask = 0;
+    int self;
+
+    if (cpu < 0 || cpu >= NR_CPUS || !cpu_online(cpu))
+        return -1;
+
+    flags = local_irq_save();
+    self = smp_processor_id();
+    if (cpu == self)
+    {
+        fn(arg);
+    }
+    else
+    {
+        queue_call(cpu, fn, arg, &sgi_mask);
+        if (sgi_mask)
+        {
+            gic_send_sgi(sgi_mask, IPI_CALL_FUNC);
+            this_cpu_inc(ipi_stats.sent);
+        }
+    }
+    local_irq_restore(flags);
+    return 0;
+}
+
+// Queue on every target first, then raise a single multicast SGI
+int smp_call_function_many(uint64_t cpumask, smp_call_func_t fn, void *arg)
+{
+    uint64_t flags, sgi_mask = 0;
+    int self;
+
+    cpumask &= cpu_online_mask;
+    if (!cpumask)
+        return -1;
+
+    flags = local_irq_save();
+    self = smp_processor_id();
+    for (int cpu = 0; cpu < NR_CPUS; cpu++)
+    {
+        if (cpu != self && (cpumask & (1UL << cpu)))
+            queue_call(cpu, fn, arg, &sgi_mask);
+    }
+    if (sgi_mask)
+    {
+        gic_send_sgi(sgi_mask, IPI_CALL_FUNC);
+        this_cpu_inc(ipi_stats.sent);
+    }
+    if (cpumask & (1UL << self))
+        fn(arg);
+    local_irq_restore(flags);
+    return 0;
+}
+
+void smp_send_reschedule(int cpu)
+{
+    if (cpu >= 0 && cpu < NR_CPUS && cpu_online(cpu))
+        gic_send_sgi(1UL << cpu, IPI_RESCHEDULE);
+}
+
+static void ipi_call_irq(uint32_t irq, void *arg)
+{
+    this_cpu_inc(ipi_stats.received);
+    ipi_flush_call_queue();
+}
+
+// A task was queued here from another CPU
+static void ipi_resched_irq(uint32_t irq, void *arg)
+{
+    this_cpu_inc(ipi_stats.received);
+    sched_set_need_resched();
+}
+
+void ipi_init(void)
+{
+    irq_register(IPI_CALL_FUNC, ipi_call_irq, NULL);
+    irq_register(IPI_RESCHEDULE, ipi_resched_irq, NULL);
+}
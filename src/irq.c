@@ -0,0 +1,45 @@
+/*
+ * File: irq.c
+ * Date: 2026-10-18
+ * Description: Interrupt handler table, dispatched from handle_irq_exception.
+ */
+
+#include "irq.h"
+#include "stats.h"
+#include "tinyio.h"
+#include "trace.h"
+
+struct irq_desc
+{
+    irq_handler_t handler;
+    void *arg;
+};
+
+static struct irq_desc irq_table[NR_IRQS];
+
+DEFINE_STAT(irqs, "interrupts dispatched, SGIs included");
+
+int irq_register(uint32_t irq, irq_handler_t handler, void *arg)
+{
+    if (irq >= NR_IRQS)
+        return -1;
+    irq_table[irq].arg = arg;
+    irq_table[irq].handler = handler;
+    return 0;
+}
+
+void irq_dispatch(uint32_t irq)
+{
+    struct irq_desc *desc;
+
+    if (irq >= NR_IRQS || !irq_table[irq].handler)
+    {
+        tiny_warn("irq: unhandled interrupt %u\n", irq);
+        return;
+    }
+    stat_inc(irqs);
+    desc = &irq_table[irq];
+    trace_event(TRACE_IRQ_ENTER, 0, irq);
+    desc->handler(irq, desc->arg);
+    trace_event(TRACE_IRQ_EXIT, 0, irq);
+}
@@ -0,0 +1,121 @@
+/*
+ * File: jump_label.c
+ * Date: 2026-10-18
+ * Description: Static key patching. Rewrites the nop at every
+ *              __jump_table site of a key into a branch and back, with the
+ *              cache maintenance needed to make the new instruction
+ *              visible to all CPUs.
+ */
+
+#include "jump_label.h"
+#include "atomic.h"
+#include "ipi.h"
+#include "smp.h"
+#include "spin_lock.h"
+#include "tinystd.h"
+
+#define AARCH64_INSN_NOP 0xd503201fU
+#define AARCH64_INSN_B 0x14000000U
+#define AARCH64_B_IMM26 0x03ffffffU
+
+extern struct jump_entry __jump_table_start[];
+extern struct jump_entry __jump_table_end[];
+
+static spinlock_t jump_label_lock;
+
+static uint32_t jump_entry_insn(const struct jump_entry *e, bool enabled)
+{
+    int64_t offset = (int64_t)(e->target - e->code);
+
+    if (!enabled)
+        return AARCH64_INSN_NOP;
+    return AARCH64_INSN_B | ((uint32_t)(offset >> 2) & AARCH64_B_IMM26);
+}
+
+// Clean the D-side to the PoU, then drop the stale I-cache line everywhere (IS)
+static void patch_text(uint32_t *addr, uint32_t insn)
+{
+    if (READ_ONCE(*addr) == insn)
+        return;
+    WRITE_ONCE(*addr, insn);
+    asm volatile("dc cvau, %0\n"
+                 "dsb ish\n"
+                 "ic ivau, %0\n"
+                 "dsb ish\n"
+                 "isb\n"
+                 :
+                 : "r"(addr)
+                 : "memory");
+}
+
+// Runs on every online CPU: no stale prefetched instructions past this point
+static void jump_label_sync(void *arg)
+{
+    asm volatile("isb" ::: "memory");
+}
+
+static int jump_label_update(const struct static_key *key, bool enabled)
+{
+    int n = 0;
+
+    for (struct jump_entry *e = __jump_table_start; e < __jump_table_end; e++)
+    {
+        if (e->key != (uint64_t)key)
+            continue;
+        patch_text((uint32_t *)e->code, jump_entry_insn(e, enabled));
+        n++;
+    }
+    return n;
+}
+
+static void static_key_set(struct static_key *key, bool enabled)
+{
+    int n;
+
+    spin_lock(&jump_label_lock);
+    if (key->enabled == enabled)
+    {
+        spin_unlock(&jump_label_lock);
+        return;
+    }
+    WRITE_ONCE(key->enabled, enabled);
+    n = jump_label_update(key, enabled);
+    spin_unlock(&jump_label_lock);
+    if (n)
+        smp_call_function_many(cpu_online_mask, jump_label_sync, NULL);
+}
+
+void static_key_enable(struct static_key *key)
+{
+    static_key_set(key, true);
+}
+
+void static_key_disable(struct static_key *key)
+{
+    static_key_set(key, false);
+}
+
+int static_key_sites(const struct static_key *key)
+{
+    int n = 0;
+
+    for (struct jump_entry *e = __jump_table_start; e < __jump_table_end; e++)
+    {
+        if (e->key == (uint64_t)key)
+            n++;
+    }
+    return n;
+}
+
+// Boot CPU only, before anything tests a key that starts out true
+void jump_label_init(void)
+{
+    spinlock_init(&jump_label_lock);
+    for (struct jump_entry *e = __jump_table_start; e < __jump_table_end; e++)
+    {
+        const struct static_key *key = (const struct static_key *)e->key;
+
+        if (key->enabled)
+            patch_text((uint32_t *)e->code, jump_entry_insn(e, true));
+    }
+}
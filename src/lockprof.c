@@ -0,0 +1,180 @@
+/*
+ * File: lockprof.c
+ * Date: 2026-10-18
+ * Description: Lock contention profiler. Wraps the counting spinlock
+ *              variants from asm/spinlock.S, keeps per-lock statistics
+ *              keyed by the lock address and reports the hottest locks.
+ *              Only built with CONFIG_LOCK_PROFILE (make LOCKPROF=1).
+ */
+
+#include "lockprof.h"
+
+#ifdef CONFIG_LOCK_PROFILE
+
+#include "atomic.h"
+#include "timer.h"
+#include "tinystd.h"
+
+extern uint64_t arch_spin_lock(spinlock_t *lock); // returns spin iterations
+extern int arch_spin_trylock(spinlock_t *lock);
+extern void arch_spin_unlock(spinlock_t *lock);
+
+static struct lock_class lock_classes[LOCKPROF_CLASSES];
+static volatile uint64_t lockprof_overflow; // locks that found the table full
+
+// Must not take a lock itself: claims a slot with a CAS on its key
+static struct lock_class *lock_class_of(spinlock_t *lock)
+{
+    uint64_t key = (uint64_t)lock;
+    uint32_t idx = (uint32_t)((key >> 2) * 0x9e3779b1UL) & (LOCKPROF_CLASSES - 1);
+
+    for (uint32_t n = 0; n < LOCKPROF_CLASSES; n++)
+    {
+        struct lock_class *c = &lock_classes[(idx + n) & (LOCKPROF_CLASSES - 1)];
+        uint64_t cur = READ_ONCE(c->key);
+
+        if (cur == key)
+            return c;
+        if (!cur && (atomic_cmpxchg(&c->key, 0, key) || READ_ONCE(c->key) == key))
+            return c;
+    }
+    atomic_add_return(&lockprof_overflow, 1);
+    return NULL;
+}
+
+// Lock held from here on: the statistics are ours to update
+static void lockprof_acquired(struct lock_class *c, uint64_t spins, uintptr_t pc)
+{
+    c->acquisitions++;
+    if (spins)
+    {
+        c->contended++;
+        c->spins += spins;
+        if (spins > c->max_spins)
+        {
+            c->max_spins = spins;
+            c->max_spins_pc = pc;
+        }
+    }
+    c->acquired_pc = pc;
+    c->acquired_at = read_cntvct();
+}
+
+void spin_lock(spinlock_t *lock)
+{
+    uint64_t spins = arch_spin_lock(lock);
+    struct lock_class *c = lock_class_of(lock);
+
+    if (c)
+        lockprof_acquired(c, spins, (uintptr_t)__builtin_return_address(0));
+}
+
+int spin_trylock(spinlock_t *lock)
+{
+    struct lock_class *c = lock_class_of(lock);
+
+    if (arch_spin_trylock(lock))
+    {
+        if (c)
+            atomic_add_return(&c->trylock_failures, 1);
+        return 1;
+    }
+    if (c)
+        lockprof_acquired(c, 0, (uintptr_t)__builtin_return_address(0));
+    return 0;
+}
+
+void spin_unlock(spinlock_t *lock)
+{
+    struct lock_class *c = lock_class_of(lock);
+
+    if (c && c->acquired_at)
+    {
+        uint64_t hold = read_cntvct() - c->acquired_at;
+
+        c->hold_ticks += hold;
+        if (hold > c->max_hold_ticks)
+        {
+            c->max_hold_ticks = hold;
+            c->max_hold_pc = c->acquired_pc;
+        }
+        c->acquired_at = 0;
+    }
+    arch_spin_unlock(lock);
+}
+
+// Contention first: spin iterations, then contended acquisitions
+static bool lock_class_hotter(const struct lock_class *a, const struct lock_class *b)
+{
+    if (a->spins != b->spins)
+        return a->spins > b->spins;
+    return a->contended > b->contended;
+}
+
+void lockprof_report(int top_n)
+{
+    struct lock_class *top[LOCKPROF_TOP_N];
+    uint32_t used = 0;
+    int n = 0;
+
+    top_n = MIN(MAX(top_n, 1), LOCKPROF_TOP_N);
+    for (int i = 0; i < LOCKPROF_CLASSES; i++)
+    {
+        struct lock_class *c = &lock_classes[i];
+        int pos;
+
+        if (!READ_ONCE(c->key))
+            continue;
+        used++;
+        // Insertion into the sorted top-N
+        for (pos = n; pos > 0 && lock_class_hotter(c, top[pos - 1]); pos--)
+        {
+            if (pos < top_n)
+                top[pos] = top[pos - 1];
+        }
+        if (pos < top_n)
+        {
+            top[pos] = c;
+            if (n < top_n)
+                n++;
+        }
+    }
+
+    tiny_info("lockprof: %u lock(s) seen, %llu untracked, top %d by spins:\n", used,
+              lockprof_overflow, n);
+    for (int i = 0; i < n; i++)
+    {
+        struct lock_class *c = top[i];
+
+        printf("  lock 0x%llx: acq %llu, contended %llu (%llu%%), spins %llu (max %llu at "
+               "pc 0x%llx), hold avg %llu ns max %llu ns (pc 0x%llx), trylock fails %llu\n",
+               c->key, c->acquisitions, c->contended,
+               c->acquisitions ? c->contended * 100 / c->acquisitions : 0, c->spins,
+               c->max_spins, (uint64_t)c->max_spins_pc,
+               c->acquisitions ? ticks_to_ns(c->hold_ticks / c->acquisitions) : 0,
+               ticks_to_ns(c->max_hold_ticks), (uint64_t)c->max_hold_pc,
+               c->trylock_failures);
+    }
+}
+
+// Keeps the classes, clears their counters
+void lockprof_reset(void)
+{
+    for (int i = 0; i < LOCKPROF_CLASSES; i++)
+    {
+        struct lock_class *c = &lock_classes[i];
+
+        c->acquisitions = 0;
+        c->contended = 0;
+        c->spins = 0;
+        c->max_spins = 0;
+        c->max_spins_pc = 0;
+        c->hold_ticks = 0;
+        c->max_hold_ticks = 0;
+        c->max_hold_pc = 0;
+        c->trylock_failures = 0;
+    }
+    lockprof_overflow = 0;
+}
+
+#endif // CONFIG_LOCK_PROFILE
@@ -7,13 +7,74 @@
 
 #include "tinyio.h"
 #include "tinystd.h"
+#include "bench.h"
+#include "blk.h"
+#include "boot.h"
+#include "coro.h"
+#include "dma.h"
+#include "fat32.h"
+#include "fdt.h"
+#include "atomic.h"
+#include "gic.h"
+#include "idle.h"
+#include "ipi.h"
+#include "irq.h"
+#include "jump_label.h"
+#include "lockprof.h"
+#include "mbuf.h"
+#include "mmap.h"
+#include "napi.h"
+#include "page_alloc.h"
+#include "pagecache.h"
+#include "percpu.h"
+#include "rcu.h"
+#include "sched.h"
+#include "shell.h"
+#include "smp.h"
+#include "stats.h"
+#include "timer.h"
+#include "virtio.h"
+#include "virtio_net.h"
 
 #ifndef VM_VERSION
 #define VM_VERSION "null"
 #endif
 
+// make STATS_PERIOD=<ms>: dump the counters as JSON every <ms>
+#ifndef STATS_PERIOD_MS
+#define STATS_PERIOD_MS 0
+#endif
+
 int kernel_main(void)
 {
+    boot_mark(BOOT_TS_MAIN);
+    jump_label_init(); // log call sites stay nops until this runs
+    percpu_init();
+    fdt_init(boot_info.dtb_pa);
+    tiny_io_set_base(dev_table.uart.base);
+    boot_report();
+    fdt_dump();
+
+    page_alloc_init();
+    mmap_init();
+    dma_init();
+    mbuf_init();
+    gic_init();
+    gic_cpu_init();
+    ipi_init();
+    sched_init_cpu();
+    timer_init_cpu();
+    local_irq_enable();
+    smp_init();
+    rcu_init();
+    coro_init();
+
+    // Poll on the last CPU so that cpu0 keeps taking the device IRQs
+    napi_init(num_online_cpus() - 1);
+    virtio_probe_all();
+    if (blk_get(0))
+        fat32_mount(blk_get(0));
+
     // Test all log levels to demonstrate LOG control
     tiny_error("This is an ERROR message - always shown unless LOG=none\n");
     tiny_warn("This is a WARN message - shown when LOG=warn,info,debug,all\n");
@@ -22,6 +83,33 @@ int kernel_main(void)
     tiny_log("This is a generic LOG message\n");
 
     tiny_info("LOG control system test completed!\n");
+
+#ifdef CONFIG_BENCH
+    bench_run_all();
+#endif
+
+#if STATS_PERIOD_MS
+    stats_start_periodic(STATS_PERIOD_MS, STATS_JSON);
+#endif
+
+    shell_init(0);
+
+    // From here on kernel_main is the idle task of cpu0
+    user_init();
+    while (READ_ONCE(nr_user_tasks))
+        cpu_idle_once();
+#ifdef CONFIG_INTERACTIVE
+    tiny_info("demos done, type 'halt' to shut down\n");
+    while (!shell_halt_requested())
+        cpu_idle_once();
+#endif
+    net_dump();
+    if (blk_get(0))
+        blk_dump(blk_get(0));
+    pagecache_dump();
+    stats_dump(STATS_HUMAN);
+    idle_dump();
+    lockprof_report(LOCKPROF_TOP_N);
     system_shutdown();
     return 0;
 }
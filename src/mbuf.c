@@ -0,0 +1,220 @@
+/*
+ * File: mbuf.c
+ * Date: 2026-10-18
+ * Description: Reference-counted scatter-gather buffer chains with head
+ *              and tail room, zero-copy clones and virtqueue mapping.
+ */
+
+#include "mbuf.h"
+#include "atomic.h"
+#include "tiny_pool.h"
+#include "tinystd.h"
+#include "virtio.h"
+
+static struct tiny_pool *mbuf_pool;     // struct mbuf
+static struct tiny_pool *mbuf_buf_pool; // MBUF_BUF_SIZE data buffers
+
+int mbuf_init(void)
+{
+    mbuf_pool = tiny_pool_create("mbuf", sizeof(struct mbuf), MBUF_NR);
+    mbuf_buf_pool = tiny_pool_create("mbuf_buf", MBUF_BUF_SIZE, MBUF_NR_BUFS);
+    if (!mbuf_pool || !mbuf_buf_pool)
+    {
+        tiny_error("mbuf: cannot create the pools\n");
+        return -1;
+    }
+    return 0;
+}
+
+static struct mbuf *mbuf_desc_alloc(void)
+{
+    struct mbuf *m = tiny_pool_alloc(mbuf_pool);
+
+    if (m)
+        memset(m, 0, sizeof(*m));
+    return m;
+}
+
+// One empty segment with `headroom` bytes reserved in front
+struct mbuf *mbuf_alloc(uint32_t headroom)
+{
+    struct mbuf *m;
+
+    if (headroom > MBUF_DATA_SIZE)
+        return NULL;
+    m = mbuf_desc_alloc();
+    if (!m)
+        return NULL;
+    m->ext = tiny_pool_alloc(mbuf_buf_pool);
+    if (!m->ext)
+    {
+        tiny_pool_free(mbuf_pool, m);
+        return NULL;
+    }
+    m->ext->refcnt = 1;
+    m->data = mbuf_buf_start(m) + headroom;
+    return m;
+}
+
+// Drops the whole chain; a data buffer goes back with its last reference
+void mbuf_free(struct mbuf *m)
+{
+    while (m)
+    {
+        struct mbuf *next = m->next;
+
+        if (!atomic_add_return32(&m->ext->refcnt, -1))
+            tiny_pool_free(mbuf_buf_pool, m->ext);
+        tiny_pool_free(mbuf_pool, m);
+        m = next;
+    }
+}
+
+// New descriptors over the same bytes; no data is copied
+struct mbuf *mbuf_clone(const struct mbuf *m)
+{
+    struct mbuf *head = NULL, **pp = &head;
+    uint32_t pkt_len = m->pkt_len;
+
+    for (; m; m = m->next)
+    {
+        struct mbuf *c = mbuf_desc_alloc();
+
+        if (!c)
+        {
+            mbuf_free(head);
+            return NULL;
+        }
+        atomic_add_return32(&m->ext->refcnt, 1);
+        c->ext = m->ext;
+        c->data = m->data;
+        c->len = m->len;
+        *pp = c;
+        pp = &c->next;
+    }
+    head->pkt_len = pkt_len;
+    return head;
+}
+
+// len contiguous bytes in front of the chain; may put a new segment at *mp
+void *mbuf_prepend(struct mbuf **mp, uint32_t len)
+{
+    struct mbuf *m = *mp;
+
+    if (len > MBUF_DATA_SIZE)
+        return NULL;
+    if (mbuf_headroom(m) < len || !mbuf_writable(m))
+    {
+        struct mbuf *h = mbuf_alloc(MBUF_DATA_SIZE);
+
+        if (!h)
+            return NULL;
+        h->next = m;
+        h->pkt_len = m->pkt_len;
+        m->pkt_len = 0;
+        *mp = m = h;
+    }
+    m->data -= len;
+    m->len += len;
+    m->pkt_len += len;
+    return m->data;
+}
+
+// len contiguous bytes at the end of the chain, in a new segment if needed
+void *mbuf_append(struct mbuf *m, uint32_t len)
+{
+    struct mbuf *head = m;
+    void *p;
+
+    if (len > MBUF_DATA_SIZE)
+        return NULL;
+    while (m->next)
+        m = m->next;
+    if (mbuf_tailroom(m) < len || !mbuf_writable(m))
+    {
+        struct mbuf *t = mbuf_alloc(0);
+
+        if (!t)
+            return NULL;
+        m->next = t;
+        m = t;
+    }
+    p = m->data + m->len;
+    m->len += len;
+    head->pkt_len += len;
+    return p;
+}
+
+// Strip len bytes of header from the head segment; returns the new start
+void *mbuf_pull(struct mbuf *m, uint32_t len)
+{
+    if (len > m->len)
+        return NULL;
+    m->data += len;
+    m->len -= len;
+    m->pkt_len -= len;
+    return m->data;
+}
+
+void mbuf_cat(struct mbuf *head, struct mbuf *tail)
+{
+    struct mbuf *m = head;
+
+    while (m->next)
+        m = m->next;
+    m->next = tail;
+    head->pkt_len += tail->pkt_len;
+    tail->pkt_len = 0;
+}
+
+// Empty segments are skipped, as mbuf_to_vq() skips them
+uint32_t mbuf_nsegs(const struct mbuf *m)
+{
+    uint32_t n = 0;
+
+    for (; m; m = m->next)
+    {
+        if (m->len)
+            n++;
+    }
+    return n;
+}
+
+// Linearise [off, off + len) of the chain into dst; returns bytes copied
+uint32_t mbuf_copydata(const struct mbuf *m, uint32_t off, uint32_t len, void *dst)
+{
+    uint8_t *d = dst;
+    uint32_t done = 0;
+
+    for (; m && done < len; m = m->next)
+    {
+        uint32_t n;
+
+        if (off >= m->len)
+        {
+            off -= m->len;
+            continue;
+        }
+        n = MIN(m->len - off, len - done);
+        memcpy(d + done, m->data + off, n);
+        done += n;
+        off = 0;
+    }
+    return done;
+}
+
+// One descriptor per non-empty segment; -1 if the chain needs more than max
+int mbuf_to_vq(const struct mbuf *m, struct vq_buf *bufs, uint32_t max, bool write)
+{
+    uint32_t n = 0;
+
+    for (; m; m = m->next)
+    {
+        if (!m->len)
+            continue;
+        if (n == max)
+            return -1;
+        bufs[n++] = (struct vq_buf){(paddr_t)m->data, m->len, write};
+    }
+    return n;
+}
@@ -0,0 +1,343 @@
+/*
+ * File: mm.c
+ * Date: 2026-10-18
+ * Description: Per-task EL0 address spaces. Each mm gets its own L1 table
+ *              holding the global kernel identity entries plus a private
+ *              user slot, and an 8-bit ASID with a generation counter so a
+ *              context switch is a single TTBR0 write with no TLB flush.
+ *              Only an ASID rollover flushes, once per CPU.
+ */
+
+#include "mmu.h"
+#include "atomic.h"
+#include "exception.h"
+#include "irq.h"
+#include "page_alloc.h"
+#include "percpu.h"
+#include "sched.h"
+#include "smp.h"
+#include "spin_lock.h"
+#include "tinystd.h"
+
+#define NUM_ASIDS (1UL << ASID_BITS)
+#define ASID_MASK (NUM_ASIDS - 1)
+#define ASID_FIRST_VERSION NUM_ASIDS
+
+struct mm init_mm = {
+    .pgd = boot_pgd,
+    .mmap_next = KMAP_BASE,
+};
+
+static struct mm mm_pool[MAX_TASKS];
+static bool mm_used[MAX_TASKS];
+static spinlock_t mm_pool_lock;
+
+static spinlock_t asid_lock;
+static uint64_t asid_generation = ASID_FIRST_VERSION;
+static uint64_t asid_map[NUM_ASIDS / 64] = {1}; // ASID 0: kernel table
+static uint64_t asid_next = 1;
+static uint64_t tlb_flush_pending; // cpumask, under asid_lock
+static DEFINE_PER_CPU(uint64_t, active_asid);
+static DEFINE_PER_CPU(uint64_t, reserved_asid);
+
+static inline void write_ttbr0(uint64_t val)
+{
+    __asm__ volatile("msr ttbr0_el1, %0\n\t"
+                     "isb"
+                     :
+                     : "r"(val)
+                     : "memory");
+}
+
+static inline bool asid_test_and_set(uint64_t asid)
+{
+    uint64_t bit = 1UL << (asid % 64);
+    bool was = asid_map[asid / 64] & bit;
+
+    asid_map[asid / 64] |= bit;
+    return was;
+}
+
+// New generation: every CPU keeps the ASID it is running with, all other
+// ASIDs become free, and each CPU flushes its TLB on its next switch.
+static void flush_context(void)
+{
+    int cpu;
+
+    asid_generation += ASID_FIRST_VERSION;
+    memset(asid_map, 0, sizeof(asid_map));
+    asid_map[0] = 1; // ASID 0 belongs to the kernel page table
+
+    for (cpu = 0; cpu < NR_CPUS; cpu++)
+    {
+        uint64_t asid = per_cpu(active_asid, cpu);
+        per_cpu(active_asid, cpu) = 0;
+        if (asid == 0)
+            asid = per_cpu(reserved_asid, cpu);
+        asid_test_and_set(asid & ASID_MASK);
+        per_cpu(reserved_asid, cpu) = asid;
+    }
+    tlb_flush_pending = (1UL << NR_CPUS) - 1;
+}
+
+static bool check_update_reserved(uint64_t old, uint64_t new)
+{
+    bool hit = false;
+
+    for (int cpu = 0; cpu < NR_CPUS; cpu++)
+    {
+        if (per_cpu(reserved_asid, cpu) == old)
+        {
+            per_cpu(reserved_asid, cpu) = new;
+            hit = true;
+        }
+    }
+    return hit;
+}
+
+static uint64_t new_context(struct mm *mm)
+{
+    uint64_t asid = mm->context & ASID_MASK;
+
+    if (asid)
+    {
+        uint64_t new = asid_generation | asid;
+
+        // Still live on some CPU across a rollover: keep it
+        if (check_update_reserved(mm->context, new))
+            return new;
+        // Otherwise try to get the same number back in this generation
+        if (!asid_test_and_set(asid))
+            return new;
+    }
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (uint64_t n = 0; n < NUM_ASIDS - 1; n++)
+        {
+            asid = asid_next;
+            asid_next = asid_next + 1 < NUM_ASIDS ? asid_next + 1 : 1;
+            if (!asid_test_and_set(asid))
+                return asid_generation | asid;
+        }
+        flush_context();
+    }
+    panic("mm: out of ASIDs\n");
+}
+
+void mm_switch(struct mm *mm)
+{
+    uint64_t flags = local_irq_save();
+    uint64_t ctx;
+    int cpu = smp_processor_id();
+
+    spin_lock(&asid_lock);
+    ctx = mm->context;
+    if ((ctx ^ asid_generation) >> ASID_BITS)
+    {
+        ctx = new_context(mm);
+        mm->context = ctx;
+    }
+    if (tlb_flush_pending & (1UL << cpu))
+    {
+        __asm__ volatile("tlbi vmalle1\n\t"
+                         "dsb nsh"
+                         :
+                         :
+                         : "memory");
+        tlb_flush_pending &= ~(1UL << cpu);
+    }
+    this_cpu_write(active_asid, ctx);
+    spin_unlock(&asid_lock);
+
+    write_ttbr0((uint64_t)mm->pgd | ((ctx & ASID_MASK) << TTBR_ASID_SHIFT));
+    local_irq_restore(flags);
+}
+
+// Kernel threads run on the boot table; its entries are global
+void mm_switch_kernel(void)
+{
+    write_ttbr0((uint64_t)boot_pgd);
+}
+
+struct mm *mm_create(void)
+{
+    struct mm *mm = NULL;
+
+    spin_lock(&mm_pool_lock);
+    for (int i = 0; i < MAX_TASKS; i++)
+    {
+        if (!mm_used[i])
+        {
+            mm_used[i] = true;
+            mm = &mm_pool[i];
+            break;
+        }
+    }
+    spin_unlock(&mm_pool_lock);
+    if (!mm)
+        return NULL;
+
+    mm->pgd = alloc_pages(0);
+    if (!mm->pgd)
+    {
+        mm_destroy(mm);
+        return NULL;
+    }
+    memcpy(mm->pgd, boot_pgd, PAGE_SIZE);
+    mm->context = 0;
+    mm->nr_vmas = 0;
+    mm->mmap_next = USER_MMAP_BASE;
+    return mm;
+}
+
+static uint64_t *table_of(uint64_t desc)
+{
+    return (uint64_t *)(desc & PTE_ADDR_MASK);
+}
+
+uint64_t *mm_walk(struct mm *mm, vaddr_t va, bool alloc)
+{
+    uint64_t *table = mm->pgd;
+    int shifts[2] = {L1_BLOCK_SHIFT, L2_BLOCK_SHIFT};
+
+    for (int level = 0; level < 2; level++)
+    {
+        uint64_t *desc = &table[(va >> shifts[level]) & (PTRS_PER_TABLE - 1)];
+
+        if (!(*desc & PTE_VALID))
+        {
+            uint64_t *next;
+            if (!alloc || !(next = alloc_zeroed_pages(0)))
+                return NULL;
+            __asm__ volatile("dsb ishst" ::: "memory");
+            *desc = (uint64_t)next | PTE_TABLE | PTE_VALID;
+        }
+        else if ((*desc & PTE_TYPE_MASK) != (PTE_TABLE | PTE_VALID))
+        {
+            return NULL; // block mapping, not ours to split
+        }
+        table = table_of(*desc);
+    }
+    return &table[(va >> PAGE_SHIFT) & (PTRS_PER_TABLE - 1)];
+}
+
+// Descriptor attributes for prot, without the page/block type bit
+static uint64_t prot_attrs(int prot, bool owned)
+{
+    uint64_t attrs = PTE_VALID | PTE_ATTRINDX(MT_NORMAL) | PTE_SH_INNER | PTE_AF | PTE_NG |
+                     PTE_AP_EL0 | PTE_PXN;
+
+    if (prot & PROT_KERNEL)
+        attrs = PTE_VALID | PTE_ATTRINDX(MT_NORMAL) | PTE_SH_INNER | PTE_AF | PTE_PXN | PTE_UXN;
+    if (!(prot & PROT_WRITE))
+        attrs |= PTE_AP_RO;
+    if (!(prot & PROT_EXEC))
+        attrs |= PTE_UXN;
+    if (prot & PROT_NOCACHE)
+        attrs = (attrs & ~PTE_ATTRINDX(7)) | PTE_ATTRINDX(MT_NORMAL_NC);
+    if (owned)
+        attrs |= PTE_SW_OWNED;
+    return attrs;
+}
+
+int mm_map_page(struct mm *mm, vaddr_t va, paddr_t pa, int prot, bool owned)
+{
+    uint64_t *pte = mm_walk(mm, va, true);
+
+    if (!pte)
+        return -1;
+    *pte = (pa & PTE_ADDR_MASK) | PTE_PAGE | prot_attrs(prot, owned);
+    __asm__ volatile("dsb ishst" ::: "memory");
+    return 0;
+}
+
+// One L2 (2MB) or L1 (1GB) block descriptor; va and pa aligned to size.
+// Only fills empty slots: an existing table is never replaced by a block.
+int mm_map_huge(struct mm *mm, vaddr_t va, paddr_t pa, uint64_t size, int prot, bool owned)
+{
+    uint64_t *desc = &mm->pgd[(va >> L1_BLOCK_SHIFT) & (PTRS_PER_TABLE - 1)];
+
+    if ((size != L2_BLOCK_SIZE && size != L1_BLOCK_SIZE) || ((va | pa) & (size - 1)))
+        return -1;
+    if (size == L2_BLOCK_SIZE)
+    {
+        if (!(*desc & PTE_VALID))
+        {
+            uint64_t *next = alloc_zeroed_pages(0);
+
+            if (!next)
+                return -1;
+            __asm__ volatile("dsb ishst" ::: "memory");
+            *desc = (uint64_t)next | PTE_TABLE | PTE_VALID;
+        }
+        else if ((*desc & PTE_TYPE_MASK) != (PTE_TABLE | PTE_VALID))
+        {
+            return -1;
+        }
+        desc = &table_of(*desc)[(va >> L2_BLOCK_SHIFT) & (PTRS_PER_TABLE - 1)];
+    }
+    if (*desc & PTE_VALID)
+        return -1;
+
+    *desc = (pa & PTE_ADDR_MASK) | PTE_BLOCK | prot_attrs(prot, owned);
+    __asm__ volatile("dsb ishst" ::: "memory");
+    return 0;
+}
+
+// The entry may be cached under any ASID (or none, for kernel pages)
+void mm_unmap_page(struct mm *mm, vaddr_t va)
+{
+    uint64_t *pte = mm_walk(mm, va, false);
+
+    if (!pte || !(*pte & PTE_VALID))
+        return;
+    *pte = 0;
+    __asm__ volatile("dsb ishst\n\t"
+                     "tlbi vaae1is, %0\n\t"
+                     "dsb ish\n\t"
+                     "isb"
+                     :
+                     : "r"(va >> PAGE_SHIFT)
+                     : "memory");
+}
+
+static void free_table(uint64_t *table, int level)
+{
+    for (int i = 0; i < PTRS_PER_TABLE; i++)
+    {
+        uint64_t desc = table[i];
+
+        if (!(desc & PTE_VALID))
+            continue;
+        if (level < 2 && (desc & PTE_TYPE_MASK) == (PTE_TABLE | PTE_VALID))
+            free_table(table_of(desc), level + 1);
+        else if (level == 1 && (desc & PTE_SW_OWNED))
+            free_huge(table_of(desc), L2_BLOCK_SIZE);
+        else if (level == 2 && (desc & PTE_SW_OWNED))
+            free_page(table_of(desc));
+    }
+    free_page(table);
+}
+
+// The ASID is not recycled here; it only comes back at the next rollover,
+// which flushes every TLB, so stale entries can never be hit.
+void mm_destroy(struct mm *mm)
+{
+    if (mm->pgd)
+    {
+        uint64_t desc = mm->pgd[USER_L1_INDEX];
+
+        // Everything else is the boot table's, the shared KMAP slot included
+        if ((desc & PTE_TYPE_MASK) == (PTE_TABLE | PTE_VALID))
+            free_table(table_of(desc), 1);
+        else if ((desc & PTE_VALID) && (desc & PTE_SW_OWNED))
+            free_huge(table_of(desc), L1_BLOCK_SIZE);
+        free_page(mm->pgd);
+        mm->pgd = NULL;
+    }
+
+    spin_lock(&mm_pool_lock);
+    mm_used[mm - mm_pool] = false;
+    spin_unlock(&mm_pool_lock);
+}
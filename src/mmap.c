@@ -0,0 +1,184 @@
+/*
+ * File: mmap.c
+ * Date: 2026-10-18
+ * Description: Demand-paged file mappings for EL0 tasks and the kernel.
+ *              Translation faults inside a mapping are filled from the
+ *              shared page cache; sequential faults grow a read-ahead
+ *              window so that the next pages are already in flight.
+ */
+
+#include "mmap.h"
+#include "exception.h"
+#include "irq.h"
+#include "page_alloc.h"
+#include "pagecache.h"
+#include "sched.h"
+#include "spin_lock.h"
+#include "stats.h"
+#include "tinystd.h"
+
+DEFINE_STAT(page_faults, "translation faults resolved from the page cache");
+
+// Guards the VMA lists; init_mm is shared by every CPU
+static spinlock_t mmap_lock;
+
+// Install the KMAP L2 table before the first mm copies boot_pgd
+void mmap_init(void)
+{
+    uint64_t *table = alloc_zeroed_pages(0);
+
+    if (!table)
+        panic("mmap: no memory for the kernel map table\n");
+    __asm__ volatile("dsb ishst" ::: "memory");
+    boot_pgd[KMAP_L1_INDEX] = (uint64_t)table | PTE_TABLE | PTE_VALID;
+    __asm__ volatile("dsb ishst\n\t"
+                     "isb" ::: "memory");
+    pagecache_init();
+}
+
+static vaddr_t mmap_limit(struct mm *mm)
+{
+    return mm == &init_mm ? KMAP_END : USER_MMAP_END;
+}
+
+// Returns the start address, 0 when the file or the address space is full
+vaddr_t mmap_file(struct mm *mm, struct fat_file *f, int prot)
+{
+    uint64_t len = ((uint64_t)f->size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    struct vma *vma;
+    vaddr_t start = 0;
+    uint64_t flags;
+
+    if (!len)
+        return 0;
+    flags = local_irq_save();
+    spin_lock(&mmap_lock);
+    if (mm->nr_vmas < MM_MAX_VMAS && len <= mmap_limit(mm) - mm->mmap_next)
+    {
+        vma = &mm->vmas[mm->nr_vmas++];
+        start = mm->mmap_next;
+        vma->start = start;
+        vma->end = start + len;
+        vma->file = f;
+        vma->prot = prot;
+        vma->ra_last = (uint64_t)-1;
+        vma->ra_window = 0;
+        mm->mmap_next = vma->end + PAGE_SIZE; // unmapped guard page
+    }
+    spin_unlock(&mmap_lock);
+    local_irq_restore(flags);
+    return start;
+}
+
+// Bare KMAP address space for the caller to map itself (no VMA, no faults)
+vaddr_t kmap_reserve(uint64_t len, uint64_t align)
+{
+    vaddr_t start = 0, va;
+    uint64_t flags;
+
+    len = (len + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    align = MAX(align, PAGE_SIZE);
+    flags = local_irq_save();
+    spin_lock(&mmap_lock);
+    va = (init_mm.mmap_next + align - 1) & ~(align - 1);
+    if (va >= init_mm.mmap_next && len && len <= KMAP_END - va)
+    {
+        start = va;
+        init_mm.mmap_next = va + len + PAGE_SIZE;
+    }
+    spin_unlock(&mmap_lock);
+    local_irq_restore(flags);
+    return start;
+}
+
+const void *kmmap(const char *path, uint64_t *size)
+{
+    struct fat_file *f = fat32_open(path);
+
+    if (!f)
+        return NULL;
+    if (size)
+        *size = f->size;
+    return (const void *)mmap_file(&init_mm, f, PROT_READ | PROT_KERNEL);
+}
+
+static struct vma *vma_find(struct mm *mm, vaddr_t addr)
+{
+    for (uint32_t i = 0; i < mm->nr_vmas; i++)
+    {
+        if (addr >= mm->vmas[i].start && addr < mm->vmas[i].end)
+            return &mm->vmas[i];
+    }
+    return NULL;
+}
+
+/*
+ * Translation fault at `addr`; returns 0 once the page is mapped. Runs
+ * with IRQs enabled when the faulting context had them, and may sleep.
+ */
+int vm_fault(vaddr_t addr, bool write, bool exec, bool user)
+{
+    struct mm *mm = NULL;
+    struct fat_file *file;
+    struct pc_page *pg;
+    struct vma *vma;
+    uint64_t index, flags;
+    uint32_t ra = 0;
+    int prot, ret;
+
+    // Reading the page in may sleep, which a lock holder must never do
+    if (!user && in_spinlock())
+    {
+        tiny_error("vm_fault: 0x%llx touched with a spinlock held\n", addr);
+        return -1;
+    }
+    if (addr >= KMAP_BASE && addr < KMAP_END && !user)
+        mm = &init_mm;
+    else if (addr >= USER_BASE && addr < USER_STACK_TOP)
+        mm = current->mm;
+    if (!mm)
+        return -1;
+
+    flags = local_irq_save();
+    spin_lock(&mmap_lock);
+    vma = vma_find(mm, addr);
+    if (!vma || (write && !(vma->prot & PROT_WRITE)) || (exec && !(vma->prot & PROT_EXEC)))
+    {
+        spin_unlock(&mmap_lock);
+        local_irq_restore(flags);
+        return -1;
+    }
+    index = (addr - vma->start) >> PAGE_SHIFT;
+    if (index == vma->ra_last + 1)
+        vma->ra_window = vma->ra_window ? MIN(vma->ra_window * 2, PC_RA_MAX) : PC_RA_MIN;
+    else if (index != vma->ra_last)
+        vma->ra_window = 0;
+    vma->ra_last = index;
+    ra = vma->ra_window;
+    file = vma->file;
+    prot = vma->prot;
+    addr = vma->start + (index << PAGE_SHIFT);
+    spin_unlock(&mmap_lock);
+    local_irq_restore(flags);
+
+    // Faulting page and window go out as one batch
+    if (ra)
+        pagecache_readahead(file, index, ra + 1);
+    pg = pagecache_get(file, index);
+    if (!pg)
+        return -1;
+    ret = pagecache_map(pg, mm, addr, prot);
+    pagecache_put(pg);
+    if (!ret)
+        stat_inc(page_faults);
+    return ret;
+}
+
+// Called before mm_destroy; the page tables go with the mm
+void mmap_teardown(struct mm *mm)
+{
+    if (!mm->nr_vmas)
+        return;
+    pagecache_forget_mm(mm);
+    mm->nr_vmas = 0;
+}
@@ -0,0 +1,216 @@
+/*
+ * File: napi.c
+ * Date: 2026-10-18
+ * Description: Adaptive interrupt/poll switching for device queues. One
+ *              kernel thread on the poll CPU services every device that is
+ *              currently in poll mode and sleeps when none is.
+ */
+
+#include "napi.h"
+#include "atomic.h"
+#include "irq.h"
+#include "sched.h"
+#include "smp.h"
+#include "timer.h"
+#include "tinystd.h"
+
+static struct napi_struct *napi_devs[NAPI_MAX_DEVICES];
+static uint32_t napi_count;
+static int napi_cpu = -1;
+
+// Guards mode switches; taken from the device IRQ as well
+static spinlock_t napi_lock;
+static struct wait_queue napi_wq;
+
+static const char *const napi_policy_names[] = {"irq", "adaptive", "poll"};
+
+static void napi_switch(struct napi_struct *n, enum napi_mode mode)
+{
+    uint64_t now = read_cntvct();
+
+    n->stats.ticks[n->mode] += now - n->mode_since;
+    n->mode_since = now;
+    n->last_work = now;
+    if (mode == NAPI_MODE_POLL)
+        n->stats.to_poll++;
+    else
+        n->stats.to_irq++;
+    WRITE_ONCE(n->mode, mode);
+}
+
+// napi_lock held: mask the device and hand it to the poll thread
+static void napi_enter_poll(struct napi_struct *n)
+{
+    n->irq_disable(n);
+    napi_switch(n, NAPI_MODE_POLL);
+    wait_queue_wake_all(&napi_wq);
+}
+
+// Poll thread: back to interrupts, unless completions raced with the unmask
+static void napi_complete(struct napi_struct *n)
+{
+    uint64_t flags = local_irq_save();
+
+    spin_lock(&napi_lock);
+    if (n->mode == NAPI_MODE_POLL && n->policy != NAPI_POLICY_POLL)
+    {
+        napi_switch(n, NAPI_MODE_IRQ);
+        if (!n->irq_enable(n))
+            napi_enter_poll(n);
+    }
+    spin_unlock(&napi_lock);
+    local_irq_restore(flags);
+}
+
+static bool napi_any_polling(void)
+{
+    for (uint32_t i = 0; i < napi_count; i++)
+    {
+        if (READ_ONCE(napi_devs[i]->mode) == NAPI_MODE_POLL)
+            return true;
+    }
+    return false;
+}
+
+static void napi_poll_thread(void *arg)
+{
+    uint64_t flags;
+
+    while (1)
+    {
+        for (uint32_t i = 0; i < napi_count; i++)
+        {
+            struct napi_struct *n = napi_devs[i];
+            int work;
+
+            if (READ_ONCE(n->mode) != NAPI_MODE_POLL)
+                continue;
+
+            work = n->poll(n, n->budget);
+            n->stats.polls++;
+            n->stats.work += work;
+            if (work)
+                n->last_work = read_cntvct();
+            else
+                n->stats.empty_polls++;
+
+            if (n->policy == NAPI_POLICY_IRQ ||
+                (n->policy == NAPI_POLICY_ADAPTIVE && !work &&
+                 read_cntvct() - n->last_work > ns_to_ticks(n->idle_ns)))
+                napi_complete(n);
+        }
+
+        flags = local_irq_save();
+        spin_lock(&napi_lock);
+        while (!napi_any_polling())
+            wait_queue_sleep(&napi_wq, &napi_lock);
+        spin_unlock(&napi_lock);
+        local_irq_restore(flags);
+        cond_resched();
+    }
+}
+
+int napi_init(int cpu)
+{
+    if (!cpu_online(cpu))
+        cpu = smp_processor_id();
+    napi_cpu = cpu;
+    if (!kthread_create("napi", napi_poll_thread, NULL, cpu, PRIO_NORMAL))
+        return -1;
+    tiny_info("napi: poll thread on cpu%d\n", cpu);
+    return 0;
+}
+
+int napi_register(struct napi_struct *n)
+{
+    uint64_t flags;
+
+    if (napi_count >= NAPI_MAX_DEVICES)
+        return -1;
+    if (!n->budget)
+        n->budget = NAPI_DEFAULT_BUDGET;
+    if (!n->idle_ns)
+        n->idle_ns = NAPI_DEFAULT_IDLE_NS;
+    n->mode = NAPI_MODE_IRQ;
+    n->mode_since = read_cntvct();
+
+    flags = local_irq_save();
+    spin_lock(&napi_lock);
+    napi_devs[napi_count++] = n;
+    if (n->policy == NAPI_POLICY_POLL)
+        napi_enter_poll(n);
+    spin_unlock(&napi_lock);
+    local_irq_restore(flags);
+    return 0;
+}
+
+/*
+ * Device IRQ: the driver has already acknowledged the interrupt. A device
+ * still in POLL mode belongs to the poll thread, even when its policy has
+ * just become IRQ: the thread hands it back with napi_complete(). Polling
+ * inline under napi_lock keeps it from being handed over meanwhile.
+ */
+void napi_schedule(struct napi_struct *n)
+{
+    spin_lock(&napi_lock);
+    n->stats.irqs++;
+    if (n->mode == NAPI_MODE_IRQ)
+    {
+        if (n->policy == NAPI_POLICY_IRQ || napi_cpu < 0)
+        {
+            int work = n->poll(n, n->budget);
+            n->stats.polls++;
+            n->stats.work += work;
+        }
+        else
+        {
+            napi_enter_poll(n);
+        }
+    }
+    spin_unlock(&napi_lock);
+}
+
+// Runtime knob; a device leaving POLL drops back to IRQs on its next pass
+void napi_set_policy(struct napi_struct *n, enum napi_policy policy)
+{
+    uint64_t flags = local_irq_save();
+
+    spin_lock(&napi_lock);
+    n->policy = policy;
+    if (policy == NAPI_POLICY_POLL && n->mode == NAPI_MODE_IRQ && napi_cpu >= 0)
+        napi_enter_poll(n);
+    spin_unlock(&napi_lock);
+    local_irq_restore(flags);
+    tiny_info("napi: %s policy %s\n", n->name, napi_policy_names[policy]);
+}
+
+struct napi_struct *napi_find(const char *name)
+{
+    for (uint32_t i = 0; i < napi_count; i++)
+    {
+        if (!strcmp(napi_devs[i]->name, name))
+            return napi_devs[i];
+    }
+    return NULL;
+}
+
+void napi_dump(void)
+{
+    uint64_t now = read_cntvct();
+
+    for (uint32_t i = 0; i < napi_count; i++)
+    {
+        struct napi_struct *n = napi_devs[i];
+        uint64_t ticks[NR_NAPI_MODES] = {n->stats.ticks[0], n->stats.ticks[1]};
+
+        ticks[n->mode] += now - n->mode_since;
+        tiny_info("napi %s: policy %s, mode %s, irqs %llu, polls %llu (%llu empty), "
+                  "work %llu, switches %llu/%llu, irq %llu us, poll %llu us\n",
+                  n->name, napi_policy_names[n->policy],
+                  n->mode == NAPI_MODE_POLL ? "poll" : "irq", n->stats.irqs,
+                  n->stats.polls, n->stats.empty_polls, n->stats.work,
+                  n->stats.to_poll, n->stats.to_irq,
+                  ticks_to_ns(ticks[NAPI_MODE_IRQ]) / NSEC_PER_USEC,
+                  ticks_to_ns(ticks[NAPI_MODE_POLL]) / NSEC_PER_USEC);
+    }
+}
@@ -0,0 +1,283 @@
+/*
+ * File: page_alloc.c
+ * Date: 2026-10-18
+ * Description: Binary buddy page allocator. Page indices are relative to
+ *              the start of the RAM bank, so an order-n block is also
+ *              physically aligned to 2^n pages. Free lists are threaded
+ *              through the free pages themselves (RAM is identity mapped).
+ */
+
+#include "page_alloc.h"
+#include "fdt.h"
+#include "pagecache.h"
+#include "shell.h"
+#include "spin_lock.h"
+#include "tiny_pool.h"
+#include "tinystd.h"
+
+struct free_block
+{
+    struct free_block *next;
+    struct free_block *prev;
+};
+
+struct free_area
+{
+    struct free_block *head;
+    uint64_t nr_free;
+};
+
+extern char __image_end[];
+
+static struct free_area free_area[MAX_ORDER];
+static struct page *page_map;
+static paddr_t ram_base;
+static uint64_t nr_pages;
+static uint64_t nr_free_pages;
+static spinlock_t zone_lock;
+
+static inline uint64_t pa_to_idx(paddr_t pa)
+{
+    return (pa - ram_base) >> PAGE_SHIFT;
+}
+
+static inline void *idx_to_va(uint64_t idx)
+{
+    return (void *)(ram_base + (idx << PAGE_SHIFT));
+}
+
+static void area_push(uint64_t idx, uint32_t order)
+{
+    struct free_block *blk = idx_to_va(idx);
+    struct free_area *area = &free_area[order];
+
+    blk->prev = NULL;
+    blk->next = area->head;
+    if (area->head)
+        area->head->prev = blk;
+    area->head = blk;
+    area->nr_free++;
+    page_map[idx].order = order;
+    page_map[idx].flags = PG_FREE;
+}
+
+static void area_remove(uint64_t idx, uint32_t order)
+{
+    struct free_block *blk = idx_to_va(idx);
+    struct free_area *area = &free_area[order];
+
+    if (blk->prev)
+        blk->prev->next = blk->next;
+    else
+        area->head = blk->next;
+    if (blk->next)
+        blk->next->prev = blk->prev;
+    area->nr_free--;
+    page_map[idx].flags = 0;
+}
+
+static void __free_block(uint64_t idx, uint32_t order)
+{
+    while (order < MAX_ORDER - 1)
+    {
+        uint64_t buddy = idx ^ (1UL << order);
+        if (buddy >= nr_pages || !(page_map[buddy].flags & PG_FREE) ||
+            page_map[buddy].order != order)
+            break;
+        area_remove(buddy, order);
+        idx = MIN(idx, buddy);
+        order++;
+    }
+    area_push(idx, order);
+}
+
+void page_alloc_init(void)
+{
+    paddr_t mapped_end = DEFAULT_RAM_BASE + (paddr_t)BOOT_RAM_GB * L1_BLOCK_SIZE;
+    paddr_t ram_end = MIN(dev_table.memory.base + dev_table.memory.size, mapped_end);
+    paddr_t first_free;
+    uint64_t idx, end;
+
+    ram_base = dev_table.memory.base;
+    nr_pages = (ram_end - ram_base) >> PAGE_SHIFT;
+
+    // The page map sits right after the kernel image
+    page_map = (struct page *)(((uintptr_t)__image_end + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1));
+    first_free = (uintptr_t)page_map + nr_pages * sizeof(struct page);
+    first_free = (first_free + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+
+    for (idx = 0; idx < nr_pages; idx++)
+    {
+        page_map[idx].order = 0;
+        page_map[idx].flags = PG_RESERVED;
+        page_map[idx].refcount = 0;
+    }
+
+    // Hand out the largest naturally aligned blocks that fit
+    idx = pa_to_idx(first_free);
+    end = nr_pages;
+    while (idx < end)
+    {
+        uint32_t order = MAX_ORDER - 1;
+        while ((idx & ((1UL << order) - 1)) || idx + (1UL << order) > end)
+            order--;
+        area_push(idx, order);
+        idx += 1UL << order;
+        nr_free_pages += 1UL << order;
+    }
+
+    tiny_info("page_alloc: %llu MB free of %llu MB, page map at 0x%lx\n",
+              (nr_free_pages << PAGE_SHIFT) >> 20, (nr_pages << PAGE_SHIFT) >> 20,
+              (unsigned long)page_map);
+}
+
+void *alloc_pages(uint32_t order)
+{
+    uint32_t k;
+    uint64_t idx;
+
+    if (order >= MAX_ORDER)
+        return NULL;
+
+    spin_lock(&zone_lock);
+    for (k = order; k < MAX_ORDER && !free_area[k].head; k++)
+        ;
+    if (k == MAX_ORDER)
+    {
+        spin_unlock(&zone_lock);
+        return NULL;
+    }
+
+    idx = pa_to_idx((paddr_t)free_area[k].head);
+    area_remove(idx, k);
+    while (k > order)
+    {
+        k--;
+        area_push(idx + (1UL << k), k);
+    }
+    page_map[idx].order = order;
+    page_map[idx].refcount = 1;
+    nr_free_pages -= 1UL << order;
+    spin_unlock(&zone_lock);
+
+    return idx_to_va(idx);
+}
+
+void *alloc_zeroed_pages(uint32_t order)
+{
+    void *p = alloc_pages(order);
+
+    if (p)
+        memset(p, 0, PAGE_SIZE << order);
+    return p;
+}
+
+void free_pages(void *addr, uint32_t order)
+{
+    uint64_t idx;
+
+    if (!addr)
+        return;
+    idx = pa_to_idx((paddr_t)addr);
+
+    spin_lock(&zone_lock);
+    page_map[idx].refcount = 0;
+    __free_block(idx, order);
+    nr_free_pages += 1UL << order;
+    spin_unlock(&zone_lock);
+}
+
+// Every max-order block of a 1GB-aligned range free: take them all
+static void *alloc_gigantic(void)
+{
+    const uint64_t span = L1_BLOCK_SIZE >> PAGE_SHIFT;
+    const uint64_t step = 1UL << (MAX_ORDER - 1);
+    uint64_t first = pa_to_idx((ram_base + L1_BLOCK_SIZE - 1) & ~(L1_BLOCK_SIZE - 1));
+
+    for (uint64_t base = first; base + span <= nr_pages; base += span)
+    {
+        uint64_t idx;
+
+        for (idx = base; idx < base + span; idx += step)
+        {
+            if (!(page_map[idx].flags & PG_FREE) || page_map[idx].order != MAX_ORDER - 1)
+                break;
+        }
+        if (idx < base + span)
+            continue;
+        for (idx = base; idx < base + span; idx += step)
+            area_remove(idx, MAX_ORDER - 1);
+        page_map[base].flags = PG_HUGE;
+        page_map[base].refcount = 1;
+        nr_free_pages -= span;
+        return idx_to_va(base);
+    }
+    return NULL;
+}
+
+// size is L2_BLOCK_SIZE or L1_BLOCK_SIZE; the block is aligned to its size
+void *alloc_huge(uint64_t size)
+{
+    void *p;
+
+    if (size == L2_BLOCK_SIZE)
+        return alloc_pages(HUGE_2M_ORDER);
+    if (size != L1_BLOCK_SIZE)
+        return NULL;
+    spin_lock(&zone_lock);
+    p = alloc_gigantic();
+    spin_unlock(&zone_lock);
+    if (!p)
+        tiny_warn("page_alloc: no free 1GB-aligned range\n");
+    return p;
+}
+
+void free_huge(void *addr, uint64_t size)
+{
+    uint64_t idx;
+
+    if (!addr)
+        return;
+    if (size == L2_BLOCK_SIZE)
+    {
+        free_pages(addr, HUGE_2M_ORDER);
+        return;
+    }
+    idx = pa_to_idx((paddr_t)addr);
+    spin_lock(&zone_lock);
+    page_map[idx].refcount = 0;
+    for (uint64_t i = 0; i < (L1_BLOCK_SIZE >> PAGE_SHIFT); i += 1UL << (MAX_ORDER - 1))
+        __free_block(idx + i, MAX_ORDER - 1);
+    nr_free_pages += L1_BLOCK_SIZE >> PAGE_SHIFT;
+    spin_unlock(&zone_lock);
+}
+
+struct page *virt_to_page(const void *addr)
+{
+    uint64_t idx = pa_to_idx((paddr_t)addr);
+
+    return idx < nr_pages ? &page_map[idx] : NULL;
+}
+
+uint64_t page_alloc_free_pages(void)
+{
+    return nr_free_pages;
+}
+
+void page_alloc_dump(void)
+{
+    tiny_info("page_alloc: %llu free pages (%llu KB)\n", nr_free_pages,
+              (nr_free_pages << PAGE_SHIFT) >> 10);
+    for (uint32_t k = 0; k < MAX_ORDER; k++)
+        tiny_info("  order %2u (%5llu KB): %llu free\n", k, (PAGE_SIZE << k) >> 10,
+                  free_area[k].nr_free);
+}
+
+static int cmd_mem(int argc, char **argv)
+{
+    page_alloc_dump();
+    tiny_pool_dump();
+    pagecache_dump();
+    return 0;
+}
+SHELL_CMD(mem, "free pages per order, object pools and page cache usage", cmd_mem);
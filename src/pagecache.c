@@ -0,0 +1,451 @@
+/*
+ * File: pagecache.c
+ * Date: 2026-10-18
+ * Description: Shared page cache for FAT32 files: asynchronous page reads
+ *              through the block layer, plugged read-ahead batches that
+ *              merge into large requests, and a clock sweep that evicts
+ *              clean pages when the page allocator runs low.
+ */
+
+#include "pagecache.h"
+#include "atomic.h"
+#include "blk.h"
+#include "irq.h"
+#include "page_alloc.h"
+#include "sched.h"
+#include "spin_lock.h"
+#include "tinystd.h"
+
+#define PC_SECTORS_PER_PAGE (PAGE_SIZE / BLK_SECTOR_SIZE)
+
+// One page read, split into one request per contiguous run of sectors
+struct pc_io
+{
+    struct pc_page *pg;
+    volatile uint32_t pending;
+    int status;
+    struct pc_io *next;
+    struct blk_request rq[PC_SECTORS_PER_PAGE];
+};
+
+static struct pc_page pc_pages[PC_MAX_PAGES];
+static struct pc_page *pc_hash[PC_HASH_SIZE];
+static struct pc_page *pc_free;
+static struct pc_io pc_ios[PC_MAX_IO];
+static struct pc_io *pc_io_free;
+static uint32_t pc_nr_cached;
+static uint32_t pc_hand; // clock sweep position
+static struct pc_stats pc_stats;
+
+// Protects everything above; also taken from the block completion IRQ
+static spinlock_t pc_lock;
+static struct wait_queue pc_wq; // page reads and I/O contexts
+
+static inline uint32_t pc_hashfn(const struct fat_file *f, uint64_t index)
+{
+    return (uint32_t)(((uintptr_t)f >> 6) ^ (index * 0x9e3779b1UL)) % PC_HASH_SIZE;
+}
+
+static inline uint64_t pc_file_pages(const struct fat_file *f)
+{
+    return ((uint64_t)f->size + PAGE_SIZE - 1) >> PAGE_SHIFT;
+}
+
+void pagecache_init(void)
+{
+    for (int i = PC_MAX_PAGES - 1; i >= 0; i--)
+    {
+        pc_pages[i].next = pc_free;
+        pc_free = &pc_pages[i];
+    }
+    for (int i = PC_MAX_IO - 1; i >= 0; i--)
+    {
+        pc_ios[i].next = pc_io_free;
+        pc_io_free = &pc_ios[i];
+    }
+}
+
+// pc_lock held
+static struct pc_page *pc_lookup(const struct fat_file *f, uint64_t index)
+{
+    struct pc_page *pg = pc_hash[pc_hashfn(f, index)];
+
+    while (pg && (pg->file != f || pg->index != index))
+        pg = pg->next;
+    return pg;
+}
+
+// pc_lock held. The idle task cannot sleep, so it spins with IRQs on.
+static void pc_wait_locked(void)
+{
+    if (current->pid == 0)
+    {
+        spin_unlock(&pc_lock);
+        local_irq_enable();
+        cpu_relax();
+        local_irq_disable();
+        spin_lock(&pc_lock);
+        return;
+    }
+    wait_queue_sleep(&pc_wq, &pc_lock);
+}
+
+// pc_lock held: tear down every mapping, then give the page back
+static void pc_evict(struct pc_page *pg)
+{
+    struct pc_page **pp = &pc_hash[pc_hashfn(pg->file, pg->index)];
+
+    for (uint32_t i = 0; i < pg->nr_maps; i++)
+    {
+        mm_unmap_page(pg->maps[i].mm, pg->maps[i].va);
+        pc_stats.unmapped++;
+    }
+    while (*pp != pg)
+        pp = &(*pp)->next;
+    *pp = pg->next;
+
+    free_page(pg->data);
+    pg->file = NULL;
+    pg->next = pc_free;
+    pc_free = pg;
+    pc_nr_cached--;
+    pc_stats.evicted++;
+}
+
+/*
+ * pc_lock held. Clock sweep over the cache: the first two passes only take
+ * unmapped pages, giving referenced ones a second chance; the last pass
+ * unmaps cold pages as well. Pages are never dirty, so nothing is written.
+ */
+static uint32_t pc_evict_locked(uint32_t want)
+{
+    uint32_t freed = 0;
+
+    for (int pass = 0; pass < 3 && freed < want; pass++)
+    {
+        for (uint32_t n = 0; n < PC_MAX_PAGES && freed < want; n++)
+        {
+            struct pc_page *pg = &pc_pages[pc_hand];
+
+            pc_hand = (pc_hand + 1) % PC_MAX_PAGES;
+            if (!pg->file || pg->refs || (pg->flags & PC_IO) || pg->nr_maps > PC_MAX_MAPS)
+                continue;
+            if (!(pg->flags & PC_ERROR))
+            {
+                if (pg->nr_maps && pass < 2)
+                    continue;
+                if ((pg->flags & PC_REFERENCED) && pass < 2)
+                {
+                    pg->flags &= ~PC_REFERENCED;
+                    continue;
+                }
+            }
+            pc_evict(pg);
+            freed++;
+        }
+    }
+    return freed;
+}
+
+uint32_t pagecache_shrink(uint32_t nr)
+{
+    uint64_t flags = local_irq_save();
+    uint32_t freed;
+
+    spin_lock(&pc_lock);
+    freed = pc_evict_locked(nr);
+    spin_unlock(&pc_lock);
+    local_irq_restore(flags);
+    return freed;
+}
+
+static void pc_io_finish(struct pc_io *io)
+{
+    struct pc_page *pg = io->pg;
+    uint64_t flags = local_irq_save();
+    uint64_t valid = pg->file->size - (pg->index << PAGE_SHIFT);
+
+    // Whatever the last sector held past end of file reads as zeroes
+    if (!io->status && valid < PAGE_SIZE)
+        memset((char *)pg->data + valid, 0, PAGE_SIZE - valid);
+
+    spin_lock(&pc_lock);
+    pg->flags &= ~PC_IO;
+    if (io->status)
+    {
+        pg->flags |= PC_ERROR;
+        pc_stats.io_errors++;
+    }
+    else
+    {
+        pg->flags |= PC_UPTODATE;
+    }
+    io->next = pc_io_free;
+    pc_io_free = io;
+    wait_queue_wake_all(&pc_wq);
+    spin_unlock(&pc_lock);
+    local_irq_restore(flags);
+}
+
+// Block completion IRQ
+static void pc_read_done(struct blk_request *rq, int status)
+{
+    struct pc_io *io = rq->priv;
+
+    if (status)
+        io->status = status;
+    if (!atomic_add_return32(&io->pending, -1))
+        pc_io_finish(io);
+}
+
+static void pc_start_read(struct pc_io *io)
+{
+    struct pc_page *pg = io->pg;
+    struct fat_file *f = pg->file;
+    struct blk_device *bd = fat32_bdev();
+    uint64_t first = pg->index * PC_SECTORS_PER_PAGE;
+    uint64_t end = ((uint64_t)f->size + BLK_SECTOR_SIZE - 1) >> BLK_SECTOR_SHIFT;
+    uint32_t nr_rq = 0;
+    int64_t prev = -2;
+
+    for (uint64_t s = 0; s < PC_SECTORS_PER_PAGE && first + s < end; s++)
+    {
+        int64_t sector = fat32_bmap(f, first + s);
+        struct blk_request *rq;
+
+        if (sector < 0)
+        {
+            io->status = -1;
+            break;
+        }
+        if (nr_rq && sector == prev + 1)
+        {
+            io->rq[nr_rq - 1].nr_sectors++;
+        }
+        else
+        {
+            rq = &io->rq[nr_rq++];
+            rq->op = BLK_READ;
+            rq->sector = sector;
+            rq->nr_sectors = 1;
+            rq->buf = (char *)pg->data + s * BLK_SECTOR_SIZE;
+            rq->done = pc_read_done;
+            rq->priv = io;
+        }
+        prev = sector;
+    }
+
+    // One extra count held until every request is submitted
+    io->pending = nr_rq + 1;
+    for (uint32_t i = 0; i < nr_rq; i++)
+    {
+        if (blk_submit(bd, &io->rq[i]))
+        {
+            io->status = -1;
+            atomic_add_return32(&io->pending, -1);
+        }
+    }
+    if (!atomic_add_return32(&io->pending, -1))
+        pc_io_finish(io);
+}
+
+/*
+ * Insert (f, index) and start reading it. A demand read returns the page
+ * with a reference, waiting for an I/O context if all are busy; a
+ * read-ahead never sleeps and returns NULL when it cannot proceed.
+ */
+static struct pc_page *pc_add(struct fat_file *f, uint64_t index, bool demand)
+{
+    struct pc_page *pg;
+    struct pc_io *io;
+    uint64_t flags;
+    void *data;
+
+    if (page_alloc_free_pages() < PC_LOW_FREE_PAGES)
+        pagecache_shrink(PC_EVICT_BATCH);
+    data = alloc_page();
+    if (!data && (!pagecache_shrink(PC_EVICT_BATCH) || !(data = alloc_page())))
+        return NULL;
+
+    flags = local_irq_save();
+    spin_lock(&pc_lock);
+    while (!(pg = pc_lookup(f, index)))
+    {
+        if (!pc_free)
+            pc_evict_locked(PC_EVICT_BATCH);
+        if (pc_free && pc_io_free)
+            break;
+        if (!demand || !pc_free)
+        {
+            spin_unlock(&pc_lock);
+            local_irq_restore(flags);
+            free_page(data);
+            return NULL;
+        }
+        pc_wait_locked();
+    }
+    if (pg)
+    {
+        // Someone else got there first
+        if (demand)
+        {
+            pg->refs++;
+            pc_stats.hits++;
+        }
+        spin_unlock(&pc_lock);
+        local_irq_restore(flags);
+        free_page(data);
+        return pg;
+    }
+
+    pg = pc_free;
+    pc_free = pg->next;
+    io = pc_io_free;
+    pc_io_free = io->next;
+    pg->file = f;
+    pg->index = index;
+    pg->data = data;
+    pg->flags = PC_IO | PC_REFERENCED;
+    pg->refs = demand ? 1 : 0;
+    pg->nr_maps = 0;
+    pg->next = pc_hash[pc_hashfn(f, index)];
+    pc_hash[pc_hashfn(f, index)] = pg;
+    pc_nr_cached++;
+    if (demand)
+        pc_stats.misses++;
+    else
+        pc_stats.readahead++;
+    spin_unlock(&pc_lock);
+    local_irq_restore(flags);
+
+    io->pg = pg;
+    io->status = 0;
+    pc_start_read(io);
+    return pg;
+}
+
+// Returns the page up to date and referenced, or NULL past EOF / on error
+struct pc_page *pagecache_get(struct fat_file *f, uint64_t index)
+{
+    struct pc_page *pg;
+    uint64_t flags;
+    bool ok;
+
+    if (index >= pc_file_pages(f))
+        return NULL;
+
+    flags = local_irq_save();
+    spin_lock(&pc_lock);
+    pg = pc_lookup(f, index);
+    if (pg)
+    {
+        pg->refs++;
+        pg->flags |= PC_REFERENCED;
+        pc_stats.hits++;
+    }
+    spin_unlock(&pc_lock);
+    local_irq_restore(flags);
+    if (!pg && !(pg = pc_add(f, index, true)))
+        return NULL;
+
+    flags = local_irq_save();
+    spin_lock(&pc_lock);
+    while (pg->flags & PC_IO)
+        pc_wait_locked();
+    ok = pg->flags & PC_UPTODATE;
+    spin_unlock(&pc_lock);
+    local_irq_restore(flags);
+    if (!ok)
+    {
+        pagecache_put(pg);
+        return NULL;
+    }
+    return pg;
+}
+
+void pagecache_put(struct pc_page *pg)
+{
+    uint64_t flags = local_irq_save();
+
+    spin_lock(&pc_lock);
+    pg->refs--;
+    spin_unlock(&pc_lock);
+    local_irq_restore(flags);
+}
+
+// Queue reads for the uncached pages in [index, index + nr) as one
+// plugged batch, so that neighbouring pages merge into large requests
+void pagecache_readahead(struct fat_file *f, uint64_t index, uint32_t nr)
+{
+    struct blk_device *bd = fat32_bdev();
+    uint64_t end = MIN(index + nr, pc_file_pages(f));
+
+    blk_start_plug(bd);
+    for (; index < end; index++)
+    {
+        uint64_t flags = local_irq_save();
+        bool cached;
+
+        spin_lock(&pc_lock);
+        cached = pc_lookup(f, index) != NULL;
+        spin_unlock(&pc_lock);
+        local_irq_restore(flags);
+        if (!cached && !pc_add(f, index, false))
+            break;
+    }
+    blk_finish_plug(bd);
+}
+
+// Map a referenced page read-only and record the mapping for eviction
+int pagecache_map(struct pc_page *pg, struct mm *mm, vaddr_t va, int prot)
+{
+    uint64_t flags = local_irq_save();
+    int ret;
+
+    spin_lock(&pc_lock);
+    ret = mm_map_page(mm, va, (paddr_t)pg->data, prot & ~PROT_WRITE, false);
+    if (!ret)
+    {
+        if (pg->nr_maps < PC_MAX_MAPS)
+            pg->maps[pg->nr_maps] = (struct pc_map){mm, va};
+        if (pg->nr_maps <= PC_MAX_MAPS)
+            pg->nr_maps++;
+    }
+    spin_unlock(&pc_lock);
+    local_irq_restore(flags);
+    return ret;
+}
+
+// The mm is going away: drop its reverse map entries
+void pagecache_forget_mm(struct mm *mm)
+{
+    uint64_t flags = local_irq_save();
+
+    spin_lock(&pc_lock);
+    for (int i = 0; i < PC_MAX_PAGES; i++)
+    {
+        struct pc_page *pg = &pc_pages[i];
+        uint32_t n = 0;
+
+        if (!pg->file || !pg->nr_maps || pg->nr_maps > PC_MAX_MAPS)
+            continue;
+        for (uint32_t j = 0; j < pg->nr_maps; j++)
+        {
+            if (pg->maps[j].mm != mm)
+                pg->maps[n++] = pg->maps[j];
+        }
+        pg->nr_maps = n;
+    }
+    spin_unlock(&pc_lock);
+    local_irq_restore(flags);
+}
+
+void pagecache_dump(void)
+{
+    struct pc_stats *s = &pc_stats;
+
+    tiny_info("pagecache: %u/%u pages, hits %llu, misses %llu, read-ahead %llu, "
+              "evicted %llu (%llu unmapped), io errors %llu\n",
+              pc_nr_cached, PC_MAX_PAGES, s->hits, s->misses, s->readahead, s->evicted,
+              s->unmapped, s->io_errors);
+}
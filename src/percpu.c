@@ -0,0 +1,35 @@
+/*
+ * File: percpu.c
+ * Date: 2026-10-18
+ * Description: Replicates the .percpu template for every CPU at boot and
+ *              points TPIDR_EL1 at the running CPU's copy.
+ */
+
+#include "percpu.h"
+#include "tinystd.h"
+
+extern char __per_cpu_start[];
+extern char __per_cpu_end[];
+extern char __per_cpu_area[];
+
+uint64_t __per_cpu_offset[NR_CPUS] __read_mostly;
+
+// Runs on the boot CPU before any secondary is started
+void percpu_init(void)
+{
+    uint64_t size = __per_cpu_end - __per_cpu_start;
+
+    for (int cpu = 0; cpu < NR_CPUS; cpu++)
+    {
+        char *area = __per_cpu_area + cpu * size;
+        memcpy(area, __per_cpu_start, size);
+        __per_cpu_offset[cpu] = area - __per_cpu_start;
+    }
+    percpu_setup_cpu(0);
+    tiny_debug("percpu: %llu bytes x %d cpus\n", size, NR_CPUS);
+}
+
+void percpu_setup_cpu(int cpu)
+{
+    __asm__ volatile("msr tpidr_el1, %0" : : "r"(__per_cpu_offset[cpu]) : "memory");
+}
@@ -991,6 +991,322 @@ static int _vsnprintf(out_fct_type out, char *buffer, const size_t maxlen, const
     return (int)idx;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// precompiled formats
+
+int printf_compile(printf_fmt_t *fmt, const char *format)
+{
+    printf_op_t *op;
+    unsigned int n;
+
+    fmt->nr_ops = 0U;
+    fmt->nr_args = 0U;
+    while (fmt->nr_ops < PRINTF_FMT_MAX_OPS)
+    {
+        op = &fmt->ops[fmt->nr_ops++];
+        op->lit = format;
+        while (*format && (*format != '%'))
+        {
+            format++;
+        }
+        if ((size_t)(format - op->lit) > 0xffffU)
+        {
+            return -1;
+        }
+        op->lit_len = (unsigned short)(format - op->lit);
+        op->spec = 0;
+        op->base = 10U;
+        op->flags = 0U;
+        op->width = 0U;
+        op->precision = 0U;
+        if (!*format)
+        {
+            return 0;
+        }
+        format++;
+
+        // same grammar as _vsnprintf, without '*'
+        do
+        {
+            switch (*format)
+            {
+            case '0':
+                op->flags |= FLAGS_ZEROPAD;
+                n = 1U;
+                break;
+            case '-':
+                op->flags |= FLAGS_LEFT;
+                n = 1U;
+                break;
+            case '+':
+                op->flags |= FLAGS_PLUS;
+                n = 1U;
+                break;
+            case ' ':
+                op->flags |= FLAGS_SPACE;
+                n = 1U;
+                break;
+            case '#':
+                op->flags |= FLAGS_HASH;
+                n = 1U;
+                break;
+            default:
+                n = 0U;
+                break;
+            }
+            format += n;
+        } while (n);
+
+        if (_is_digit(*format))
+        {
+            op->width = _atoi(&format);
+        }
+        if (*format == '.')
+        {
+            op->flags |= FLAGS_PRECISION;
+            format++;
+            if (_is_digit(*format))
+            {
+                op->precision = _atoi(&format);
+            }
+        }
+        if (*format == '*')
+        {
+            return -1;
+        }
+
+        switch (*format)
+        {
+        case 'l':
+            op->flags |= FLAGS_LONG;
+            format++;
+            if (*format == 'l')
+            {
+                op->flags |= FLAGS_LONG_LONG;
+                format++;
+            }
+            break;
+        case 'h':
+            op->flags |= FLAGS_SHORT;
+            format++;
+            if (*format == 'h')
+            {
+                op->flags |= FLAGS_CHAR;
+                format++;
+            }
+            break;
+        case 't':
+            op->flags |= (sizeof(ptrdiff_t) == sizeof(long) ? FLAGS_LONG : FLAGS_LONG_LONG);
+            format++;
+            break;
+        case 'j':
+            op->flags |= (sizeof(intmax_t) == sizeof(long) ? FLAGS_LONG : FLAGS_LONG_LONG);
+            format++;
+            break;
+        case 'z':
+            op->flags |= (sizeof(size_t) == sizeof(long) ? FLAGS_LONG : FLAGS_LONG_LONG);
+            format++;
+            break;
+        default:
+            break;
+        }
+
+        // resolve everything _vsnprintf decides per call; integers end up as 'd' or 'u'
+        switch (*format)
+        {
+        case 'd':
+        case 'i':
+            op->spec = 'd';
+            op->flags &= ~FLAGS_HASH;
+            break;
+        case 'u':
+            op->spec = 'u';
+            op->flags &= ~(FLAGS_HASH | FLAGS_PLUS | FLAGS_SPACE);
+            break;
+        case 'X':
+            op->flags |= FLAGS_UPPERCASE;
+            // fall through
+        case 'x':
+        case 'o':
+        case 'b':
+            op->spec = 'u';
+            op->base = (*format == 'o') ? 8U : (*format == 'b') ? 2U : 16U;
+            op->flags &= ~(FLAGS_PLUS | FLAGS_SPACE);
+            break;
+        case 'p':
+            op->spec = 'u';
+            op->base = 16U;
+            op->width = sizeof(void *) * 2U;
+            op->flags |= FLAGS_ZEROPAD | FLAGS_UPPERCASE;
+            op->flags |= (sizeof(uintptr_t) == sizeof(long long) ? FLAGS_LONG_LONG : FLAGS_LONG);
+            break;
+        case 'c':
+        case 's':
+        case '%':
+            op->spec = *format;
+            break;
+        default:
+            return -1;
+        }
+        if ((op->spec == 'd' || op->spec == 'u') && (op->flags & FLAGS_PRECISION) && (*format != 'p'))
+        {
+            op->flags &= ~FLAGS_ZEROPAD;
+        }
+        if (op->spec != '%')
+        {
+            fmt->nr_args++;
+        }
+        format++;
+    }
+    return -1;
+}
+
+// next record argument, from the array when there is one
+#define _FMT_ARG(type, member) (args ? (type)(args++)->member : va_arg(*va, type))
+
+static size_t _fmt_run(out_fct_type out, char *buffer, size_t idx, const size_t maxlen, const printf_fmt_t *fmt, va_list *va, const printf_arg_t *args)
+{
+    for (unsigned int i = 0U; i < fmt->nr_ops; i++)
+    {
+        const printf_op_t *op = &fmt->ops[i];
+        const unsigned int flags = op->flags;
+        unsigned int l;
+
+        for (l = 0U; l < op->lit_len; l++)
+        {
+            out(op->lit[l], buffer, idx++, maxlen);
+        }
+
+        switch (op->spec)
+        {
+        case 'd':
+            if (flags & FLAGS_LONG_LONG)
+            {
+                const long long value = _FMT_ARG(long long, i);
+                idx = _ntoa_long_long(out, buffer, idx, maxlen, (unsigned long long)(value > 0 ? value : 0 - value), value < 0, op->base, op->precision, op->width, flags);
+            }
+            else if (flags & FLAGS_LONG)
+            {
+                const long value = _FMT_ARG(long, i);
+                idx = _ntoa_long(out, buffer, idx, maxlen, (unsigned long)(value > 0 ? value : 0 - value), value < 0, op->base, op->precision, op->width, flags);
+            }
+            else
+            {
+                int value = _FMT_ARG(int, i);
+                value = (flags & FLAGS_CHAR) ? (char)value : (flags & FLAGS_SHORT) ? (short int)value : value;
+                idx = _ntoa_long(out, buffer, idx, maxlen, (unsigned int)(value > 0 ? value : 0 - value), value < 0, op->base, op->precision, op->width, flags);
+            }
+            break;
+        case 'u':
+            if (flags & FLAGS_LONG_LONG)
+            {
+                idx = _ntoa_long_long(out, buffer, idx, maxlen, _FMT_ARG(unsigned long long, u), false, op->base, op->precision, op->width, flags);
+            }
+            else if (flags & FLAGS_LONG)
+            {
+                idx = _ntoa_long(out, buffer, idx, maxlen, _FMT_ARG(unsigned long, u), false, op->base, op->precision, op->width, flags);
+            }
+            else
+            {
+                unsigned int value = _FMT_ARG(unsigned int, u);
+                value = (flags & FLAGS_CHAR) ? (unsigned char)value : (flags & FLAGS_SHORT) ? (unsigned short int)value : value;
+                idx = _ntoa_long(out, buffer, idx, maxlen, value, false, op->base, op->precision, op->width, flags);
+            }
+            break;
+        case 'c':
+            l = 1U;
+            if (!(flags & FLAGS_LEFT))
+            {
+                while (l++ < op->width)
+                {
+                    out(' ', buffer, idx++, maxlen);
+                }
+            }
+            out((char)_FMT_ARG(int, i), buffer, idx++, maxlen);
+            if (flags & FLAGS_LEFT)
+            {
+                while (l++ < op->width)
+                {
+                    out(' ', buffer, idx++, maxlen);
+                }
+            }
+            break;
+        case 's':
+        {
+            const char *p = _FMT_ARG(const char *, s);
+            unsigned int precision = op->precision;
+            l = _strnlen_s(p, precision ? precision : (size_t)-1);
+            if (flags & FLAGS_PRECISION)
+            {
+                l = (l < precision ? l : precision);
+            }
+            if (!(flags & FLAGS_LEFT))
+            {
+                while (l++ < op->width)
+                {
+                    out(' ', buffer, idx++, maxlen);
+                }
+            }
+            while ((*p != 0) && (!(flags & FLAGS_PRECISION) || precision--))
+            {
+                out(*(p++), buffer, idx++, maxlen);
+            }
+            if (flags & FLAGS_LEFT)
+            {
+                while (l++ < op->width)
+                {
+                    out(' ', buffer, idx++, maxlen);
+                }
+            }
+            break;
+        }
+        case '%':
+            out('%', buffer, idx++, maxlen);
+            break;
+        default:
+            break;
+        }
+    }
+    return idx;
+}
+
+#undef _FMT_ARG
+
+int vsnprintf_fmt(char *buffer, size_t count, const printf_fmt_t *fmt, va_list va)
+{
+    const out_fct_type out = buffer ? _out_buffer : _out_null;
+    va_list ap;
+    size_t idx;
+
+    va_copy(ap, va);
+    idx = _fmt_run(out, buffer, 0U, count, fmt, &ap, NULL);
+    va_end(ap);
+    out((char)0, buffer, idx < count ? idx : count - 1U, count);
+    return (int)idx;
+}
+
+int snprintf_fmt(char *buffer, size_t count, const printf_fmt_t *fmt, ...)
+{
+    va_list va;
+    va_start(va, fmt);
+    const int ret = vsnprintf_fmt(buffer, count, fmt, va);
+    va_end(va);
+    return ret;
+}
+
+int snprintf_fmtv(char *buffer, size_t count, const printf_fmt_t *fmt, const printf_arg_t *args, size_t nr)
+{
+    const out_fct_type out = buffer ? _out_buffer : _out_null;
+    size_t idx = 0U;
+
+    for (size_t r = 0U; r < nr; r++)
+    {
+        idx = _fmt_run(out, buffer, idx, count, fmt, NULL, args + r * fmt->nr_args);
+    }
+    out((char)0, buffer, idx < count ? idx : count - 1U, count);
+    return (int)idx;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 int printf_(const char *format, ...)
@@ -0,0 +1,149 @@
+/*
+ * File: rcu.c
+ * Date: 2026-10-18
+ * Description: Quiescent-state based RCU: per-CPU quiescent-state
+ *              reports, grace-period waits and a kthread that runs
+ *              call_rcu() callbacks in batches.
+ */
+
+#include "rcu.h"
+#include "irq.h"
+#include "percpu.h"
+#include "sched.h"
+#include "smp.h"
+#include "spin_lock.h"
+#include "stats.h"
+#include "timer.h"
+#include "tinystd.h"
+
+#define RCU_POLL_NS (20 * NSEC_PER_USEC) // grace-period poll interval of a sleeping waiter
+
+struct rcu_data
+{
+    volatile uint64_t qs_seq; // last grace period this CPU has passed through
+    volatile uint64_t idle;   // in the idle loop's wfi: quiescent throughout
+};
+
+static DEFINE_PER_CPU_ALIGNED(struct rcu_data, rcu_data);
+static volatile uint64_t rcu_gp_seq __cacheline_aligned;
+
+// call_rcu queue, drained by the rcu kthread
+static spinlock_t rcu_cb_lock;
+static struct rcu_head *rcu_cb_head;
+static struct rcu_head **rcu_cb_tail = &rcu_cb_head;
+static struct wait_queue rcu_cb_wq;
+
+DEFINE_STAT(rcu_grace_periods, "RCU grace periods completed");
+DEFINE_STAT(rcu_callbacks, "call_rcu callbacks run");
+
+// Cheap when no grace period is pending: one load and a compare
+void rcu_quiescent_state(void)
+{
+    struct rcu_data *rd = this_cpu_ptr(&rcu_data);
+    uint64_t gp = READ_ONCE(rcu_gp_seq);
+
+    if (rd->qs_seq == gp)
+        return;
+    smp_mb(); // the reads of any earlier reader complete before the report
+    WRITE_ONCE(rd->qs_seq, gp);
+}
+
+void rcu_idle_enter(void)
+{
+    rcu_quiescent_state();
+    WRITE_ONCE(this_cpu_ptr(&rcu_data)->idle, 1);
+    smp_mb();
+}
+
+void rcu_idle_exit(void)
+{
+    WRITE_ONCE(this_cpu_ptr(&rcu_data)->idle, 0);
+    smp_mb(); // readers after this point are seen by the next grace period
+}
+
+static bool rcu_cpu_passed(int cpu, uint64_t gp)
+{
+    struct rcu_data *rd = per_cpu_ptr(&rcu_data, cpu);
+
+    return READ_ONCE(rd->idle) || (int64_t)(READ_ONCE(rd->qs_seq) - gp) >= 0;
+}
+
+// Must not be called from inside a read-side section or with IRQs masked
+void synchronize_rcu(void)
+{
+    uint64_t gp;
+    int self;
+
+    smp_mb(); // removals before the grace period starts
+    gp = atomic_add_return(&rcu_gp_seq, 1);
+    rcu_quiescent_state();
+    self = smp_processor_id();
+
+    for (int cpu = 0; cpu < NR_CPUS; cpu++)
+    {
+        if (cpu == self || !cpu_online(cpu))
+            continue;
+        while (!rcu_cpu_passed(cpu, gp))
+        {
+            // The idle task cannot sleep; a task sleeping is itself quiescent
+            if (current->pid == 0)
+                cpu_relax();
+            else
+                task_sleep_ns(RCU_POLL_NS);
+        }
+    }
+    smp_mb(); // frees after every reader of the old version is gone
+    stat_inc(rcu_grace_periods);
+}
+
+// Safe from IRQ context; fn runs in the rcu kthread after a grace period
+void call_rcu(struct rcu_head *head, void (*fn)(struct rcu_head *head))
+{
+    uint64_t flags;
+
+    head->fn = fn;
+    head->next = NULL;
+    flags = local_irq_save();
+    spin_lock(&rcu_cb_lock);
+    *rcu_cb_tail = head;
+    rcu_cb_tail = &head->next;
+    wait_queue_wake_all(&rcu_cb_wq);
+    spin_unlock(&rcu_cb_lock);
+    local_irq_restore(flags);
+}
+
+static void rcu_thread(void *arg)
+{
+    while (1)
+    {
+        struct rcu_head *list;
+        uint64_t flags = local_irq_save();
+
+        spin_lock(&rcu_cb_lock);
+        while (!rcu_cb_head)
+            wait_queue_sleep(&rcu_cb_wq, &rcu_cb_lock);
+        list = rcu_cb_head;
+        rcu_cb_head = NULL;
+        rcu_cb_tail = &rcu_cb_head;
+        spin_unlock(&rcu_cb_lock);
+        local_irq_restore(flags);
+
+        // One grace period covers the whole batch
+        synchronize_rcu();
+        while (list)
+        {
+            struct rcu_head *next = list->next;
+
+            list->fn(list);
+            stat_inc(rcu_callbacks);
+            list = next;
+        }
+    }
+}
+
+void rcu_init(void)
+{
+    spinlock_init(&rcu_cb_lock);
+    if (!kthread_create("rcu", rcu_thread, NULL, 0, PRIO_NORMAL))
+        tiny_error("rcu: cannot start the callback thread\n");
+}
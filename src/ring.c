@@ -0,0 +1,86 @@
+/*
+ * File: ring.c
+ * Date: 2026-10-18
+ * Description: Ring setup and the doorbell slow path. The enqueue and
+ *              dequeue fast paths are inline in ring.h.
+ */
+
+#include "ring.h"
+#include "irq.h"
+#include "page_alloc.h"
+#include "tinystd.h"
+
+int ring_init(struct ring *r, uint32_t count, uint32_t flags)
+{
+    if (count < 2 || (count & (count - 1)))
+        return -1;
+
+    memset(r, 0, sizeof(*r));
+    r->size = count;
+    r->mask = count - 1;
+    r->flags = flags;
+    spinlock_init(&r->wait_lock);
+    return 0;
+}
+
+struct ring *ring_create(uint32_t count, uint32_t flags)
+{
+    uint32_t order = 0;
+    struct ring *r;
+
+    while ((PAGE_SIZE << order) < RING_BYTES(count))
+        order++;
+    if (order > MAX_ORDER - 1)
+        return NULL;
+
+    r = alloc_pages(order);
+    if (!r)
+        return NULL;
+    if (ring_init(r, count, flags))
+    {
+        free_pages(r, order);
+        return NULL;
+    }
+    return r;
+}
+
+void ring_destroy(struct ring *r)
+{
+    uint32_t order = 0;
+
+    while ((PAGE_SIZE << order) < RING_BYTES(r->size))
+        order++;
+    free_pages(r, order);
+}
+
+// Producers may ring from IRQ context, so the wait lock is IRQ-safe
+void ring_doorbell(struct ring *r)
+{
+    uint64_t flags = local_irq_save();
+
+    spin_lock(&r->wait_lock);
+    wait_queue_wake_all(&r->wq);
+    spin_unlock(&r->wait_lock);
+    local_irq_restore(flags);
+}
+
+// Blocking dequeue for RING_F_DOORBELL rings: returns at least one object
+uint32_t ring_dequeue_wait(struct ring *r, uint64_t *objs, uint32_t n)
+{
+    uint32_t got;
+
+    while (!(got = ring_dequeue_burst(r, objs, n)))
+    {
+        uint64_t flags = local_irq_save();
+
+        spin_lock(&r->wait_lock);
+        r->waiters++;
+        smp_mb();
+        if (!ring_count(r))
+            wait_queue_sleep(&r->wq, &r->wait_lock);
+        r->waiters--;
+        spin_unlock(&r->wait_lock);
+        local_irq_restore(flags);
+    }
+    return got;
+}
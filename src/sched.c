@@ -0,0 +1,444 @@
+/*
+ * File: sched.c
+ * Date: 2026-10-18
+ * Description: Per-CPU priority run queues, kernel threads and EL0 tasks.
+ *              The kernel is not preemptible: kernel threads give up the
+ *              CPU at schedule()/cond_resched(), while EL0 tasks are also
+ *              preempted on the way back to user mode after an IRQ.
+ */
+
+#include "sched.h"
+#include "atomic.h"
+#include "exception.h"
+#include "idle.h"
+#include "ipi.h"
+#include "irq.h"
+#include "mmap.h"
+#include "page_alloc.h"
+#include "rcu.h"
+#include "smp.h"
+#include "stats.h"
+#include "syscall.h"
+#include "tinystd.h"
+#include "trace.h"
+
+DEFINE_PER_CPU(struct run_queue, runqueue);
+STAT_REGISTER(context_switches, "task switches", &runqueue.nr_switches);
+static DEFINE_PER_CPU(struct task, idle_task);
+
+static struct task *task_table[MAX_TASKS];
+static spinlock_t task_table_lock;
+static int last_pid;
+
+volatile uint64_t nr_user_tasks;
+
+extern struct task *cpu_switch_to(struct task *prev, struct task *next);
+extern void ret_from_fork(void);
+
+// EL0 image placed by link.lds: linked at USER_TEXT_BASE, loaded inside
+// the kernel image right after the kernel data
+extern char __user_text_lma[], __user_data_lma[], __user_image_end[];
+
+// Run queue helpers, rq->lock held with IRQs masked
+static void rq_enqueue(struct run_queue *rq, struct task *t)
+{
+    t->rq_next = NULL;
+    if (rq->tail[t->prio])
+        rq->tail[t->prio]->rq_next = t;
+    else
+        rq->head[t->prio] = t;
+    rq->tail[t->prio] = t;
+    t->on_rq = true;
+}
+
+static struct task *rq_pick(struct run_queue *rq)
+{
+    for (int prio = 0; prio < NR_PRIO; prio++)
+    {
+        struct task *t = rq->head[prio];
+        if (!t)
+            continue;
+        rq->head[prio] = t->rq_next;
+        if (!rq->head[prio])
+            rq->tail[prio] = NULL;
+        t->on_rq = false;
+        return t;
+    }
+    return rq->idle;
+}
+
+static bool rq_has_work(struct run_queue *rq)
+{
+    for (int prio = 0; prio < NR_PRIO; prio++)
+    {
+        if (READ_ONCE(rq->head[prio]))
+            return true;
+    }
+    return false;
+}
+
+void sched_init_cpu(void)
+{
+    struct run_queue *rq = this_cpu_ptr(&runqueue);
+    struct task *idle = this_cpu_ptr(&idle_task);
+    int cpu = smp_processor_id();
+
+    spinlock_init(&rq->lock);
+    idle->pid = 0;
+    idle->cpu = cpu;
+    idle->state = TASK_RUNNING;
+    idle->prio = NR_PRIO;
+    snprintf(idle->name, TASK_NAME_LEN, "idle/%d", cpu);
+    rq->idle = idle;
+    rq->curr = idle;
+}
+
+static void task_free(struct task *t)
+{
+    if (t->mm)
+    {
+        mmap_teardown(t->mm);
+        mm_destroy(t->mm);
+    }
+    free_pages(t, TASK_STACK_ORDER);
+}
+
+// First thing a task runs after cpu_switch_to, with IRQs still masked
+void schedule_tail(struct task *prev)
+{
+    if (prev->state == TASK_DEAD)
+        task_free(prev);
+}
+
+void schedule(void)
+{
+    uint64_t flags = local_irq_save();
+    struct run_queue *rq = this_cpu_ptr(&runqueue);
+    struct task *prev = rq->curr;
+    struct task *next;
+
+    rcu_quiescent_state(); // readers never sleep, so none is running here
+    spin_lock(&rq->lock);
+    rq->need_resched = false;
+    if (prev != rq->idle && prev->state == TASK_RUNNING && !prev->on_rq)
+        rq_enqueue(rq, prev);
+    next = rq_pick(rq);
+    if (next == prev)
+    {
+        spin_unlock(&rq->lock);
+        local_irq_restore(flags);
+        return;
+    }
+    rq->curr = next;
+    rq->nr_switches++;
+    spin_unlock(&rq->lock);
+    trace_event(TRACE_SWITCH, prev->pid, next->pid);
+
+    if (next->mm)
+        mm_switch(next->mm);
+    else if (prev->mm)
+        mm_switch_kernel();
+
+    prev = cpu_switch_to(prev, next);
+    schedule_tail(prev);
+    local_irq_restore(flags);
+}
+
+// Also a quiescent state: a poll loop calling only this, on a CPU with
+// nothing else to run, would otherwise hold up every grace period
+void cond_resched(void)
+{
+    rcu_quiescent_state();
+    if (this_cpu_ptr(&runqueue)->need_resched)
+        schedule();
+}
+
+// IRQ exit towards EL0: the only involuntary preemption point
+void sched_preempt_user(void)
+{
+    struct run_queue *rq = this_cpu_ptr(&runqueue);
+
+    rcu_quiescent_state();
+    if (rq->curr && rq->need_resched)
+        schedule();
+}
+
+void sched_set_need_resched(void)
+{
+    this_cpu_ptr(&runqueue)->need_resched = true;
+}
+
+// Timer IRQ: round-robin within a level once something else is runnable
+void sched_tick_handler(void)
+{
+    struct run_queue *rq = this_cpu_ptr(&runqueue);
+
+    if (rq_has_work(rq))
+        rq->need_resched = true;
+}
+
+void wake_up_task(struct task *t)
+{
+    struct run_queue *rq = per_cpu_ptr(&runqueue, t->cpu);
+    uint64_t flags = local_irq_save();
+    bool kick = false;
+
+    spin_lock(&rq->lock);
+    if (t->state == TASK_BLOCKED)
+    {
+        t->state = TASK_RUNNING;
+        // Still current on its CPU: it has not switched out yet, and
+        // schedule() will requeue it instead of blocking
+        if (!t->on_rq && rq->curr != t)
+        {
+            rq_enqueue(rq, t);
+            kick = true;
+        }
+    }
+    spin_unlock(&rq->lock);
+
+    if (kick)
+    {
+        idle_note_wake(t->cpu, read_cntvct());
+        if (t->cpu == smp_processor_id())
+            rq->need_resched = true;
+        else
+        {
+            // A polling idle CPU notices need_resched by itself
+            rq->need_resched = true;
+            if (!idle_wake_polling(t->cpu))
+                smp_send_reschedule(t->cpu);
+        }
+    }
+    local_irq_restore(flags);
+}
+
+static void sleep_timeout(struct timer_event *ev)
+{
+    struct task *t = ev->data;
+
+    idle_note_wake(t->cpu, ev->deadline);
+    wake_up_task(t);
+}
+
+void task_sleep_ns(uint64_t ns)
+{
+    struct task *t = current;
+    uint64_t flags = local_irq_save();
+
+    t->sleep_timer.fn = sleep_timeout;
+    t->sleep_timer.data = t;
+    t->state = TASK_BLOCKED;
+    timer_add(&t->sleep_timer, read_cntvct() + ns_to_ticks(ns));
+    schedule();
+    local_irq_restore(flags);
+}
+
+void wait_queue_sleep(struct wait_queue *wq, spinlock_t *lock)
+{
+    struct task *t = current;
+
+    t->state = TASK_BLOCKED;
+    t->wq_next = wq->head;
+    wq->head = t;
+    spin_unlock(lock);
+    schedule();
+    spin_lock(lock);
+}
+
+// Caller holds the lock that protects wq
+void wait_queue_wake_all(struct wait_queue *wq)
+{
+    struct task *t = wq->head;
+
+    wq->head = NULL;
+    while (t)
+    {
+        struct task *next = t->wq_next;
+        t->wq_next = NULL;
+        wake_up_task(t);
+        t = next;
+    }
+}
+
+void task_exit(int code)
+{
+    struct task *t = current;
+
+    local_irq_disable();
+    t->exit_code = code;
+    if (t->mm)
+        atomic_add_return(&nr_user_tasks, (uint64_t)-1);
+
+    mailbox_close(t->pid);
+    spin_lock(&task_table_lock);
+    task_table[task_slot(t->pid)] = NULL;
+    spin_unlock(&task_table_lock);
+
+    tiny_debug("task %d (%s) exited with %d\n", t->pid, t->name, code);
+    t->state = TASK_DEAD;
+    schedule();
+    panic("dead task %d scheduled again\n", t->pid);
+}
+
+static struct task *task_alloc(const char *name, int cpu, enum task_prio prio)
+{
+    struct task *t = alloc_zeroed_pages(TASK_STACK_ORDER);
+    int pid = -1;
+
+    if (!t)
+        return NULL;
+
+    spin_lock(&task_table_lock);
+    for (int i = 0; i < MAX_TASKS; i++)
+    {
+        int cand = ++last_pid;
+        if (task_slot(cand) == 0) // slot 0 stays with the idle tasks
+            cand = ++last_pid;
+        if (!task_table[task_slot(cand)])
+        {
+            pid = cand;
+            task_table[task_slot(pid)] = t;
+            break;
+        }
+    }
+    spin_unlock(&task_table_lock);
+    if (pid < 0)
+    {
+        free_pages(t, TASK_STACK_ORDER);
+        return NULL;
+    }
+
+    t->pid = pid;
+    t->cpu = cpu_online(cpu) ? cpu : smp_processor_id();
+    t->state = TASK_RUNNING;
+    t->prio = prio;
+    t->ctx.pc = (uint64_t)ret_from_fork;
+    snprintf(t->name, TASK_NAME_LEN, "%s", name);
+    mailbox_open(pid);
+    return t;
+}
+
+static void task_start(struct task *t)
+{
+    t->state = TASK_BLOCKED;
+    wake_up_task(t);
+}
+
+struct task *kthread_create(const char *name, kthread_fn_t fn, void *arg, int cpu,
+                            enum task_prio prio)
+{
+    struct task *t = task_alloc(name, cpu, prio);
+
+    if (!t)
+        return NULL;
+    t->ctx.x19 = (uint64_t)fn;
+    t->ctx.x20 = (uint64_t)arg;
+    t->ctx.sp = (uint64_t)t + TASK_STACK_SIZE;
+    task_start(t);
+    return t;
+}
+
+// Text is shared with the kernel image read-only, data gets a private copy
+static struct mm *user_mm_create(void)
+{
+    uint64_t text_size = __user_data_lma - __user_text_lma;
+    uint64_t data_size = __user_image_end - __user_data_lma;
+    struct mm *mm = mm_create();
+    vaddr_t va;
+
+    if (!mm)
+        return NULL;
+
+    for (uint64_t off = 0; off < text_size; off += PAGE_SIZE)
+    {
+        if (mm_map_page(mm, USER_TEXT_BASE + off, (paddr_t)__user_text_lma + off,
+                        PROT_READ | PROT_EXEC, false))
+            goto fail;
+    }
+    for (uint64_t off = 0; off < data_size; off += PAGE_SIZE)
+    {
+        void *page = alloc_page();
+        if (!page)
+            goto fail;
+        memcpy(page, __user_data_lma + off, PAGE_SIZE);
+        if (mm_map_page(mm, USER_TEXT_BASE + text_size + off, (paddr_t)page,
+                        PROT_READ | PROT_WRITE, true))
+        {
+            free_page(page);
+            goto fail;
+        }
+    }
+    for (va = USER_STACK_TOP - USER_STACK_PAGES * PAGE_SIZE; va < USER_STACK_TOP;
+         va += PAGE_SIZE)
+    {
+        void *page = alloc_zeroed_pages(0);
+        if (!page)
+            goto fail;
+        if (mm_map_page(mm, va, (paddr_t)page, PROT_READ | PROT_WRITE, true))
+        {
+            free_page(page);
+            goto fail;
+        }
+    }
+    return mm;
+
+fail:
+    mm_destroy(mm);
+    return NULL;
+}
+
+/*
+ * The first switch lands in ret_from_fork with x19 == 0, which erets
+ * through the trap frame built at the top of the kernel stack. `lr` is
+ * where the entry function returns to, normally a stub doing SYS_EXIT.
+ */
+struct task *task_create_user(const char *name, uint64_t entry, uint64_t arg,
+                              uint64_t lr, int cpu)
+{
+    struct task *t = task_alloc(name, cpu, PRIO_NORMAL);
+    struct trap_frame *frame;
+
+    if (!t)
+        return NULL;
+    t->mm = user_mm_create();
+    if (!t->mm)
+    {
+        spin_lock(&task_table_lock);
+        task_table[task_slot(t->pid)] = NULL;
+        spin_unlock(&task_table_lock);
+        free_pages(t, TASK_STACK_ORDER);
+        return NULL;
+    }
+
+    frame = (struct trap_frame *)((uint64_t)t + TASK_STACK_SIZE - sizeof(*frame));
+    frame->regs[0] = arg;
+    frame->regs[30] = lr;
+    frame->sp_el0 = USER_STACK_TOP;
+    frame->elr = entry;
+    frame->spsr = 0; // EL0t, interrupts unmasked
+    t->ctx.sp = (uint64_t)frame;
+
+    atomic_add_return(&nr_user_tasks, 1);
+    task_start(t);
+    return t;
+}
+
+bool sched_cpu_has_work(void)
+{
+    struct run_queue *rq = this_cpu_ptr(&runqueue);
+
+    return rq->need_resched || rq_has_work(rq);
+}
+
+// The idle governor decides between polling and wfi (idle.c)
+void cpu_idle_once(void)
+{
+    if (!sched_cpu_has_work())
+        idle_enter();
+    if (sched_cpu_has_work())
+    {
+        idle_exit();
+        schedule();
+    }
+}
@@ -0,0 +1,234 @@
+/*
+ * File: shell.c
+ * Date: 2026-10-18
+ * Description: Interactive UART console. The PL011 RX IRQ feeds an SPSC
+ *              ring; a low-priority kernel thread edits the line and runs
+ *              the commands registered in the .shell_cmds section.
+ */
+
+#include "shell.h"
+#include "blk.h"
+#include "fdt.h"
+#include "gic.h"
+#include "irq.h"
+#include "lockprof.h"
+#include "pagecache.h"
+#include "ring.h"
+#include "sched.h"
+#include "tinystd.h"
+#include "virtio_net.h"
+
+#define SHELL_PROMPT "tiny> "
+
+#define CTRL_C 0x03
+#define CTRL_U 0x15
+#define KEY_BS 0x08
+#define KEY_DEL 0x7f
+#define KEY_ESC 0x1b
+
+extern const struct shell_cmd __shell_cmds_start[];
+extern const struct shell_cmd __shell_cmds_end[];
+
+static struct ring *shell_rx;
+static uint64_t shell_rx_dropped;
+static volatile bool shell_halt;
+
+// UART IRQ: drain the FIFO into the ring, the doorbell wakes the thread
+static void shell_rx_irq(uint32_t irq, void *arg)
+{
+    int c;
+
+    while ((c = uart_getc()) >= 0)
+    {
+        if (!ring_enqueue(shell_rx, (uint64_t)c))
+            shell_rx_dropped++;
+    }
+    uart_rx_irq_ack();
+}
+
+static void shell_puts(const char *s)
+{
+    uart_write(s, strlen(s));
+}
+
+static int shell_split(char *line, char **argv)
+{
+    int argc = 0;
+
+    while (*line && argc < SHELL_MAX_ARGS)
+    {
+        while (*line == ' ' || *line == '\t')
+            *line++ = '\0';
+        if (!*line)
+            break;
+        argv[argc++] = line;
+        while (*line && *line != ' ' && *line != '\t')
+            line++;
+    }
+    return argc;
+}
+
+static void shell_exec(char *line)
+{
+    char *argv[SHELL_MAX_ARGS];
+    int argc = shell_split(line, argv);
+
+    if (!argc)
+        return;
+    for (const struct shell_cmd *cmd = __shell_cmds_start; cmd < __shell_cmds_end; cmd++)
+    {
+        if (!strcmp(cmd->name, argv[0]))
+        {
+            int ret = cmd->fn(argc, argv);
+            if (ret)
+                printf("%s: failed (%d)\n", argv[0], ret);
+            return;
+        }
+    }
+    printf("%s: unknown command, try 'help'\n", argv[0]);
+}
+
+static void shell_thread(void *arg)
+{
+    char line[SHELL_LINE_MAX];
+    uint32_t len = 0;
+    int esc = 0;
+    uint64_t c;
+
+    shell_puts("\n" SHELL_PROMPT);
+    while (1)
+    {
+        ring_dequeue_wait(shell_rx, &c, 1);
+
+        // Swallow escape sequences (arrow keys and friends)
+        if (esc)
+        {
+            if (esc == 1 && c == '[')
+                esc = 2;
+            else if (esc == 1 || (c >= 0x40 && c <= 0x7e))
+                esc = 0;
+            continue;
+        }
+
+        switch (c)
+        {
+        case '\r':
+        case '\n':
+            shell_puts("\n");
+            line[len] = '\0';
+            shell_exec(line);
+            len = 0;
+            shell_puts(SHELL_PROMPT);
+            break;
+        case KEY_BS:
+        case KEY_DEL:
+            if (len)
+            {
+                len--;
+                shell_puts("\b \b");
+            }
+            break;
+        case CTRL_U:
+            while (len)
+            {
+                len--;
+                shell_puts("\b \b");
+            }
+            break;
+        case CTRL_C:
+            len = 0;
+            shell_puts("^C\n" SHELL_PROMPT);
+            break;
+        case KEY_ESC:
+            esc = 1;
+            break;
+        default:
+            if (c >= ' ' && c < KEY_DEL && len < SHELL_LINE_MAX - 1)
+            {
+                char ch = (char)c;
+                line[len++] = ch;
+                uart_write(&ch, 1);
+            }
+            break;
+        }
+        cond_resched();
+    }
+}
+
+int shell_init(int cpu)
+{
+    shell_rx = ring_create(SHELL_RX_RING, RING_F_SPSC | RING_F_DOORBELL);
+    if (!shell_rx)
+        return -1;
+    if (!kthread_create("shell", shell_thread, NULL, cpu, PRIO_LOW))
+        return -1;
+    irq_register(dev_table.uart_irq, shell_rx_irq, NULL);
+    uart_rx_irq_enable();
+    gic_enable_irq(dev_table.uart_irq);
+    tiny_info("shell: console on irq %u, %u command(s)\n", dev_table.uart_irq,
+              (uint32_t)(__shell_cmds_end - __shell_cmds_start));
+    return 0;
+}
+
+bool shell_halt_requested(void)
+{
+    return READ_ONCE(shell_halt);
+}
+
+static int cmd_help(int argc, char **argv)
+{
+    for (const struct shell_cmd *cmd = __shell_cmds_start; cmd < __shell_cmds_end; cmd++)
+        printf("  %-10s %s\n", cmd->name, cmd->help);
+    if (shell_rx_dropped)
+        printf("  (%llu input bytes dropped)\n", shell_rx_dropped);
+    return 0;
+}
+SHELL_CMD(help, "list commands", cmd_help);
+
+// loglevel [module] <level>: no module means all of them
+static int cmd_loglevel(int argc, char **argv)
+{
+    const char *module = argc > 2 ? argv[1] : NULL;
+    int level;
+
+    if (argc < 2)
+    {
+        printf("loglevel: built with %s\n", log_level_name(LOG_LEVEL));
+        log_dump_levels();
+        return 0;
+    }
+    level = log_level_parse(argv[argc > 2 ? 2 : 1]);
+    if (level < 0)
+    {
+        printf("usage: loglevel [module] [none|error|warn|info|debug|all]\n");
+        return -1;
+    }
+    if (level > LOG_LEVEL)
+        printf("loglevel: %s is compiled out, capped at %s\n", log_level_name(level),
+               log_level_name(LOG_LEVEL));
+    if (!log_set_level(module, level))
+    {
+        printf("loglevel: no module '%s'\n", module);
+        return -1;
+    }
+    return 0;
+}
+SHELL_CMD(loglevel, "show or set log levels: loglevel [module] <level>", cmd_loglevel);
+
+static int cmd_perf(int argc, char **argv)
+{
+    net_dump();
+    for (int i = 0; blk_get(i); i++)
+        blk_dump(blk_get(i));
+    pagecache_dump();
+    lockprof_report(LOCKPROF_TOP_N);
+    return 0;
+}
+SHELL_CMD(perf, "device, cache and lock contention statistics", cmd_perf);
+
+static int cmd_halt(int argc, char **argv)
+{
+    WRITE_ONCE(shell_halt, true);
+    return 0;
+}
+SHELL_CMD(halt, "shut down once the user tasks are done", cmd_halt);
@@ -0,0 +1,96 @@
+/*
+ * File: smp.c
+ * Date: 2026-10-18
+ * Description: Secondary CPU bring-up through PSCI CPU_ON. Secondaries
+ *              enter at secondary_entry (startup.S), reuse the boot page
+ *              table and their own boot stack, then land in secondary_main.
+ */
+
+#include "smp.h"
+#include "atomic.h"
+#include "fdt.h"
+#include "gic.h"
+#include "irq.h"
+#include "percpu.h"
+#include "sched.h"
+#include "timer.h"
+#include "tinystd.h"
+
+#define SMP_BOOT_TIMEOUT_NS (100 * 1000 * 1000ULL)
+
+volatile uint64_t cpu_online_mask __read_mostly;
+
+extern char secondary_entry[];
+
+static int64_t psci_call(uint64_t fn, uint64_t arg0, uint64_t arg1, uint64_t arg2)
+{
+    register uint64_t x0 __asm__("x0") = fn;
+    register uint64_t x1 __asm__("x1") = arg0;
+    register uint64_t x2 __asm__("x2") = arg1;
+    register uint64_t x3 __asm__("x3") = arg2;
+
+    if (dev_table.psci_hvc)
+        __asm__ volatile("hvc #0" : "+r"(x0) : "r"(x1), "r"(x2), "r"(x3) : "memory");
+    else
+        __asm__ volatile("smc #0" : "+r"(x0) : "r"(x1), "r"(x2), "r"(x3) : "memory");
+    return (int64_t)x0;
+}
+
+// No popcount: without FP/SIMD registers gcc would call into libgcc
+int num_online_cpus(void)
+{
+    uint64_t mask = cpu_online_mask;
+    int n = 0;
+
+    for (; mask; mask &= mask - 1)
+        n++;
+    return n;
+}
+
+int smp_init(void)
+{
+    uint32_t ncpus = MIN(dev_table.nr_cpus, (uint32_t)NR_CPUS);
+    uint64_t wanted = 1;
+    uint64_t deadline;
+
+    atomic_or(&cpu_online_mask, 1UL << smp_processor_id());
+
+    for (uint32_t cpu = 1; cpu < ncpus; cpu++)
+    {
+        int64_t ret = psci_call(PSCI_CPU_ON_64, cpu, (uint64_t)secondary_entry, cpu);
+        if (ret != 0)
+        {
+            tiny_warn("smp: CPU_ON for cpu%u failed (%lld)\n", cpu, ret);
+            continue;
+        }
+        wanted |= 1UL << cpu;
+    }
+
+    deadline = read_cntvct() + ns_to_ticks(SMP_BOOT_TIMEOUT_NS);
+    while ((atomic_load_acquire(&cpu_online_mask) & wanted) != wanted)
+    {
+        if (read_cntvct() > deadline)
+        {
+            tiny_warn("smp: timed out waiting for cpus, online mask 0x%llx\n",
+                      cpu_online_mask);
+            break;
+        }
+        cpu_relax();
+    }
+
+    tiny_info("smp: %d of %u cpu(s) online\n", num_online_cpus(), ncpus);
+    return num_online_cpus();
+}
+
+void secondary_main(uint64_t cpu)
+{
+    percpu_setup_cpu(cpu);
+    gic_cpu_init();
+    sched_init_cpu();
+    timer_init_cpu();
+    atomic_or(&cpu_online_mask, 1UL << cpu);
+    local_irq_enable();
+
+    while (1)
+        cpu_idle_once();
+}
@@ -9,3 +9,5 @@
 
 #include "spin_lock.h"
 
+DEFINE_PER_CPU(uint32_t, spin_lock_depth);
+
@@ -0,0 +1,127 @@
+/*
+ * File: stats.c
+ * Date: 2026-10-18
+ * Description: Reader side of the per-CPU counters: summing, lookup and
+ *              the human-readable / JSON dumps, on demand or from a
+ *              low-priority kernel thread at a fixed period.
+ */
+
+#include "stats.h"
+#include "atomic.h"
+#include "sched.h"
+#include "shell.h"
+#include "smp.h"
+#include "timer.h"
+#include "tinystd.h"
+
+extern const struct stat_desc __stats_start[];
+extern const struct stat_desc __stats_end[];
+
+static uint64_t stats_period_ns;
+static enum stats_format stats_periodic_fmt;
+
+uint64_t stat_read(const struct stat_desc *sd)
+{
+    uint64_t sum = 0;
+
+    for (int cpu = 0; cpu < NR_CPUS; cpu++)
+    {
+        if (cpu_online(cpu))
+            sum += READ_ONCE(*per_cpu_ptr(sd->pcpu, cpu));
+    }
+    return sum;
+}
+
+const struct stat_desc *stat_find(const char *name)
+{
+    for (const struct stat_desc *sd = __stats_start; sd < __stats_end; sd++)
+    {
+        if (!strcmp(sd->name, name))
+            return sd;
+    }
+    return NULL;
+}
+
+static void stats_dump_human(void)
+{
+    int ncpus = num_online_cpus();
+
+    tiny_info("stats: %u counters, %d cpu(s)\n", (uint32_t)(__stats_end - __stats_start), ncpus);
+    for (const struct stat_desc *sd = __stats_start; sd < __stats_end; sd++)
+    {
+        printf("  %-20s %12llu ", sd->name, stat_read(sd));
+        for (int cpu = 0; cpu < NR_CPUS; cpu++)
+        {
+            if (cpu_online(cpu))
+                printf(" %llu", READ_ONCE(*per_cpu_ptr(sd->pcpu, cpu)));
+        }
+        printf("  (%s)\n", sd->desc);
+    }
+}
+
+// One line per dump, so a host script can pick them out of the log
+static void stats_dump_json(void)
+{
+    printf("{\"type\":\"stats\",\"ns\":%llu,\"counters\":{", ticks_to_ns(read_cntvct()));
+    for (const struct stat_desc *sd = __stats_start; sd < __stats_end; sd++)
+    {
+        bool first = true;
+
+        printf("%s\"%s\":{\"total\":%llu,\"cpu\":[", sd == __stats_start ? "" : ",", sd->name,
+               stat_read(sd));
+        for (int cpu = 0; cpu < NR_CPUS; cpu++)
+        {
+            if (!cpu_online(cpu))
+                continue;
+            printf("%s%llu", first ? "" : ",", READ_ONCE(*per_cpu_ptr(sd->pcpu, cpu)));
+            first = false;
+        }
+        printf("]}");
+    }
+    printf("}}\n");
+}
+
+void stats_dump(enum stats_format fmt)
+{
+    if (fmt == STATS_JSON)
+        stats_dump_json();
+    else
+        stats_dump_human();
+}
+
+static void stats_thread(void *arg)
+{
+    while (1)
+    {
+        task_sleep_ns(READ_ONCE(stats_period_ns));
+        stats_dump(stats_periodic_fmt);
+    }
+}
+
+// Starts the dump thread on first use; later calls only change the period
+int stats_start_periodic(uint64_t period_ms, enum stats_format fmt)
+{
+    bool running = stats_period_ns != 0;
+
+    if (!period_ms)
+        return -1;
+    stats_periodic_fmt = fmt;
+    WRITE_ONCE(stats_period_ns, period_ms * NSEC_PER_MSEC);
+    if (running)
+        return 0;
+    if (!kthread_create("stats", stats_thread, NULL, 0, PRIO_LOW))
+    {
+        stats_period_ns = 0;
+        return -1;
+    }
+    tiny_info("stats: dumping every %llu ms\n", period_ms);
+    return 0;
+}
+
+// stats [json]
+static int cmd_stats(int argc, char **argv)
+{
+    stats_dump(argc > 1 && !strcmp(argv[1], "json") ? STATS_JSON : STATS_HUMAN);
+    return 0;
+}
+SHELL_CMD(stats, "per-CPU event counters: stats [json]", cmd_stats);
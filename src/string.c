@@ -0,0 +1,95 @@
+/*
+ * File: string.c
+ * Date: 2026-10-18
+ * Description: Freestanding string/memory helpers. The kernel is linked
+ *              without libc, but gcc still emits calls to memset/memcpy
+ *              for large initializers and struct copies.
+ */
+
+#include "tinystd.h"
+
+void *memset(void *dst, int c, size_t n)
+{
+    uint8_t *d = dst;
+    uint64_t pattern = (uint8_t)c;
+
+    pattern |= pattern << 8;
+    pattern |= pattern << 16;
+    pattern |= pattern << 32;
+
+    while (n && ((uintptr_t)d & 7))
+    {
+        *d++ = (uint8_t)c;
+        n--;
+    }
+    while (n >= 8)
+    {
+        *(uint64_t *)d = pattern;
+        d += 8;
+        n -= 8;
+    }
+    while (n--)
+        *d++ = (uint8_t)c;
+    return dst;
+}
+
+void *memcpy(void *dst, const void *src, size_t n)
+{
+    uint8_t *d = dst;
+    const uint8_t *s = src;
+
+    if ((((uintptr_t)d | (uintptr_t)s) & 7) == 0)
+    {
+        while (n >= 8)
+        {
+            *(uint64_t *)d = *(const uint64_t *)s;
+            d += 8;
+            s += 8;
+            n -= 8;
+        }
+    }
+    while (n--)
+        *d++ = *s++;
+    return dst;
+}
+
+int memcmp(const void *a, const void *b, size_t n)
+{
+    const uint8_t *x = a, *y = b;
+
+    for (; n; n--, x++, y++)
+    {
+        if (*x != *y)
+            return *x - *y;
+    }
+    return 0;
+}
+
+size_t strlen(const char *s)
+{
+    const char *p = s;
+
+    while (*p)
+        p++;
+    return p - s;
+}
+
+int strcmp(const char *a, const char *b)
+{
+    while (*a && *a == *b)
+    {
+        a++;
+        b++;
+    }
+    return (uint8_t)*a - (uint8_t)*b;
+}
+
+int strncmp(const char *a, const char *b, size_t n)
+{
+    for (; n; n--, a++, b++)
+    {
+        if (*a != *b || !*a)
+            return (uint8_t)*a - (uint8_t)*b;
+    }
+    return 0;
+}
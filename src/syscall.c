@@ -0,0 +1,286 @@
+/*
+ * File: syscall.c
+ * Date: 2026-10-18
+ * Description: Numbered syscall table. The EL0 fast path in exception.S
+ *              calls straight into these; syscall_dispatch() is the slow
+ *              path used for svc from EL1 and out-of-range numbers.
+ */
+
+#include "syscall.h"
+#include "fat32.h"
+#include "mmap.h"
+#include "mmu.h"
+#include "sched.h"
+#include "tinyio.h"
+#include "tinystd.h"
+
+// Single-slot mailbox per pid slot; senders block while it is full
+struct mailbox
+{
+    spinlock_t lock;
+    int owner; // pid, 0 when closed
+    bool full;
+    int from;
+    uint32_t len;
+    char data[MSG_MAX];
+    struct wait_queue senders;
+    struct wait_queue receivers;
+};
+
+static struct mailbox mailboxes[MAX_TASKS];
+
+// User pointers must fall inside the EL0 slot
+static bool user_range_ok(uint64_t addr, uint64_t len)
+{
+    return addr >= USER_BASE && len <= USER_STACK_TOP - USER_BASE &&
+           addr <= USER_STACK_TOP - len;
+}
+
+/*
+ * Every page of the range must be mapped for EL0, and writable for a write:
+ * a kernel access to anything else (the hole below the stack, read-only
+ * text) is an EL1 abort, which is fatal. File-mapping pages not touched
+ * yet are faulted in here, before the caller takes any lock.
+ */
+static bool user_access_ok(uint64_t addr, uint64_t len, bool write)
+{
+    struct mm *mm = current->mm;
+
+    if (!mm || !user_range_ok(addr, len))
+        return false;
+    for (vaddr_t va = addr & ~(PAGE_SIZE - 1); va < addr + len; va += PAGE_SIZE)
+    {
+        uint64_t *pte = mm_walk(mm, va, false);
+
+        if (!pte || !(*pte & PTE_VALID))
+        {
+            if (vm_fault(va, write, false, true))
+                return false;
+            pte = mm_walk(mm, va, false);
+        }
+        if (!pte || !(*pte & PTE_VALID) || !(*pte & PTE_AP_EL0) ||
+            (write && (*pte & PTE_AP_RO)))
+            return false;
+    }
+    return true;
+}
+
+/*
+ * The copy itself may still fault (the page cache can evict a file page
+ * after the check) and sleep, so callers copy through a kernel buffer
+ * with no lock held.
+ */
+static int copy_from_user(void *dst, uint64_t src, uint64_t len)
+{
+    if (!user_access_ok(src, len, false))
+        return -EFAULT;
+    memcpy(dst, (const void *)src, len);
+    return 0;
+}
+
+static int copy_to_user(uint64_t dst, const void *src, uint64_t len)
+{
+    if (!user_access_ok(dst, len, true))
+        return -EFAULT;
+    memcpy((void *)dst, src, len);
+    return 0;
+}
+
+static int64_t sys_null(uint64_t a0, uint64_t a1, uint64_t a2,
+                        uint64_t a3, uint64_t a4, uint64_t a5)
+{
+    return 0;
+}
+
+#define WRITE_CHUNK 256
+
+// write(buf, len): console output. A user buffer goes out WRITE_CHUNK bytes
+// per UART lock hold, so only longer writes can interleave with others.
+static int64_t sys_write(uint64_t buf, uint64_t len, uint64_t a2,
+                         uint64_t a3, uint64_t a4, uint64_t a5)
+{
+    char chunk[WRITE_CHUNK];
+
+    if (!buf)
+        return -EFAULT;
+    if (!current || !current->mm)
+    {
+        uart_write((const char *)buf, len);
+        return len;
+    }
+    for (uint64_t off = 0; off < len; off += WRITE_CHUNK)
+    {
+        uint64_t n = MIN(len - off, (uint64_t)WRITE_CHUNK);
+
+        if (copy_from_user(chunk, buf + off, n))
+            return off ? (int64_t)off : -EFAULT;
+        uart_write(chunk, n);
+    }
+    return len;
+}
+
+// sleep(ms)
+static int64_t sys_sleep(uint64_t ms, uint64_t a1, uint64_t a2,
+                         uint64_t a3, uint64_t a4, uint64_t a5)
+{
+    task_sleep_ns(ms * NSEC_PER_MSEC);
+    return 0;
+}
+
+void mailbox_open(int pid)
+{
+    struct mailbox *mb = &mailboxes[task_slot(pid)];
+
+    spin_lock(&mb->lock);
+    mb->owner = pid;
+    mb->full = false;
+    spin_unlock(&mb->lock);
+}
+
+// Blocked senders wake up, see the owner gone and fail with -ESRCH
+void mailbox_close(int pid)
+{
+    struct mailbox *mb = &mailboxes[task_slot(pid)];
+
+    spin_lock(&mb->lock);
+    if (mb->owner == pid)
+    {
+        mb->owner = 0;
+        mb->full = false;
+        wait_queue_wake_all(&mb->senders);
+    }
+    spin_unlock(&mb->lock);
+}
+
+// send(pid, buf, len): blocks until the target mailbox is empty
+static int64_t sys_send(uint64_t pid, uint64_t buf, uint64_t len,
+                        uint64_t a3, uint64_t a4, uint64_t a5)
+{
+    char msg[MSG_MAX];
+    struct mailbox *mb;
+    int64_t ret = len;
+
+    if (len > MSG_MAX)
+        return -EINVAL;
+    if (copy_from_user(msg, buf, len))
+        return -EFAULT;
+    if (pid == 0 || pid > 0x7fffffff)
+        return -ESRCH;
+
+    mb = &mailboxes[task_slot(pid)];
+    spin_lock(&mb->lock);
+    while (mb->owner == (int)pid && mb->full)
+        wait_queue_sleep(&mb->senders, &mb->lock);
+    if (mb->owner != (int)pid)
+    {
+        ret = -ESRCH;
+    }
+    else
+    {
+        memcpy(mb->data, msg, len);
+        mb->len = len;
+        mb->from = current->pid;
+        mb->full = true;
+        wait_queue_wake_all(&mb->receivers);
+    }
+    spin_unlock(&mb->lock);
+    return ret;
+}
+
+// recv(buf, len, &from): blocks until a message arrives, returns its length
+static int64_t sys_recv(uint64_t buf, uint64_t len, uint64_t from,
+                        uint64_t a3, uint64_t a4, uint64_t a5)
+{
+    struct mailbox *mb = &mailboxes[task_slot(current->pid)];
+    char msg[MSG_MAX];
+    int64_t ret;
+    int sender;
+
+    // Checked up front so a bad buffer fails before a message is taken
+    if (!user_access_ok(buf, len, true) || (from && !user_access_ok(from, sizeof(int), true)))
+        return -EFAULT;
+
+    spin_lock(&mb->lock);
+    while (!mb->full)
+        wait_queue_sleep(&mb->receivers, &mb->lock);
+    ret = MIN(len, (uint64_t)mb->len);
+    memcpy(msg, mb->data, ret);
+    sender = mb->from;
+    mb->full = false;
+    wait_queue_wake_all(&mb->senders);
+    spin_unlock(&mb->lock);
+
+    if (copy_to_user(buf, msg, ret) || (from && copy_to_user(from, &sender, sizeof(int))))
+        return -EFAULT;
+    return ret;
+}
+
+static int64_t sys_exit(uint64_t code, uint64_t a1, uint64_t a2,
+                        uint64_t a3, uint64_t a4, uint64_t a5)
+{
+    task_exit((int)code);
+}
+
+static int64_t sys_getpid(uint64_t a0, uint64_t a1, uint64_t a2,
+                          uint64_t a3, uint64_t a4, uint64_t a5)
+{
+    return current->pid;
+}
+
+// mmap(path, &size): map a file read-only, returns its address
+static int64_t sys_mmap(uint64_t path, uint64_t size, uint64_t a2,
+                        uint64_t a3, uint64_t a4, uint64_t a5)
+{
+    char name[FAT_NAME_LEN];
+    struct fat_file *f;
+    uint64_t fsize;
+    vaddr_t va;
+    uint32_t i;
+
+    if (!current->mm || (size && !user_access_ok(size, sizeof(uint64_t), true)))
+        return -EFAULT;
+    for (i = 0; i < FAT_NAME_LEN; i++)
+    {
+        if (copy_from_user(&name[i], path + i, 1))
+            return -EFAULT;
+        if (!name[i])
+            break;
+    }
+    if (i == FAT_NAME_LEN)
+        return -EINVAL;
+
+    f = fat32_open(name);
+    if (!f)
+        return -ENOENT;
+    va = mmap_file(current->mm, f, PROT_READ);
+    if (!va)
+        return -ENOMEM;
+    fsize = f->size;
+    if (size && copy_to_user(size, &fsize, sizeof(fsize)))
+        return -EFAULT;
+    return va;
+}
+
+const syscall_fn_t syscall_table[NR_SYSCALLS] = {
+    [SYS_NULL] = sys_null,
+    [SYS_WRITE] = sys_write,
+    [SYS_SLEEP] = sys_sleep,
+    [SYS_SEND] = sys_send,
+    [SYS_RECV] = sys_recv,
+    [SYS_EXIT] = sys_exit,
+    [SYS_GETPID] = sys_getpid,
+    [SYS_MMAP] = sys_mmap,
+};
+
+void syscall_dispatch(struct trap_frame *frame)
+{
+    uint64_t nr = frame->regs[8];
+    uint64_t *r = frame->regs;
+
+    if (nr >= NR_SYSCALLS || !syscall_table[nr])
+    {
+        r[0] = -ENOSYS;
+        return;
+    }
+    r[0] = syscall_table[nr](r[0], r[1], r[2], r[3], r[4], r[5]);
+}
@@ -0,0 +1,149 @@
+/*
+ * File: timer.c
+ * Date: 2026-10-18
+ * Description: Per-CPU one-shot timer list on top of the EL1 virtual timer.
+ *              CNTV_CVAL always holds the earliest deadline; the scheduler
+ *              tick is just another event that re-arms itself.
+ */
+
+#include "timer.h"
+#include "fdt.h"
+#include "gic.h"
+#include "irq.h"
+#include "percpu.h"
+#include "sched.h"
+#include "stats.h"
+#include "tinystd.h"
+
+#define CNTV_CTL_ENABLE (1 << 0)
+#define CNTV_CTL_IMASK (1 << 1)
+
+struct timer_base
+{
+    struct timer_event *head; // sorted by deadline
+    struct timer_event tick;
+};
+
+static DEFINE_PER_CPU(struct timer_base, timer_base);
+DEFINE_STAT(timer_events, "software timer events expired");
+
+static inline void cntv_program(uint64_t cval)
+{
+    __asm__ volatile("msr cntv_cval_el0, %0\n\t"
+                     "msr cntv_ctl_el0, %1\n\t"
+                     "isb"
+                     :
+                     : "r"(cval), "r"((uint64_t)CNTV_CTL_ENABLE)
+                     : "memory");
+}
+
+static inline void cntv_stop(void)
+{
+    __asm__ volatile("msr cntv_ctl_el0, %0\n\t"
+                     "isb"
+                     :
+                     : "r"((uint64_t)CNTV_CTL_IMASK)
+                     : "memory");
+}
+
+static void timer_reprogram(struct timer_base *base)
+{
+    if (base->head)
+        cntv_program(base->head->deadline);
+    else
+        cntv_stop();
+}
+
+// Callers run with IRQs masked; the list is only touched by its own CPU
+static void __timer_add(struct timer_base *base, struct timer_event *ev)
+{
+    struct timer_event **pp = &base->head;
+
+    while (*pp && (*pp)->deadline <= ev->deadline)
+        pp = &(*pp)->next;
+    ev->next = *pp;
+    *pp = ev;
+    ev->armed = true;
+}
+
+static void __timer_del(struct timer_base *base, struct timer_event *ev)
+{
+    struct timer_event **pp = &base->head;
+
+    while (*pp && *pp != ev)
+        pp = &(*pp)->next;
+    if (*pp)
+        *pp = ev->next;
+    ev->armed = false;
+}
+
+void timer_add(struct timer_event *ev, uint64_t deadline)
+{
+    uint64_t flags = local_irq_save();
+    struct timer_base *base = this_cpu_ptr(&timer_base);
+
+    if (ev->armed)
+        __timer_del(base, ev);
+    ev->deadline = deadline;
+    __timer_add(base, ev);
+    timer_reprogram(base);
+    local_irq_restore(flags);
+}
+
+void timer_cancel(struct timer_event *ev)
+{
+    uint64_t flags = local_irq_save();
+    struct timer_base *base = this_cpu_ptr(&timer_base);
+
+    if (ev->armed)
+    {
+        __timer_del(base, ev);
+        timer_reprogram(base);
+    }
+    local_irq_restore(flags);
+}
+
+uint64_t timer_next_deadline(void)
+{
+    struct timer_base *base = this_cpu_ptr(&timer_base);
+
+    return base->head ? base->head->deadline : (uint64_t)-1;
+}
+
+static void timer_irq(uint32_t irq, void *arg)
+{
+    struct timer_base *base = this_cpu_ptr(&timer_base);
+    uint64_t now = read_cntvct();
+
+    while (base->head && base->head->deadline <= now)
+    {
+        struct timer_event *ev = base->head;
+        base->head = ev->next;
+        ev->armed = false;
+        stat_inc(timer_events);
+        ev->fn(ev);
+    }
+    timer_reprogram(base);
+}
+
+static void sched_tick(struct timer_event *ev)
+{
+    struct timer_base *base = this_cpu_ptr(&timer_base);
+
+    sched_tick_handler();
+    ev->deadline += ns_to_ticks(SCHED_TICK_NS);
+    __timer_add(base, ev);
+}
+
+void timer_init_cpu(void)
+{
+    struct timer_base *base = this_cpu_ptr(&timer_base);
+    uint32_t irq = dev_table.timer_irq[TIMER_IRQ_VIRT];
+
+    cntv_stop();
+    irq_register(irq, timer_irq, NULL);
+    gic_enable_irq(irq);
+
+    base->tick.fn = sched_tick;
+    timer_add(&base->tick, read_cntvct() + ns_to_ticks(SCHED_TICK_NS));
+}
@@ -0,0 +1,210 @@
+/*
+ * File: tiny_pool.c
+ * Date: 2026-10-18
+ * Description: Preallocated fixed-size object pools: per-CPU front caches
+ *              over a tagged lock-free free list, usable from IRQ context.
+ */
+
+#include "tiny_pool.h"
+#include "atomic.h"
+#include "irq.h"
+#include "page_alloc.h"
+#include "smp.h"
+#include "spin_lock.h"
+#include "tinystd.h"
+
+#define POOL_IDX_MASK 0xffffffffULL
+#define POOL_TAG_ONE (1ULL << 32)
+
+static struct tiny_pool pools[TINY_POOL_MAX];
+static uint32_t nr_pools;
+static spinlock_t pools_lock;
+
+static inline void *pool_obj(struct tiny_pool *pool, uint32_t idx)
+{
+    return pool->base + (uint64_t)(idx - 1) * pool->obj_size;
+}
+
+static inline uint32_t pool_idx(struct tiny_pool *pool, void *obj)
+{
+    return (uint32_t)(((uint8_t *)obj - pool->base) / pool->obj_size) + 1;
+}
+
+static inline volatile uint32_t *pool_link(void *obj)
+{
+    return (volatile uint32_t *)obj;
+}
+
+// The link read may see an object another CPU already took; the tag then fails the CAS
+static void *pool_pop(struct tiny_pool *pool)
+{
+    uint64_t old, new;
+    void *obj;
+
+    do
+    {
+        old = atomic_load_acquire(&pool->head);
+        if (!(old & POOL_IDX_MASK))
+            return NULL;
+        obj = pool_obj(pool, (uint32_t)old);
+        new = ((old & ~POOL_IDX_MASK) + POOL_TAG_ONE) | *pool_link(obj);
+    } while (!atomic_cmpxchg(&pool->head, old, new));
+    return obj;
+}
+
+// first..last already linked; the stlxr releases the links with the head
+static void pool_push_chain(struct tiny_pool *pool, void *first, void *last)
+{
+    uint64_t old, new;
+
+    do
+    {
+        old = atomic_load_acquire(&pool->head);
+        *pool_link(last) = (uint32_t)old;
+        new = ((old & ~POOL_IDX_MASK) + POOL_TAG_ONE) | pool_idx(pool, first);
+    } while (!atomic_cmpxchg(&pool->head, old, new));
+}
+
+static void pool_note_taken(struct tiny_pool *pool, uint32_t n)
+{
+    uint64_t out = pool->nr_objs - atomic_add_return(&pool->nr_free, -(uint64_t)n);
+    uint64_t hw;
+
+    while (out > (hw = READ_ONCE(pool->high_watermark)))
+    {
+        if (atomic_cmpxchg(&pool->high_watermark, hw, out))
+            break;
+    }
+}
+
+// Slow paths, IRQs masked
+static bool pool_refill(struct tiny_pool *pool, struct tiny_pool_cache *c)
+{
+    uint32_t n = 0;
+    void *obj;
+
+    while (n < TINY_POOL_BATCH && (obj = pool_pop(pool)))
+    {
+        c->objs[c->count++] = obj;
+        n++;
+    }
+    if (n)
+        pool_note_taken(pool, n);
+    return n != 0;
+}
+
+static void pool_drain(struct tiny_pool *pool, struct tiny_pool_cache *c)
+{
+    void *first = c->objs[c->count - 1];
+    void *last = first;
+
+    for (int i = 1; i < TINY_POOL_BATCH; i++)
+    {
+        void *obj = c->objs[c->count - 1 - i];
+
+        *pool_link(last) = pool_idx(pool, obj);
+        last = obj;
+    }
+    c->count -= TINY_POOL_BATCH;
+    pool_push_chain(pool, first, last);
+    atomic_add_return(&pool->nr_free, TINY_POOL_BATCH);
+}
+
+void *tiny_pool_alloc(struct tiny_pool *pool)
+{
+    uint64_t flags = local_irq_save();
+    struct tiny_pool_cache *c = &pool->cache[smp_processor_id()];
+    void *obj = NULL;
+
+    if (c->count || pool_refill(pool, c))
+    {
+        obj = c->objs[--c->count];
+        c->allocs++;
+    }
+    local_irq_restore(flags);
+    if (!obj)
+        atomic_add_return(&pool->exhausted, 1);
+    return obj;
+}
+
+void tiny_pool_free(struct tiny_pool *pool, void *obj)
+{
+    uint64_t flags = local_irq_save();
+    struct tiny_pool_cache *c = &pool->cache[smp_processor_id()];
+
+    if (c->count == TINY_POOL_CACHE)
+        pool_drain(pool, c);
+    c->objs[c->count++] = obj;
+    c->frees++;
+    local_irq_restore(flags);
+}
+
+// Boot or thread context only: takes pages from the buddy allocator
+struct tiny_pool *tiny_pool_create(const char *name, uint32_t obj_size, uint32_t nr_objs)
+{
+    struct tiny_pool *pool;
+    uint64_t bytes;
+    uint32_t order = 0;
+
+    if (!nr_objs)
+        return NULL;
+    obj_size = (MAX(obj_size, sizeof(uint32_t)) + 7) & ~7U;
+    bytes = (uint64_t)obj_size * nr_objs;
+    while ((PAGE_SIZE << order) < bytes)
+        order++;
+    if (order >= MAX_ORDER)
+        return NULL;
+
+    spin_lock(&pools_lock);
+    if (nr_pools == TINY_POOL_MAX)
+    {
+        spin_unlock(&pools_lock);
+        tiny_error("tiny_pool: no slot left for %s\n", name);
+        return NULL;
+    }
+    pool = &pools[nr_pools++];
+    spin_unlock(&pools_lock);
+
+    pool->base = alloc_pages(order);
+    if (!pool->base)
+    {
+        tiny_error("tiny_pool: %s: no memory for %u x %u bytes\n", name, nr_objs, obj_size);
+        return NULL; // the slot stays unused
+    }
+    pool->order = order;
+    pool->obj_size = obj_size;
+    pool->nr_objs = nr_objs;
+    snprintf(pool->name, TINY_POOL_NAME_LEN, "%s", name);
+
+    // Chain every object in address order, then publish the whole list
+    for (uint32_t i = 1; i < nr_objs; i++)
+        *pool_link(pool_obj(pool, i)) = i + 1;
+    *pool_link(pool_obj(pool, nr_objs)) = 0;
+    pool->nr_free = nr_objs;
+    atomic_store_release(&pool->head, 1);
+    tiny_debug("tiny_pool: %s: %u x %u bytes\n", pool->name, nr_objs, obj_size);
+    return pool;
+}
+
+void tiny_pool_dump(void)
+{
+    tiny_info("tiny_pool: %u pool(s)\n", nr_pools);
+    for (uint32_t i = 0; i < nr_pools; i++)
+    {
+        struct tiny_pool *pool = &pools[i];
+        uint64_t allocs = 0, frees = 0, cached = 0;
+
+        if (!pool->base)
+            continue;
+        for (int cpu = 0; cpu < NR_CPUS; cpu++)
+        {
+            allocs += pool->cache[cpu].allocs;
+            frees += pool->cache[cpu].frees;
+            cached += pool->cache[cpu].count;
+        }
+        printf("  %-16s %4u B x %-5u in use %llu, cached %llu, free %llu, high %llu, "
+               "exhausted %llu, allocs %llu\n",
+               pool->name, pool->obj_size, pool->nr_objs, allocs - frees, cached, pool->nr_free,
+               pool->high_watermark, pool->exhausted, allocs);
+    }
+}
@@ -1,29 +1,178 @@
 #include "tinyio.h"
 #include <config.h>
 #include <spin_lock.h>
+#include "tiny_types.h"
+#include "tinystd.h"
 
-spinlock_t lock;
+// PL011 registers, in words from the data register
+#define UART_FR (0x18 / 4)
+#define UART_IMSC (0x38 / 4)
+#define UART_ICR (0x44 / 4)
+#define UART_FR_RXFE (1 << 4)
+#define UART_INT_RX (1 << 4) // RX FIFO level
+#define UART_INT_RT (1 << 6) // RX timeout: data waiting below the level
+
+spinlock_t lock __cacheline_aligned;
+
+// PL011 data register, moved to the FDT-discovered address at boot
+static volatile unsigned int *uart_dr __read_mostly = (unsigned int *)UART_BASE_ADDR;
+
+extern struct log_module __log_modules_start[];
+extern struct log_module __log_modules_end[];
+
+static const char *const log_level_names[] = {"none", "error", "warn", "info", "debug", "all"};
 
 void tiny_io_init()
 {
     spinlock_init(&lock);
 }
 
+void tiny_io_set_base(unsigned long base)
+{
+    uart_dr = (volatile unsigned int *)base;
+}
+
 void uart_putchar(char c)
 {
-    volatile unsigned int *const UART0DR = (unsigned int *)UART_BASE_ADDR;
     spin_lock(&lock);
-    *UART0DR = (unsigned int)c;
+    writel_relaxed((unsigned int)c, uart_dr);
+    spin_unlock(&lock);
+}
+
+// Whole buffer under one lock hold, so concurrent writers don't interleave.
+// The data travels in the stores themselves, so no barrier is needed at all.
+void uart_write(const char *buf, size_t len)
+{
+    spin_lock(&lock);
+    for (size_t i = 0; i < len; i++)
+        writel_relaxed((unsigned int)buf[i], uart_dr);
     spin_unlock(&lock);
 }
 
+// Records are formatted into one buffer and written under a single lock
+// hold; only a batch larger than the buffer is flushed in several pieces.
+int tiny_printv(const printf_fmt_t *fmt, const printf_arg_t *args, size_t nr)
+{
+    char buf[TINY_PRINTV_BUF];
+    size_t len = 0;
+    int total = 0;
+
+    for (size_t r = 0; r < nr; r++)
+    {
+        const printf_arg_t *rec = args + r * fmt->nr_args;
+        int n = snprintf_fmtv(buf + len, sizeof(buf) - len, fmt, rec, 1);
+
+        if (len + n >= sizeof(buf) && len)
+        {
+            uart_write(buf, len);
+            len = 0;
+            n = snprintf_fmtv(buf, sizeof(buf), fmt, rec, 1);
+        }
+        total += n;
+        len += MIN((size_t)n, sizeof(buf) - 1 - len); // a record alone too big is cut
+    }
+    if (len)
+        uart_write(buf, len);
+    return total;
+}
+
 void uart_putchar_nonlock(char c)
 {
-    volatile unsigned int *const UART0DR = (unsigned int *)UART_BASE_ADDR;
-    *UART0DR = (unsigned int)c;
+    writel_relaxed((unsigned int)c, uart_dr);
 }
 
 void _putchar(char character)
 {
     uart_putchar_nonlock(character);
 }
+
+// Non-blocking read of the RX FIFO: a byte, or -1 when it is empty
+int uart_getc(void)
+{
+    if (readl_relaxed(&uart_dr[UART_FR]) & UART_FR_RXFE)
+        return -1;
+    return readl_relaxed(uart_dr) & 0xff;
+}
+
+void uart_rx_irq_enable(void)
+{
+    writel_relaxed(UART_INT_RX | UART_INT_RT, &uart_dr[UART_ICR]);
+    writel_relaxed(readl_relaxed(&uart_dr[UART_IMSC]) | UART_INT_RX | UART_INT_RT,
+                   &uart_dr[UART_IMSC]);
+}
+
+// The level interrupt drops once the FIFO is drained; the timeout needs a clear
+void uart_rx_irq_ack(void)
+{
+    writel_relaxed(UART_INT_RX | UART_INT_RT, &uart_dr[UART_ICR]);
+}
+
+const char *log_level_name(int level)
+{
+    if (level < LOG_LEVEL_NONE || level > LOG_LEVEL_ALL)
+        return "?";
+    return log_level_names[level];
+}
+
+// "info" or "3"; -1 if neither
+int log_level_parse(const char *s)
+{
+    for (int i = LOG_LEVEL_NONE; i <= LOG_LEVEL_ALL; i++)
+    {
+        if (!strcmp(s, log_level_names[i]) || (s[0] == '0' + i && !s[1]))
+            return i;
+    }
+    return -1;
+}
+
+// Flip the module's keys so exactly the levels up to min(level, LOG_LEVEL) print
+static void log_module_set(struct log_module *m, int level)
+{
+    level = level < LOG_LEVEL ? level : LOG_LEVEL;
+    for (int i = 0; i < LOG_LEVEL_DEBUG; i++)
+    {
+        if (i < level)
+            static_key_enable(&m->keys[i]);
+        else
+            static_key_disable(&m->keys[i]);
+    }
+    m->level = level;
+}
+
+static int log_module_sites(const struct log_module *m)
+{
+    int n = 0;
+
+    for (int i = 0; i < LOG_LEVEL_DEBUG; i++)
+        n += static_key_sites(&m->keys[i]);
+    return n;
+}
+
+// module NULL: every module. Returns how many modules matched
+int log_set_level(const char *module, int level)
+{
+    int n = 0;
+
+    if (level < LOG_LEVEL_NONE)
+        return 0;
+    for (struct log_module *m = __log_modules_start; m < __log_modules_end; m++)
+    {
+        if (module && strcmp(m->name, module))
+            continue;
+        log_module_set(m, level);
+        n++;
+    }
+    return n;
+}
+
+// Modules without a single log call site are left out
+void log_dump_levels(void)
+{
+    for (struct log_module *m = __log_modules_start; m < __log_modules_end; m++)
+    {
+        int sites = log_module_sites(m);
+
+        if (sites)
+            printf("  %-20s %-6s %d site(s)\n", m->name, log_level_name(m->level), sites);
+    }
+}
@@ -0,0 +1,130 @@
+/*
+ * File: trace.c
+ * Date: 2026-10-18
+ * Description: Flight recorder. Per-CPU rings of timestamped kernel
+ *              events, dumped as JSON lines on demand or on a fatal
+ *              exception.
+ */
+
+#include "trace.h"
+#include "atomic.h"
+#include "irq.h"
+#include "shell.h"
+#include "smp.h"
+#include "timer.h"
+#include "tinystd.h"
+
+struct trace_ring
+{
+    uint64_t head; // events ever recorded; only the owning CPU writes it
+    struct trace_entry ent[TRACE_RING_EVENTS];
+} ____cacheline_aligned;
+
+// In .bss rather than .percpu: the per-CPU template is part of the image
+static struct trace_ring trace_rings[NR_CPUS];
+
+volatile bool trace_on = true;
+
+static const char *const trace_names[NR_TRACE_TYPES] = {
+    [TRACE_NONE] = "none",
+    [TRACE_IRQ_ENTER] = "irq_enter",
+    [TRACE_IRQ_EXIT] = "irq_exit",
+    [TRACE_SWITCH] = "switch",
+    [TRACE_LOCK_ACQUIRE] = "lock_acquire",
+    [TRACE_LOCK_RELEASE] = "lock_release",
+    [TRACE_VQ_KICK] = "vq_kick",
+    [TRACE_VQ_COMPLETE] = "vq_complete",
+};
+
+// IRQs masked so a nested handler cannot claim the same slot
+void __trace_event(uint32_t type, uint32_t a, uint32_t b)
+{
+    uint64_t flags = local_irq_save();
+    int cpu = smp_processor_id();
+    struct trace_ring *r = &trace_rings[cpu];
+    struct trace_entry *e = &r->ent[r->head & (TRACE_RING_EVENTS - 1)];
+
+    e->ts = read_cntvct();
+    e->type = (uint8_t)type;
+    e->cpu = (uint8_t)cpu;
+    e->a = (uint16_t)a;
+    e->b = b;
+    r->head++;
+    local_irq_restore(flags);
+}
+
+void trace_set(bool on)
+{
+    WRITE_ONCE(trace_on, on);
+}
+
+void trace_clear(void)
+{
+    bool was_on = trace_on;
+    int cpu;
+
+    trace_set(false);
+    for_each_online_cpu(cpu)
+        WRITE_ONCE(trace_rings[cpu].head, 0);
+    trace_set(was_on);
+}
+
+// Recording pauses meanwhile, so the rings do not move under the reader
+void trace_dump(uint32_t last)
+{
+    bool was_on = trace_on;
+    int cpu;
+
+    trace_set(false);
+    printf("{\"type\":\"trace_meta\",\"cntfrq\":%llu,\"cpus\":%d,\"ring\":%u}\n",
+           read_cntfrq(), num_online_cpus(), TRACE_RING_EVENTS);
+    for_each_online_cpu(cpu)
+    {
+        struct trace_ring *r = &trace_rings[cpu];
+        uint64_t head = READ_ONCE(r->head);
+        uint64_t n = MIN(head, (uint64_t)TRACE_RING_EVENTS);
+
+        if (last && last < n)
+            n = last;
+        for (uint64_t i = head - n; i < head; i++)
+        {
+            const struct trace_entry *e = &r->ent[i & (TRACE_RING_EVENTS - 1)];
+
+            printf("{\"type\":\"trace\",\"cpu\":%u,\"ts\":%llu,\"ev\":\"%s\",\"a\":%u,\"b\":%u}\n",
+                   e->cpu, e->ts, e->type < NR_TRACE_TYPES ? trace_names[e->type] : "none",
+                   e->a, e->b);
+        }
+    }
+    trace_set(was_on);
+}
+
+// trace [on|off|clear|dump [n]]
+static int cmd_trace(int argc, char **argv)
+{
+    uint32_t last = 0;
+
+    if (argc < 2)
+    {
+        printf("trace: %s, %u events per cpu\n", trace_on ? "on" : "off", TRACE_RING_EVENTS);
+        return 0;
+    }
+    if (!strcmp(argv[1], "on"))
+        trace_set(true);
+    else if (!strcmp(argv[1], "off"))
+        trace_set(false);
+    else if (!strcmp(argv[1], "clear"))
+        trace_clear();
+    else if (!strcmp(argv[1], "dump"))
+    {
+        for (const char *p = argc > 2 ? argv[2] : ""; *p >= '0' && *p <= '9'; p++)
+            last = last * 10 + (uint32_t)(*p - '0');
+        trace_dump(last);
+    }
+    else
+    {
+        printf("usage: trace [on|off|clear|dump [n]]\n");
+        return -1;
+    }
+    return 0;
+}
+SHELL_CMD(trace, "flight recorder: trace [on|off|clear|dump [n]]", cmd_trace);
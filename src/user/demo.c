@@ -0,0 +1,127 @@
+/*
+ * File: demo.c
+ * Date: 2026-10-18
+ * Description: EL0 demo programs. Built into the user image (see link.lds)
+ *              and only talk to the kernel through svc.
+ */
+
+#include "ulib.h"
+
+// Entry functions return here through lr
+void user_exit_stub(void)
+{
+    u_exit(0);
+}
+
+void user_hello(uint64_t arg)
+{
+    struct uline line;
+
+    line.len = 0;
+    for (uint64_t i = 0; i < arg; i++)
+    {
+        uline_puts(&line, "[el0] hello from pid ");
+        uline_putu(&line, u_getpid());
+        uline_puts(&line, ", round ");
+        uline_putu(&line, i);
+        uline_puts(&line, "\n");
+        uline_flush(&line);
+        u_sleep_ms(20);
+    }
+}
+
+static bool msg_is(const char *buf, int64_t len, const char *s)
+{
+    int64_t i = 0;
+
+    for (; i < len && s[i]; i++)
+    {
+        if (buf[i] != s[i])
+            return false;
+    }
+    return i == len && !s[i];
+}
+
+// Echo server: answers every message with "pong" until told to quit
+void user_pong(uint64_t arg)
+{
+    char buf[MSG_MAX];
+    int from;
+    int64_t n;
+
+    while ((n = u_recv(buf, sizeof(buf), &from)) >= 0)
+    {
+        if (msg_is(buf, n, "quit"))
+            break;
+        u_send(from, "pong", 4);
+    }
+}
+
+void user_ping(uint64_t peer)
+{
+    struct uline line;
+    char buf[MSG_MAX];
+    uint64_t t0, t1;
+    int from;
+
+    line.len = 0;
+    for (uint64_t i = 0; i < 5; i++)
+    {
+        __asm__ volatile("isb; mrs %0, cntvct_el0" : "=r"(t0));
+        if (u_send(peer, "ping", 4) < 0 || u_recv(buf, sizeof(buf), &from) < 0)
+            u_exit(1);
+        __asm__ volatile("isb; mrs %0, cntvct_el0" : "=r"(t1));
+
+        uline_puts(&line, "[el0] ping ");
+        uline_putu(&line, i);
+        uline_puts(&line, ": reply from pid ");
+        uline_putu(&line, from);
+        uline_puts(&line, " in ");
+        uline_putu(&line, t1 - t0);
+        uline_puts(&line, " ticks\n");
+        uline_flush(&line);
+    }
+    u_send(peer, "quit", 4);
+}
+
+// Maps a file from the disk image and reads it front to back: the faults
+// are sequential, so read-ahead keeps most of them off the disk
+void user_mapcat(uint64_t arg)
+{
+    const char *path = "/SEQ.TXT";
+    struct uline line;
+    uint64_t size = 0, lines = 0, i;
+    const char *p;
+    int64_t ret;
+
+    line.len = 0;
+    ret = u_mmap(path, &size);
+    if (ret < 0)
+    {
+        uline_puts(&line, "[el0] mapcat: cannot map ");
+        uline_puts(&line, path);
+        uline_puts(&line, ", error ");
+        uline_putu(&line, -ret);
+        uline_puts(&line, "\n");
+        uline_flush(&line);
+        return;
+    }
+
+    p = (const char *)ret;
+    for (i = 0; i < size; i++)
+    {
+        if (p[i] == '\n')
+            lines++;
+    }
+    uline_puts(&line, "[el0] mapcat: ");
+    uline_puts(&line, path);
+    uline_puts(&line, ", ");
+    uline_putu(&line, size);
+    uline_puts(&line, " bytes, ");
+    uline_putu(&line, lines);
+    uline_puts(&line, " lines: ");
+    for (i = 0; i < size && p[i] != '\n' && line.len < sizeof(line.buf) - 1; i++)
+        line.buf[line.len++] = p[i];
+    uline_puts(&line, "\n");
+    uline_flush(&line);
+}
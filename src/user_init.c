@@ -0,0 +1,37 @@
+/*
+ * File: user_init.c
+ * Date: 2026-10-18
+ * Description: Starts the EL0 demo programs from src/user, spread over the
+ *              online CPUs. kernel_main idles until all of them have exited.
+ */
+
+#include "fat32.h"
+#include "sched.h"
+#include "smp.h"
+#include "tinystd.h"
+#include "ulib.h"
+
+#define HELLO_ROUNDS 3
+
+void user_init(void)
+{
+    uint64_t exit_stub = USER_SYM_ADDR(user_exit_stub);
+    int ncpus = num_online_cpus();
+    struct task *pong;
+
+    task_create_user("hello", USER_SYM_ADDR(user_hello), HELLO_ROUNDS, exit_stub,
+                     0);
+    pong = task_create_user("pong", USER_SYM_ADDR(user_pong), 0, exit_stub,
+                            1 % ncpus);
+    if (!pong)
+    {
+        tiny_error("user: failed to start pong\n");
+        return;
+    }
+    task_create_user("ping", USER_SYM_ADDR(user_ping), pong->pid, exit_stub,
+                     2 % ncpus);
+    if (fat32_mounted())
+        task_create_user("mapcat", USER_SYM_ADDR(user_mapcat), 0, exit_stub,
+                         3 % ncpus);
+    tiny_info("user: %llu EL0 task(s) started\n", nr_user_tasks);
+}
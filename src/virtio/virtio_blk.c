@@ -0,0 +1,196 @@
+/*
+ * File: virtio_blk.c
+ * Date: 2026-10-18
+ * Description: virtio-blk driver behind the block layer. Each block layer
+ *              request, merged chain included, becomes one descriptor chain:
+ *              header, one segment per merged request, status byte.
+ */
+
+#include "virtio.h"
+#include "blk.h"
+#include "gic.h"
+#include "irq.h"
+#include "mbuf.h"
+#include "page_alloc.h"
+#include "tinystd.h"
+
+#define VIRTIO_BLK_F_SEG_MAX 2
+#define VIRTIO_BLK_F_BLK_SIZE 6
+#define VIRTIO_BLK_F_FLUSH 9
+
+#define VIRTIO_BLK_T_IN 0
+#define VIRTIO_BLK_T_OUT 1
+#define VIRTIO_BLK_T_FLUSH 4
+
+#define VIRTIO_BLK_S_OK 0
+
+#define VBLK_CFG_CAPACITY 0
+#define VBLK_CFG_SEG_MAX 12
+
+#define VBLK_QUEUE_SIZE 256
+#define VBLK_MAX_SEGS 30 // data segments per request, +2 for header/status
+#define VBLK_MAX_SECTORS 2048
+#define VBLK_MAX_DEPTH 64
+
+struct virtio_blk_outhdr
+{
+    uint32_t type;
+    uint32_t ioprio;
+    uint64_t sector;
+};
+
+// Per in-flight request; header and status must live in device-visible memory
+struct vblk_slot
+{
+    struct virtio_blk_outhdr hdr;
+    uint8_t status;
+    struct blk_request *rq;
+};
+
+struct virtio_blk
+{
+    struct virtio_dev *dev;
+    struct virtqueue vq;
+    spinlock_t lock;
+    struct vblk_slot *slots;
+    uint32_t free_slots[VBLK_MAX_DEPTH];
+    uint32_t nr_free;
+    struct blk_device bd;
+};
+
+static struct virtio_blk vblk;
+
+static int vblk_queue_rq(struct blk_device *bd, struct blk_request *rq)
+{
+    struct virtio_blk *vb = bd->priv;
+    struct vq_buf bufs[VBLK_MAX_SEGS + 2];
+    struct vblk_slot *slot;
+    uint32_t n = 0;
+    uint64_t flags;
+    bool bad = false;
+    int ret = -1;
+
+    flags = local_irq_save();
+    spin_lock(&vb->lock);
+    if (!vb->nr_free || vb->vq.num_free < rq->nr_segs + 2)
+        goto out;
+
+    slot = &vb->slots[vb->free_slots[--vb->nr_free]];
+    slot->rq = rq;
+    slot->status = 0xff;
+    slot->hdr.ioprio = 0;
+    slot->hdr.sector = rq->sector;
+    slot->hdr.type = rq->op == BLK_READ    ? VIRTIO_BLK_T_IN
+                     : rq->op == BLK_WRITE ? VIRTIO_BLK_T_OUT
+                                           : VIRTIO_BLK_T_FLUSH;
+
+    bufs[n++] = (struct vq_buf){(paddr_t)&slot->hdr, sizeof(slot->hdr), false};
+    for (struct blk_request *r = rq; r && rq->op != BLK_FLUSH; r = r->merged)
+    {
+        if (r->mb)
+        {
+            int segs = mbuf_to_vq(r->mb, &bufs[n], VBLK_MAX_SEGS + 1 - n, rq->op == BLK_READ);
+
+            if (segs < 0)
+            {
+                bad = true;
+                break;
+            }
+            n += segs;
+        }
+        else
+            bufs[n++] = (struct vq_buf){(paddr_t)r->buf, r->nr_sectors << BLK_SECTOR_SHIFT,
+                                        rq->op == BLK_READ};
+    }
+    if (bad)
+    {
+        vb->free_slots[vb->nr_free++] = slot - vb->slots;
+        goto out;
+    }
+    bufs[n++] = (struct vq_buf){(paddr_t)&slot->status, 1, true};
+
+    ret = virtqueue_add(&vb->vq, bufs, n, slot);
+    if (ret)
+        vb->free_slots[vb->nr_free++] = slot - vb->slots;
+    else
+        virtqueue_kick(&vb->vq);
+out:
+    spin_unlock(&vb->lock);
+    local_irq_restore(flags);
+    // More segments than a request can carry: retrying would never succeed
+    if (bad)
+    {
+        blk_complete(bd, rq, -1);
+        return 0;
+    }
+    return ret;
+}
+
+// Reap under the lock, then complete without it: completions dispatch
+// more requests through vblk_queue_rq
+static void vblk_irq(uint32_t irq, void *arg)
+{
+    struct virtio_blk *vb = arg;
+    struct blk_request *done[VBLK_MAX_DEPTH];
+    int status[VBLK_MAX_DEPTH];
+    uint32_t n = 0;
+    struct vblk_slot *slot;
+
+    virtio_ack_irq(vb->dev);
+    spin_lock(&vb->lock);
+    while (n < VBLK_MAX_DEPTH && (slot = virtqueue_get(&vb->vq, NULL)))
+    {
+        done[n] = slot->rq;
+        status[n] = slot->status == VIRTIO_BLK_S_OK ? 0 : -1;
+        n++;
+        vb->free_slots[vb->nr_free++] = slot - vb->slots;
+    }
+    spin_unlock(&vb->lock);
+
+    for (uint32_t i = 0; i < n; i++)
+        blk_complete(&vb->bd, done[i], status[i]);
+}
+
+int virtio_blk_probe(struct virtio_dev *dev)
+{
+    struct virtio_blk *vb = &vblk;
+    uint32_t segs = VBLK_MAX_SEGS;
+    uint32_t order = 0;
+
+    if (vb->dev)
+        return -1;
+
+    virtio_negotiate(dev, (1ULL << VIRTIO_BLK_F_SEG_MAX) | (1ULL << VIRTIO_BLK_F_FLUSH));
+    if (dev->features & (1ULL << VIRTIO_BLK_F_SEG_MAX))
+        segs = MIN(segs, virtio_config_read32(dev, VBLK_CFG_SEG_MAX));
+
+    if (virtqueue_setup(dev, &vb->vq, 0, VBLK_QUEUE_SIZE))
+        return -1;
+    while ((PAGE_SIZE << order) < VBLK_MAX_DEPTH * sizeof(struct vblk_slot))
+        order++;
+    vb->slots = alloc_zeroed_pages(order);
+    if (!vb->slots)
+        return -1;
+
+    vb->dev = dev;
+    dev->priv = vb;
+    spinlock_init(&vb->lock);
+    for (uint32_t i = 0; i < VBLK_MAX_DEPTH; i++)
+        vb->free_slots[vb->nr_free++] = i;
+
+    vb->bd.name = "vda";
+    vb->bd.capacity = virtio_config_read32(dev, VBLK_CFG_CAPACITY) |
+                      (uint64_t)virtio_config_read32(dev, VBLK_CFG_CAPACITY + 4) << 32;
+    vb->bd.max_segs = MAX(1U, segs);
+    vb->bd.max_sectors = VBLK_MAX_SECTORS;
+    vb->bd.hw_depth = MIN((uint32_t)VBLK_MAX_DEPTH, vb->vq.num / (vb->bd.max_segs + 2));
+    if (!vb->bd.hw_depth)
+        vb->bd.hw_depth = 1;
+    vb->bd.queue_rq = vblk_queue_rq;
+    vb->bd.priv = vb;
+
+    irq_register(dev->irq, vblk_irq, vb);
+    gic_enable_irq(dev->irq);
+    virtio_driver_ok(dev);
+    return blk_register(&vb->bd);
+}
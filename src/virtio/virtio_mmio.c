@@ -0,0 +1,128 @@
+/*
+ * File: virtio_mmio.c
+ * Date: 2026-10-18
+ * Description: virtio-mmio transport. Walks the slots found in the device
+ *              tree, negotiates features and hands each device to the
+ *              driver registered for its id. Handles both the legacy (v1)
+ *              and the modern (v2) register layout.
+ */
+
+#include "virtio.h"
+#include "fdt.h"
+#include "page_alloc.h"
+#include "tinystd.h"
+
+static struct virtio_dev virtio_devs[FDT_MAX_VIRTIO];
+
+static const struct virtio_driver virtio_drivers[] = {
+    {VIRTIO_ID_NET, "virtio-net", virtio_net_probe},
+    {VIRTIO_ID_BLK, "virtio-blk", virtio_blk_probe},
+};
+
+static const struct virtio_driver *virtio_find_driver(uint32_t device_id)
+{
+    for (size_t i = 0; i < sizeof(virtio_drivers) / sizeof(virtio_drivers[0]); i++)
+    {
+        if (virtio_drivers[i].device_id == device_id)
+            return &virtio_drivers[i];
+    }
+    return NULL;
+}
+
+int virtio_probe_all(void)
+{
+    int found = 0;
+
+    for (uint32_t i = 0; i < dev_table.nr_virtio; i++)
+    {
+        struct virtio_dev *dev = &virtio_devs[i];
+        const struct virtio_driver *drv;
+
+        dev->base = dev_table.virtio[i].base;
+        dev->irq = dev_table.virtio[i].irq;
+        dev->slot = i;
+        dev->dma.coherent = dev_table.virtio[i].dma_coherent;
+        if (virtio_read32(dev, VIRTIO_MMIO_MAGIC) != VIRTIO_MMIO_MAGIC_VALUE)
+            continue;
+        dev->device_id = virtio_read32(dev, VIRTIO_MMIO_DEVICE_ID);
+        if (!dev->device_id) // empty transport slot
+            continue;
+        dev->version = virtio_read32(dev, VIRTIO_MMIO_VERSION);
+
+        drv = virtio_find_driver(dev->device_id);
+        if (!drv)
+        {
+            tiny_debug("virtio: slot %u, device id %u has no driver\n", i, dev->device_id);
+            continue;
+        }
+        tiny_info("virtio: slot %u at 0x%llx irq %u: %s (mmio v%u%s)\n", i,
+                  (uint64_t)dev->base, dev->irq, drv->name, dev->version,
+                  dev->dma.coherent ? "" : ", non-coherent DMA");
+        if (drv->probe(dev) == 0)
+            found++;
+        else
+            virtio_fail(dev);
+    }
+    return found;
+}
+
+// Reset, then accept the subset of `wanted` the device offers
+uint64_t virtio_negotiate(struct virtio_dev *dev, uint64_t wanted)
+{
+    uint64_t offered;
+
+    virtio_write32(dev, VIRTIO_MMIO_STATUS, 0);
+    virtio_write32(dev, VIRTIO_MMIO_STATUS, VIRTIO_STATUS_ACK);
+    virtio_write32(dev, VIRTIO_MMIO_STATUS, VIRTIO_STATUS_ACK | VIRTIO_STATUS_DRIVER);
+
+    virtio_write32(dev, VIRTIO_MMIO_DEVICE_FEATURES_SEL, 0);
+    offered = virtio_read32(dev, VIRTIO_MMIO_DEVICE_FEATURES);
+    virtio_write32(dev, VIRTIO_MMIO_DEVICE_FEATURES_SEL, 1);
+    offered |= (uint64_t)virtio_read32(dev, VIRTIO_MMIO_DEVICE_FEATURES) << 32;
+
+    if (dev->version >= 2)
+        wanted |= 1ULL << VIRTIO_F_VERSION_1;
+    dev->features = offered & wanted;
+
+    virtio_write32(dev, VIRTIO_MMIO_DRIVER_FEATURES_SEL, 0);
+    virtio_write32(dev, VIRTIO_MMIO_DRIVER_FEATURES, (uint32_t)dev->features);
+    virtio_write32(dev, VIRTIO_MMIO_DRIVER_FEATURES_SEL, 1);
+    virtio_write32(dev, VIRTIO_MMIO_DRIVER_FEATURES, (uint32_t)(dev->features >> 32));
+
+    if (dev->version >= 2)
+    {
+        virtio_write32(dev, VIRTIO_MMIO_STATUS, VIRTIO_STATUS_ACK | VIRTIO_STATUS_DRIVER |
+                                                    VIRTIO_STATUS_FEATURES_OK);
+        if (!(virtio_read32(dev, VIRTIO_MMIO_STATUS) & VIRTIO_STATUS_FEATURES_OK))
+            tiny_warn("virtio: slot %d rejected features 0x%llx\n", dev->slot, dev->features);
+    }
+    else
+    {
+        virtio_write32(dev, VIRTIO_MMIO_GUEST_PAGE_SIZE, PAGE_SIZE);
+    }
+    return dev->features;
+}
+
+void virtio_driver_ok(struct virtio_dev *dev)
+{
+    uint32_t status = virtio_read32(dev, VIRTIO_MMIO_STATUS);
+
+    // Ordered: the buffers queued so far must be visible to the live device
+    writel(status | VIRTIO_STATUS_DRIVER_OK, (volatile void *)(dev->base + VIRTIO_MMIO_STATUS));
+}
+
+void virtio_fail(struct virtio_dev *dev)
+{
+    uint32_t status = virtio_read32(dev, VIRTIO_MMIO_STATUS);
+
+    virtio_write32(dev, VIRTIO_MMIO_STATUS, status | VIRTIO_STATUS_FAILED);
+}
+
+uint32_t virtio_ack_irq(struct virtio_dev *dev)
+{
+    uint32_t isr = virtio_read32(dev, VIRTIO_MMIO_INTERRUPT_STATUS);
+
+    if (isr)
+        virtio_write32(dev, VIRTIO_MMIO_INTERRUPT_ACK, isr);
+    return isr;
+}
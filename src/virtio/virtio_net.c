@@ -0,0 +1,274 @@
+/*
+ * File: virtio_net.c
+ * Date: 2026-10-18
+ * Description: Minimal virtio-net driver: one RX and one TX queue with
+ *              fixed 2KB buffers. RX completions are driven by NAPI; TX
+ *              interrupts stay masked and finished buffers are reclaimed
+ *              on the next transmit.
+ */
+
+#include "virtio.h"
+#include "virtio_net.h"
+#include "atomic.h"
+#include "gic.h"
+#include "irq.h"
+#include "mbuf.h"
+#include "napi.h"
+#include "page_alloc.h"
+#include "spin_lock.h"
+#include "stats.h"
+#include "tinystd.h"
+
+struct virtio_net
+{
+    struct virtio_dev *dev;
+    struct virtqueue rx;
+    struct virtqueue tx;
+    uint32_t hdr_len;
+    uint8_t mac[6];
+    uint8_t *tx_free[VNET_QUEUE_SIZE]; // stack of idle TX buffers
+    uint32_t tx_nfree;
+    spinlock_t tx_lock;
+    struct napi_struct napi;
+    net_rx_handler_t rx_handler;
+    void *rx_arg;
+    uint64_t rx_packets, rx_bytes, tx_packets, tx_bytes, tx_busy;
+};
+
+static struct virtio_net vnet;
+
+DEFINE_STAT(net_rx_packets, "frames received");
+DEFINE_STAT(net_tx_packets, "frames queued for transmit");
+
+// TX cookies: a flat buffer from tx_free, or an mbuf chain tagged in bit 0
+#define VNET_TX_MBUF 1UL
+
+static int vnet_post_rx(struct virtio_net *vn, uint8_t *buf)
+{
+    struct vq_buf b = {(paddr_t)buf, VNET_BUF_SIZE, true};
+
+    return virtqueue_add(&vn->rx, &b, 1, buf);
+}
+
+static int vnet_poll(struct napi_struct *napi, int budget)
+{
+    struct virtio_net *vn = napi->priv;
+    uint32_t len;
+    uint8_t *buf;
+    int work = 0;
+
+    while (work < budget && (buf = virtqueue_get(&vn->rx, &len)))
+    {
+        if (len > vn->hdr_len)
+        {
+            vn->rx_packets++;
+            stat_inc(net_rx_packets);
+            vn->rx_bytes += len - vn->hdr_len;
+            if (vn->rx_handler)
+                vn->rx_handler(buf + vn->hdr_len, len - vn->hdr_len, vn->rx_arg);
+        }
+        vnet_post_rx(vn, buf);
+        work++;
+    }
+    if (work)
+        virtqueue_kick(&vn->rx);
+    return work;
+}
+
+static void vnet_irq_disable(struct napi_struct *napi)
+{
+    struct virtio_net *vn = napi->priv;
+
+    virtqueue_disable_cb(&vn->rx);
+}
+
+static bool vnet_irq_enable(struct napi_struct *napi)
+{
+    struct virtio_net *vn = napi->priv;
+
+    return virtqueue_enable_cb(&vn->rx);
+}
+
+static void vnet_irq(uint32_t irq, void *arg)
+{
+    struct virtio_net *vn = arg;
+
+    if (virtio_ack_irq(vn->dev) & VIRTIO_INT_USED)
+        napi_schedule(&vn->napi);
+}
+
+// tx_lock held
+static void vnet_reclaim_tx(struct virtio_net *vn)
+{
+    uint8_t *buf;
+
+    while ((buf = virtqueue_get(&vn->tx, NULL)))
+    {
+        if ((uintptr_t)buf & VNET_TX_MBUF)
+            mbuf_free((struct mbuf *)((uintptr_t)buf & ~VNET_TX_MBUF));
+        else
+            vn->tx_free[vn->tx_nfree++] = buf;
+    }
+}
+
+int net_tx(const void *frame, uint32_t len)
+{
+    struct virtio_net *vn = &vnet;
+    struct vq_buf b;
+    uint64_t flags;
+    uint8_t *buf;
+
+    if (!vn->dev)
+        return -1;
+    if (len > VNET_MAX_FRAME)
+        return -1;
+
+    flags = local_irq_save();
+    spin_lock(&vn->tx_lock);
+    vnet_reclaim_tx(vn);
+    if (!vn->tx_nfree)
+    {
+        vn->tx_busy++;
+        spin_unlock(&vn->tx_lock);
+        local_irq_restore(flags);
+        return -1;
+    }
+    buf = vn->tx_free[--vn->tx_nfree];
+    memset(buf, 0, vn->hdr_len);
+    memcpy(buf + vn->hdr_len, frame, len);
+    b.addr = (paddr_t)buf;
+    b.len = vn->hdr_len + len;
+    b.write = false;
+    // mbuf chains share the ring, so a free buffer no longer means a free descriptor
+    if (virtqueue_add(&vn->tx, &b, 1, buf))
+    {
+        vn->tx_free[vn->tx_nfree++] = buf;
+        vn->tx_busy++;
+        spin_unlock(&vn->tx_lock);
+        local_irq_restore(flags);
+        return -1;
+    }
+    virtqueue_kick(&vn->tx);
+    vn->tx_packets++;
+    stat_inc(net_tx_packets);
+    vn->tx_bytes += len;
+    spin_unlock(&vn->tx_lock);
+    local_irq_restore(flags);
+    return len;
+}
+
+// Zero copy: the header goes into m's headroom, every segment becomes a
+// descriptor. Always consumes m; it is freed once the device is done
+int net_tx_mbuf(struct mbuf *m)
+{
+    struct virtio_net *vn = &vnet;
+    struct vq_buf bufs[VNET_TX_MAX_SEGS];
+    uint32_t len = m->pkt_len;
+    uint64_t flags;
+    void *hdr;
+    int n;
+
+    if (!vn->dev || len > VNET_MAX_FRAME || !(hdr = mbuf_prepend(&m, vn->hdr_len)))
+    {
+        mbuf_free(m);
+        return -1;
+    }
+    memset(hdr, 0, vn->hdr_len);
+    n = mbuf_to_vq(m, bufs, VNET_TX_MAX_SEGS, false);
+
+    flags = local_irq_save();
+    spin_lock(&vn->tx_lock);
+    vnet_reclaim_tx(vn);
+    if (n < 0 || virtqueue_add(&vn->tx, bufs, n, (void *)((uintptr_t)m | VNET_TX_MBUF)))
+    {
+        vn->tx_busy++;
+        spin_unlock(&vn->tx_lock);
+        local_irq_restore(flags);
+        mbuf_free(m);
+        return -1;
+    }
+    virtqueue_kick(&vn->tx);
+    vn->tx_packets++;
+    stat_inc(net_tx_packets);
+    vn->tx_bytes += len;
+    spin_unlock(&vn->tx_lock);
+    local_irq_restore(flags);
+    return len;
+}
+
+void net_set_rx_handler(net_rx_handler_t fn, void *arg)
+{
+    vnet.rx_arg = arg;
+    WRITE_ONCE(vnet.rx_handler, fn);
+}
+
+const uint8_t *net_mac(void)
+{
+    return vnet.mac;
+}
+
+void net_dump(void)
+{
+    if (!vnet.dev)
+        return;
+    tiny_info("net: rx %llu pkts %llu bytes, tx %llu pkts %llu bytes, tx busy %llu, "
+              "rx kicks %llu (skipped %llu)\n",
+              vnet.rx_packets, vnet.rx_bytes, vnet.tx_packets, vnet.tx_bytes, vnet.tx_busy,
+              vnet.rx.notifies, vnet.rx.notifies_skipped);
+    napi_dump();
+}
+
+int virtio_net_probe(struct virtio_dev *dev)
+{
+    struct virtio_net *vn = &vnet;
+    uint32_t bufs_order = 0;
+    uint8_t *rx_bufs, *tx_bufs;
+
+    if (vn->dev)
+        return -1; // one NIC is enough for now
+
+    virtio_negotiate(dev, 1ULL << VIRTIO_NET_F_MAC);
+    vn->hdr_len = (dev->features & (1ULL << VIRTIO_F_VERSION_1))
+                      ? sizeof(struct virtio_net_hdr)
+                      : sizeof(struct virtio_net_hdr) - sizeof(uint16_t);
+    for (int i = 0; i < 6; i++)
+        vn->mac[i] = (dev->features & (1ULL << VIRTIO_NET_F_MAC)) ? virtio_config_read8(dev, i) : 0;
+
+    if (virtqueue_setup(dev, &vn->rx, VNET_RXQ, VNET_QUEUE_SIZE) ||
+        virtqueue_setup(dev, &vn->tx, VNET_TXQ, VNET_QUEUE_SIZE))
+        return -1;
+
+    while ((PAGE_SIZE << bufs_order) < (uint64_t)VNET_QUEUE_SIZE * VNET_BUF_SIZE)
+        bufs_order++;
+    rx_bufs = alloc_pages(bufs_order);
+    tx_bufs = alloc_pages(bufs_order);
+    if (!rx_bufs || !tx_bufs)
+        return -1;
+
+    vn->dev = dev;
+    dev->priv = vn;
+    spinlock_init(&vn->tx_lock);
+    for (uint32_t i = 0; i < vn->rx.num; i++)
+        vnet_post_rx(vn, rx_bufs + i * VNET_BUF_SIZE);
+    for (uint32_t i = 0; i < vn->tx.num; i++)
+        vn->tx_free[vn->tx_nfree++] = tx_bufs + i * VNET_BUF_SIZE;
+    virtqueue_disable_cb(&vn->tx);
+
+    vn->napi.name = "virtio-net";
+    vn->napi.poll = vnet_poll;
+    vn->napi.irq_disable = vnet_irq_disable;
+    vn->napi.irq_enable = vnet_irq_enable;
+    vn->napi.priv = vn;
+    vn->napi.policy = NAPI_POLICY_ADAPTIVE;
+    napi_register(&vn->napi);
+
+    irq_register(dev->irq, vnet_irq, vn);
+    gic_enable_irq(dev->irq);
+    virtio_driver_ok(dev);
+    virtqueue_kick(&vn->rx);
+
+    tiny_info("virtio-net: mac %02x:%02x:%02x:%02x:%02x:%02x, %u rx / %u tx slots\n",
+              vn->mac[0], vn->mac[1], vn->mac[2], vn->mac[3], vn->mac[4], vn->mac[5],
+              vn->rx.num, vn->tx.num);
+    return 0;
+}
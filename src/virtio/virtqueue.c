@@ -0,0 +1,211 @@
+/*
+ * File: virtqueue.c
+ * Date: 2026-10-18
+ * Description: Split virtqueue: descriptor free list, avail/used rings and
+ *              notification suppression in both directions. The rings use
+ *              the legacy contiguous layout, which modern devices accept
+ *              as well. The rings are DMA-coherent memory; buffers are
+ *              synced for the device on add and for the CPU on get.
+ */
+
+#include "virtio.h"
+#include "dma.h"
+#include "page_alloc.h"
+#include "tinystd.h"
+#include "trace.h"
+
+// Legacy layout: descriptors, avail ring, then the used ring on the next
+// VRING_ALIGN boundary
+static uint64_t vring_used_offset(uint32_t num)
+{
+    uint64_t avail_end = num * sizeof(struct vring_desc) + sizeof(struct vring_avail) +
+                         (num + 1) * sizeof(uint16_t);
+
+    return (avail_end + VRING_ALIGN - 1) & ~(uint64_t)(VRING_ALIGN - 1);
+}
+
+static uint64_t vring_size(uint32_t num)
+{
+    return vring_used_offset(num) + sizeof(struct vring_used) +
+           num * sizeof(struct vring_used_elem) + sizeof(uint16_t);
+}
+
+static uint32_t size_to_order(uint64_t size)
+{
+    uint32_t order = 0;
+
+    while ((PAGE_SIZE << order) < size)
+        order++;
+    return order;
+}
+
+int virtqueue_setup(struct virtio_dev *dev, struct virtqueue *vq, uint32_t index,
+                    uint32_t num)
+{
+    uint32_t max;
+    uint8_t *mem;
+    dma_addr_t pa;
+
+    virtio_write32(dev, VIRTIO_MMIO_QUEUE_SEL, index);
+    max = virtio_read32(dev, VIRTIO_MMIO_QUEUE_NUM_MAX);
+    if (!max)
+        return -1;
+    num = MIN(num, max);
+    if (num & (num - 1)) // ring slots are indexed with idx & (num - 1)
+        return -1;
+
+    mem = dma_alloc_coherent(&dev->dma, vring_size(num), &pa);
+    vq->cookies = alloc_zeroed_pages(size_to_order(num * sizeof(void *)));
+    if (!mem || !vq->cookies)
+    {
+        if (mem)
+            dma_free_coherent(&dev->dma, mem, vring_size(num));
+        if (vq->cookies)
+            free_pages(vq->cookies, size_to_order(num * sizeof(void *)));
+        vq->cookies = NULL;
+        return -1;
+    }
+
+    vq->dev = dev;
+    vq->index = index;
+    vq->num = num;
+    vq->desc = (struct vring_desc *)mem;
+    vq->avail = (struct vring_avail *)(mem + num * sizeof(struct vring_desc));
+    vq->used = (struct vring_used *)(mem + vring_used_offset(num));
+    for (uint32_t i = 0; i < num - 1; i++)
+        vq->desc[i].next = i + 1;
+    vq->free_head = 0;
+    vq->num_free = num;
+    vq->last_used = 0;
+
+    // The initialised ring must be visible before the device learns where it is
+    if (dev->version == 1)
+    {
+        const struct mmio_write regs[] = {
+            {VIRTIO_MMIO_QUEUE_NUM, num},
+            {VIRTIO_MMIO_QUEUE_ALIGN, VRING_ALIGN},
+            {VIRTIO_MMIO_QUEUE_PFN, pa >> PAGE_SHIFT},
+        };
+
+        writel_batch((volatile void *)dev->base, regs, sizeof(regs) / sizeof(regs[0]));
+    }
+    else
+    {
+        uint64_t avail = pa + num * sizeof(struct vring_desc);
+        uint64_t used = pa + vring_used_offset(num);
+        const struct mmio_write regs[] = {
+            {VIRTIO_MMIO_QUEUE_NUM, num},
+            {VIRTIO_MMIO_QUEUE_DESC_LOW, (uint32_t)pa},
+            {VIRTIO_MMIO_QUEUE_DESC_HIGH, (uint32_t)(pa >> 32)},
+            {VIRTIO_MMIO_QUEUE_AVAIL_LOW, (uint32_t)avail},
+            {VIRTIO_MMIO_QUEUE_AVAIL_HIGH, (uint32_t)(avail >> 32)},
+            {VIRTIO_MMIO_QUEUE_USED_LOW, (uint32_t)used},
+            {VIRTIO_MMIO_QUEUE_USED_HIGH, (uint32_t)(used >> 32)},
+            {VIRTIO_MMIO_QUEUE_READY, 1},
+        };
+
+        writel_batch((volatile void *)dev->base, regs, sizeof(regs) / sizeof(regs[0]));
+    }
+    return 0;
+}
+
+// Chain `n` buffers and publish the head; the device sees it after a kick
+int virtqueue_add(struct virtqueue *vq, const struct vq_buf *bufs, uint32_t n, void *cookie)
+{
+    uint16_t head, idx, prev = 0;
+
+    if (!n || n > vq->num_free)
+        return -1;
+    dma_sync_sg_for_device(&vq->dev->dma, bufs, n);
+
+    head = idx = vq->free_head;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        struct vring_desc *d = &vq->desc[idx];
+
+        d->addr = bufs[i].addr;
+        d->len = bufs[i].len;
+        d->flags = (bufs[i].write ? VRING_DESC_F_WRITE : 0) |
+                   (i + 1 < n ? VRING_DESC_F_NEXT : 0);
+        prev = idx;
+        idx = d->next;
+    }
+    vq->free_head = vq->desc[prev].next;
+    vq->num_free -= n;
+    vq->cookies[head] = cookie;
+
+    vq->avail->ring[vq->avail->idx & (vq->num - 1)] = head;
+    virtio_wmb();
+    vq->avail->idx++;
+    return 0;
+}
+
+// Skip the MMIO write (a full VM exit) while the device is still polling.
+// The one dmb osh orders the avail index both before the flags read and
+// before the doorbell, so the notify itself can be a relaxed write.
+void virtqueue_kick(struct virtqueue *vq)
+{
+    virtio_mb();
+    if (vq->used->flags & VRING_USED_F_NO_NOTIFY)
+    {
+        vq->notifies_skipped++;
+        trace_event(TRACE_VQ_KICK, TRACE_VQ_ID(vq->dev->slot, vq->index), 0);
+        return;
+    }
+    virtio_write32(vq->dev, VIRTIO_MMIO_QUEUE_NOTIFY, vq->index);
+    vq->notifies++;
+    trace_event(TRACE_VQ_KICK, TRACE_VQ_ID(vq->dev->slot, vq->index), 1);
+}
+
+// Next completed chain, or NULL; *len is what the device wrote
+void *virtqueue_get(struct virtqueue *vq, uint32_t *len)
+{
+    struct vring_used_elem *e;
+    uint16_t head, idx;
+    uint32_t n = 1;
+    void *cookie;
+
+    if (!virtqueue_has_used(vq))
+        return NULL;
+    virtio_rmb();
+
+    e = &vq->used->ring[vq->last_used & (vq->num - 1)];
+    head = e->id;
+    if (len)
+        *len = e->len;
+    trace_event(TRACE_VQ_COMPLETE, TRACE_VQ_ID(vq->dev->slot, vq->index), e->len);
+    vq->last_used++;
+
+    for (idx = head;; idx = vq->desc[idx].next)
+    {
+        struct vring_desc *d = &vq->desc[idx];
+
+        if (d->flags & VRING_DESC_F_WRITE)
+            __dma_sync_for_cpu(&vq->dev->dma, d->addr, d->len, DMA_FROM_DEVICE);
+        if (!(d->flags & VRING_DESC_F_NEXT))
+            break;
+        n++;
+    }
+    if (!vq->dev->dma.coherent)
+        dma_sync_fence();
+    vq->desc[idx].next = vq->free_head;
+    vq->free_head = head;
+    vq->num_free += n;
+
+    cookie = vq->cookies[head];
+    vq->cookies[head] = NULL;
+    return cookie;
+}
+
+void virtqueue_disable_cb(struct virtqueue *vq)
+{
+    vq->avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
+}
+
+// Returns false when completions slipped in, so the caller keeps polling
+bool virtqueue_enable_cb(struct virtqueue *vq)
+{
+    vq->avail->flags &= ~VRING_AVAIL_F_NO_INTERRUPT;
+    virtio_mb();
+    return !virtqueue_has_used(vq);
+}
@@ -22,12 +22,14 @@ task("qemu")
 target("arm_tiny")
     set_kind("binary")
     add_files("src/*.c")
+    add_files("src/virtio/*.c")
+    add_files("src/user/*.c")
     add_files("asm/*.S")
     add_files("link.lds")
     add_includedirs("include")
     
     add_cflags("-Wall", "-c", "-O0", "-lc", "-g", "-fno-pie", "-fno-builtin-printf", "-mgeneral-regs-only", {force = true})
-    add_asflags("-Wall", "-c", "-O0", "-lc", "-g", "-fno-pie", "-fno-builtin-printf", "-mgeneral-regs-only", {force = true})
+    add_asflags("-D__ASSEMBLY__", "-Wall", "-c", "-O0", "-lc", "-g", "-fno-pie", "-fno-builtin-printf", "-mgeneral-regs-only", {force = true})
     add_defines('VM_VERSION=\"null\"')
 
     set_filename("arm_tiny.elf")